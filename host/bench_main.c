@@ -0,0 +1,243 @@
+// Host latency benchmark: runs full conversational turns (capture, STT,
+// assistant, TTS, playback) through the firmware stage tasks against the
+// endpoints in sdkconfig.host, with a WAV file as the microphone.
+//
+// usage: rigo_bench --wav speech.wav [--turns N] [--speed X] [--gap-ms MS] [--overlap | --barge-ms MS]
+//
+// By default each turn starts --gap-ms after the previous reply has played.
+// With --overlap the next wake comes as soon as the uplink stage is free, so
+// capture and STT of one turn run while the previous reply is fetched and
+// played. With --barge-ms the next wake comes MS after the previous reply
+// started playing; built with CONFIG_RIGO_BARGE_IN it cuts that reply off
+// (host/sdkconfig.barge_in).
+//
+// Progress goes to stderr; stdout gets one JSON object with the per-turn wall
+// times, player stats, per-task CPU and the /v1/metrics document.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "host_audio.h"
+#include "rigo_conn.h"
+#include "rigo_metrics.h"
+#include "rigo_mic.h"
+#include "rigo_pipeline.h"
+#include "rigo_player.h"
+#include "rigo_tasks.h"
+#include "rigo_tts_cache.h"
+#include "rigo_tts_pipe.h"
+#include "rigo_wav.h"
+
+static const char *TAG = "rigo_bench";
+
+#define MAX_TURNS 1000
+
+static SemaphoreHandle_t captured_sem;
+static SemaphoreHandle_t done_sem;
+static SemaphoreHandle_t playing_sem;
+static uint32_t first_turn;
+static int64_t wake_us[MAX_TURNS];
+static uint32_t wall_ms[MAX_TURNS];
+
+static void turn_captured(void)
+{
+    xSemaphoreGive(captured_sem);
+}
+
+static void turn_done(uint32_t turn)
+{
+    uint32_t i = turn - first_turn;
+    if (i >= MAX_TURNS) return;
+    wall_ms[i] = (uint32_t)((esp_timer_get_time() - wake_us[i]) / 1000);
+    ESP_LOGI(TAG, "Turn %u: %u ms", (unsigned)(i + 1), (unsigned)wall_ms[i]);
+    xSemaphoreGive(done_sem);
+}
+
+static void player_event(bool playing)
+{
+    if (playing) xSemaphoreGive(playing_sem);
+}
+
+// The clip restarts where the wake word would have fired. While the uplink
+// stage is still busy with the previous turn the wake is retried, with the
+// clip held at its start.
+static void wake(esp_codec_dev_handle_t mic, rigo_mic_reader_t *edge, int t)
+{
+    uint32_t turn;
+    while (1) {
+        host_mic_rewind(mic);
+        rigo_mic_sync(edge);
+        if ((turn = rigo_pipeline_wake(edge->pos))) break;
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    if (t == 0) first_turn = turn;
+    wake_us[t] = esp_timer_get_time();
+}
+
+static int16_t *load_wav(const char *path, int *samples)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *raw = malloc(size);
+    int16_t *pcm = malloc(size);
+    if (!raw || !pcm || fread(raw, 1, size, f) != (size_t)size) {
+        fclose(f);
+        free(raw);
+        free(pcm);
+        return NULL;
+    }
+    fclose(f);
+
+    rigo_wav_parser_t p;
+    rigo_wav_parser_init(&p);
+    int off = 0, out = 0;
+    while (off < size) {
+        const uint8_t *data = NULL;
+        int data_len = 0;
+        int used = rigo_wav_parse(&p, raw + off, size - off, &data, &data_len);
+        if (used <= 0) break;
+        if (data_len > 0) {
+            memcpy((uint8_t *)pcm + out, data, data_len);
+            out += data_len;
+        }
+        off += used;
+    }
+    free(raw);
+    if (!p.have_fmt || p.format != RIGO_WAV_FMT_PCM || p.channels != 1 || p.bits != 16 || p.sample_rate != 16000) {
+        ESP_LOGE(TAG, "%s: need 16 kHz mono PCM16", path);
+        free(pcm);
+        return NULL;
+    }
+    *samples = out / 2;
+    return pcm;
+}
+
+static void emit_stdout(const char *data, int len, void *ctx)
+{
+    (void)ctx;
+    fwrite(data, 1, len, stdout);
+}
+
+static void emit_null(const char *data, int len, void *ctx)
+{
+    (void)data;
+    (void)len;
+    (void)ctx;
+}
+
+int main(int argc, char **argv)
+{
+    const char *wav = NULL;
+    int turns = 5;
+    int gap_ms = 500;
+    bool overlap = false;
+    int barge_ms = -1;
+    double speed = 1.0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--wav") && i + 1 < argc) wav = argv[++i];
+        else if (!strcmp(argv[i], "--turns") && i + 1 < argc) turns = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--speed") && i + 1 < argc) speed = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--gap-ms") && i + 1 < argc) gap_ms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--overlap")) overlap = true;
+        else if (!strcmp(argv[i], "--barge-ms") && i + 1 < argc) barge_ms = atoi(argv[++i]);
+        else {
+            fprintf(stderr,
+                    "usage: %s --wav speech.wav [--turns N] [--speed X] [--gap-ms MS] [--overlap | --barge-ms MS]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (!wav || turns < 1 || turns > MAX_TURNS || (overlap && barge_ms >= 0)) {
+        fprintf(stderr, "--wav is required, --turns 1..%d, --overlap and --barge-ms exclude each other\n", MAX_TURNS);
+        return 2;
+    }
+
+    int samples = 0;
+    int16_t *clip = load_wav(wav, &samples);
+    if (!clip) {
+        ESP_LOGE(TAG, "Cannot load %s", wav);
+        return 1;
+    }
+    host_audio_set_speed(speed);
+    esp_codec_dev_handle_t mic = host_mic_create(clip, samples);
+    esp_codec_dev_handle_t spk = host_speaker_create();
+
+    ESP_ERROR_CHECK(rigo_mic_init(mic));
+    playing_sem = xSemaphoreCreateCounting(MAX_TURNS, 0);
+    ESP_ERROR_CHECK(rigo_player_init(spk, player_event));
+    ESP_ERROR_CHECK(rigo_conn_init());
+#if CONFIG_RIGO_TTS_CACHE_ENABLE
+    ESP_ERROR_CHECK(rigo_tts_cache_init());
+#endif
+    ESP_ERROR_CHECK(rigo_tts_pipe_init());
+    captured_sem = xSemaphoreCreateCounting(MAX_TURNS, 0);
+    done_sem = xSemaphoreCreateCounting(MAX_TURNS, 0);
+    const rigo_pipeline_cb_t cb = {.on_captured = turn_captured, .on_turn_done = turn_done};
+    ESP_ERROR_CHECK(rigo_pipeline_init(&cb));
+
+    // stands in for the wake detector's cursor
+    static rigo_mic_reader_t edge;
+    ESP_ERROR_CHECK(rigo_mic_reader_init(&edge));
+    rigo_tasks_write_json(emit_null, NULL);     // CPU shares count from here
+
+    ESP_LOGI(TAG, "%d turns, %d ms clip, speed %.2f%s", turns, samples / 16, speed,
+             overlap ? ", overlapped" : barge_ms >= 0 ? ", barge-in" : "");
+    int64_t t0 = esp_timer_get_time();
+    for (int t = 0; t < turns; t++) {
+        wake(mic, &edge, t);
+        if (overlap) {
+            // the clip may restart once this turn's capture is over
+            xSemaphoreTake(captured_sem, portMAX_DELAY);
+        } else if (barge_ms >= 0 && t + 1 < turns) {
+            // interrupt this turn's reply once it is audible
+            xSemaphoreTake(playing_sem, portMAX_DELAY);
+            vTaskDelay(pdMS_TO_TICKS(barge_ms));
+        } else if (barge_ms >= 0) {
+            xSemaphoreTake(done_sem, portMAX_DELAY);
+        } else {
+            xSemaphoreTake(done_sem, portMAX_DELAY);
+            vTaskDelay(pdMS_TO_TICKS(gap_ms));
+        }
+    }
+    if (overlap) {
+        for (int t = 0; t < turns; t++) xSemaphoreTake(done_sem, portMAX_DELAY);
+    } else if (barge_ms >= 0) {
+        for (int t = 1; t < turns; t++) xSemaphoreTake(done_sem, portMAX_DELAY);
+    }
+    uint32_t total_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+
+    rigo_player_stats_t ps;
+    rigo_player_get_stats(&ps);
+    printf("{\"bench\":{\"turns\":%d,\"clip_ms\":%d,\"speed\":%.2f,\"overlap\":%s,\"barge_ms\":%d,\"total_ms\":%u,"
+           "\"wall_ms\":[",
+           turns, samples / 16, speed, overlap ? "true" : "false", barge_ms, (unsigned)total_ms);
+    for (int t = 0; t < turns; t++) printf("%s%u", t ? "," : "", (unsigned)wall_ms[t]);
+    host_speaker_stats_t ss;
+    host_speaker_get_stats(spk, &ss);
+    printf("],\"player\":{\"utterances\":%u,\"underruns\":%u,\"bytes_played\":%u,\"ring_high_water\":%u,"
+           "\"decode_us\":%llu,\"env_max_us\":%u,\"stops\":%u,\"stop_max_ms\":%u,\"resample_us\":%llu,"
+           "\"resampled_frames\":%u,\"speaker_opens\":%u}}",
+           (unsigned)ps.utterances, (unsigned)ps.underruns, (unsigned)ps.bytes_played,
+           (unsigned)ps.ring_high_water, (unsigned long long)ps.decode_us, (unsigned)ps.env_max_us,
+           (unsigned)ps.stops, (unsigned)ps.stop_max_ms, (unsigned long long)ps.resample_us,
+           (unsigned)ps.resampled_frames, (unsigned)ss.opens);
+    printf(",\"tasks\":");
+    rigo_tasks_write_json(emit_stdout, NULL);
+    printf(",\"metrics\":");
+    rigo_metrics_write_json(emit_stdout, NULL);
+    printf("}\n");
+    fflush(stdout);
+    free(clip);
+    return 0;
+}
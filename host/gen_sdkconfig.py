@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Generate sdkconfig.h for the host build.
+
+Values are the defaults from main/Kconfig.projbuild, overridden by one or more
+sdkconfig-style files (CONFIG_X=value, "# CONFIG_X is not set"). Selecting a
+choice member deselects its siblings. `depends on` is not evaluated; the
+sources guard dependent options themselves.
+
+usage: gen_sdkconfig.py Kconfig.projbuild out/sdkconfig.h [overrides ...]
+"""
+
+import re
+import sys
+
+
+def parse_kconfig(path):
+    values = {}
+    choices = []            # list of member lists
+    cur = typ = None
+    members = None
+    choice_default = None
+    for raw in open(path, encoding="utf-8"):
+        s = raw.strip()
+        if s.startswith("choice"):
+            members, choice_default, cur = [], None, None
+            continue
+        if s == "endchoice":
+            sel = choice_default or (members[0] if members else None)
+            for name in members:
+                values[name] = "y" if name == sel else "n"
+            choices.append(members)
+            members = None
+            continue
+        m = re.match(r"(?:menu)?config\s+(\w+)$", s)
+        if m:
+            cur, typ = m.group(1), None
+            if members is not None:
+                members.append(cur)
+            continue
+        t = re.match(r"(bool|int|string|hex)\b", s)
+        if t and cur:
+            typ = t.group(1)
+            continue
+        d = re.match(r"default\s+(.+?)(\s+if\s+.*)?$", s)
+        if not d:
+            continue
+        if members is not None and typ is None:
+            choice_default = choice_default or d.group(1)
+        elif cur and typ and cur not in values:
+            values[cur] = d.group(1)
+    return values, choices
+
+
+def apply_overrides(values, choices, path):
+    for raw in open(path, encoding="utf-8"):
+        s = raw.strip()
+        m = re.match(r"#\s*CONFIG_(\w+) is not set", s)
+        if m:
+            values[m.group(1)] = "n"
+            continue
+        if not s or s.startswith("#"):
+            continue
+        m = re.match(r"CONFIG_(\w+)=(.*)$", s)
+        if not m:
+            sys.exit("%s: cannot parse: %s" % (path, s))
+        name, value = m.groups()
+        if value == "y":
+            for members in choices:
+                if name in members:
+                    for other in members:
+                        values[other] = "n"
+        values[name] = value
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+    values, choices = parse_kconfig(sys.argv[1])
+    for path in sys.argv[3:]:
+        apply_overrides(values, choices, path)
+
+    out = ["// Generated by host/gen_sdkconfig.py, do not edit.", "#pragma once"]
+    for name, value in values.items():
+        if value == "n":
+            continue
+        out.append("#define CONFIG_%s %s" % (name, "1" if value == "y" else value))
+    text = "\n".join(out) + "\n"
+    try:
+        if open(sys.argv[2], encoding="utf-8").read() == text:
+            return      # keep the timestamp, no needless rebuild
+    except OSError:
+        pass
+    with open(sys.argv[2], "w", encoding="utf-8") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main()
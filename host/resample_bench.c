@@ -0,0 +1,208 @@
+// Host accuracy and throughput check for the speaker resampler
+// (main/rigo_resample.c), no network or audio needed.
+//
+// usage: rigo_resample_bench [--seconds S] [--seed N]
+//
+// Accuracy: sine tones go through each rate/channel pair in random-sized
+// chunks, as network reads deliver them. The output is least-squares fitted
+// to the ideal tone at the output rate and the residual reported as SNR;
+// chunked output must match a single-call run sample for sample. For
+// downsampling, a tone between the two Nyquist rates measures how far its
+// alias is rejected. Throughput: S seconds of noise per pair, reported as ns
+// per output frame and multiple of real time on this host; the device figure
+// is in the player's per-reply "Converted" log line.
+//
+// Exits non-zero when a pair misses the SNR or alias floor.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rigo_resample.h"
+
+#define MIN_SNR_DB 60.0
+#define MIN_ALIAS_DB 50.0
+#define TONE_FRAMES 16000
+#define SKIP 64                 // filter start-up and tail, excluded from the fit
+
+typedef struct {
+    int in_rate, in_ch, out_rate, out_ch;
+} pair_t;
+
+static const pair_t pairs[] = {
+    {24000, 1, 16000, 1},
+    {22050, 1, 16000, 1},
+    {8000, 1, 16000, 1},
+    {48000, 1, 16000, 1},
+    {16000, 2, 16000, 1},
+    {24000, 1, 48000, 1},
+    {22050, 1, 48000, 2},
+    {44100, 2, 48000, 2},
+    {24000, 2, 16000, 1},
+};
+
+static unsigned rng = 1;
+
+static int rnd(int n)
+{
+    rng = rng * 1103515245u + 12345u;
+    return (rng >> 16) % n;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// chunked when `chunked`, else one call; returns output frames
+static int run(const pair_t *p, const int16_t *in, int frames, int16_t *out, int chunked)
+{
+    rigo_resample_t rs;
+    rigo_resample_init(&rs, p->out_rate, p->out_ch);
+    if (rigo_resample_config(&rs, p->in_rate, p->in_ch) != ESP_OK) return -1;
+    int produced = 0;
+    for (int i = 0; i < frames;) {
+        int n = chunked ? 1 + rnd(700) : frames;
+        if (n > frames - i) n = frames - i;
+        produced += rigo_resample_process(&rs, in + i * p->in_ch, n, out + produced * p->out_ch);
+        i += n;
+    }
+    produced += rigo_resample_flush(&rs, out + produced * p->out_ch);
+    rigo_resample_free(&rs);
+    return produced;
+}
+
+static void tone(int16_t *buf, int frames, int ch, int c, double hz, int rate)
+{
+    for (int i = 0; i < frames; i++) buf[i * ch + c] = (int16_t)lrint(16000.0 * sin(2 * M_PI * hz * i / rate));
+}
+
+// residual of channel c after fitting a*sin + b*cos + dc at hz, in dB below the fitted tone
+static double snr_db(const int16_t *y, int frames, int ch, int c, double hz, int rate)
+{
+    double s[3][3] = {{0}}, r[3] = {0};
+    for (int i = SKIP; i < frames - SKIP; i++) {
+        const double w = 2 * M_PI * hz * i / rate;
+        const double b[3] = {sin(w), cos(w), 1.0};
+        for (int j = 0; j < 3; j++) {
+            r[j] += b[j] * y[i * ch + c];
+            for (int k = 0; k < 3; k++) s[j][k] += b[j] * b[k];
+        }
+    }
+    // 3x3 normal equations by Cramer's rule
+    double det = s[0][0] * (s[1][1] * s[2][2] - s[1][2] * s[2][1]) - s[0][1] * (s[1][0] * s[2][2] - s[1][2] * s[2][0]) +
+                 s[0][2] * (s[1][0] * s[2][1] - s[1][1] * s[2][0]);
+    double x[3];
+    for (int k = 0; k < 3; k++) {
+        double m[3][3];
+        memcpy(m, s, sizeof(m));
+        for (int j = 0; j < 3; j++) m[j][k] = r[j];
+        x[k] = (m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0])) / det;
+    }
+    double sig = 0, err = 0;
+    for (int i = SKIP; i < frames - SKIP; i++) {
+        const double w = 2 * M_PI * hz * i / rate;
+        const double fit = x[0] * sin(w) + x[1] * cos(w);
+        sig += fit * fit;
+        err += (y[i * ch + c] - fit - x[2]) * (y[i * ch + c] - fit - x[2]);
+    }
+    return 10 * log10(sig / (err > 1e-9 ? err : 1e-9));
+}
+
+static double power(const int16_t *y, int frames, int ch, int c)
+{
+    double p = 0;
+    for (int i = SKIP; i < frames - SKIP; i++) p += (double)y[i * ch + c] * y[i * ch + c];
+    return p / (frames - 2 * SKIP);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 10.0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            rng = (unsigned)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--seconds S] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int failures = 0;
+    printf("%-22s %8s %8s %8s %9s %10s %8s\n", "pair", "low dB", "mid dB", "high dB", "alias dB", "ns/frame", "x rt");
+    for (size_t k = 0; k < sizeof(pairs) / sizeof(pairs[0]); k++) {
+        const pair_t *p = &pairs[k];
+        const int low_nyq = (p->in_rate < p->out_rate ? p->in_rate : p->out_rate) / 2;
+        const double hz[3] = {440.0, 0.3 * low_nyq, 0.8 * low_nyq};
+        const int max_out = (int)((int64_t)TONE_FRAMES * p->out_rate / p->in_rate) + RIGO_RS_TAPS + 4;
+        int16_t *in = calloc((size_t)TONE_FRAMES * p->in_ch, sizeof(int16_t));
+        int16_t *out = calloc((size_t)max_out * p->out_ch, sizeof(int16_t));
+        int16_t *ref = calloc((size_t)max_out * p->out_ch, sizeof(int16_t));
+
+        double snr[3];
+        int mismatch = 0;
+        for (int t = 0; t < 3; t++) {
+            // stereo inputs carry a second tone on the right so channel mix-ups show
+            tone(in, TONE_FRAMES, p->in_ch, 0, hz[t], p->in_rate);
+            if (p->in_ch == 2) tone(in, TONE_FRAMES, 2, 1, p->out_ch == 2 ? hz[t] * 0.75 : hz[t], p->in_rate);
+            int n = run(p, in, TONE_FRAMES, out, 1);
+            int m = run(p, in, TONE_FRAMES, ref, 0);
+            if (n != m || memcmp(out, ref, (size_t)n * p->out_ch * sizeof(int16_t))) mismatch = 1;
+            snr[t] = snr_db(out, n, p->out_ch, 0, hz[t], p->out_rate);
+            if (p->out_ch == 2) {
+                const double right_hz = p->in_ch == 2 ? hz[t] * 0.75 : hz[t];
+                double r = snr_db(out, n, 2, 1, right_hz, p->out_rate);
+                if (r < snr[t]) snr[t] = r;
+            }
+        }
+
+        double alias = NAN;
+        if (p->in_rate > p->out_rate) {
+            // halfway between the two Nyquist rates: must not fold back in band
+            const double f = 0.5 * (p->out_rate / 2 + p->in_rate / 2) + 0.05 * (p->in_rate - p->out_rate);
+            for (int c = 0; c < p->in_ch; c++) tone(in, TONE_FRAMES, p->in_ch, c, f, p->in_rate);
+            int n = run(p, in, TONE_FRAMES, out, 1);
+            alias = 10 * log10(power(in, TONE_FRAMES, p->in_ch, 0) / (power(out, n, p->out_ch, 0) + 1e-9));
+        }
+
+        // throughput on noise, in 256-frame calls like the player
+        const int frames = (int)(seconds * p->in_rate);
+        int16_t *noise = malloc((size_t)frames * p->in_ch * sizeof(int16_t));
+        int16_t *sink = malloc((size_t)(256 * p->out_rate / p->in_rate + 4) * p->out_ch * sizeof(int16_t));
+        for (int i = 0; i < frames * p->in_ch; i++) noise[i] = (int16_t)(rnd(32768) - 16384);
+        rigo_resample_t rs;
+        rigo_resample_init(&rs, p->out_rate, p->out_ch);
+        rigo_resample_config(&rs, p->in_rate, p->in_ch);
+        long long produced = 0;
+        const double t0 = now_s();
+        for (int i = 0; i < frames; i += 256) {
+            const int n = frames - i < 256 ? frames - i : 256;
+            produced += rigo_resample_process(&rs, noise + i * p->in_ch, n, sink);
+        }
+        const double dt = now_s() - t0;
+        rigo_resample_free(&rs);
+
+        char name[32];
+        snprintf(name, sizeof(name), "%d/%d -> %d/%d", p->in_rate, p->in_ch, p->out_rate, p->out_ch);
+        printf("%-22s %8.1f %8.1f %8.1f %9.1f %10.1f %8.0f%s\n", name, snr[0], snr[1], snr[2], alias,
+               dt * 1e9 / produced, seconds / dt, mismatch ? "  CHUNKED OUTPUT DIFFERS" : "");
+        for (int t = 0; t < 3; t++) failures += snr[t] < MIN_SNR_DB;
+        failures += mismatch + (!isnan(alias) && alias < MIN_ALIAS_DB);
+
+        free(noise);
+        free(sink);
+        free(in);
+        free(out);
+        free(ref);
+    }
+    if (failures) printf("FAIL: %d checks below %.0f dB SNR / %.0f dB alias rejection or mismatched\n", failures,
+                         MIN_SNR_DB, MIN_ALIAS_DB);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+// Host shim: codec devices are the paced mic/speaker from host_audio.h.
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define ESP_CODEC_DEV_OK 0
+#define ESP_CODEC_DEV_INVALID_ARG -1
+#define ESP_CODEC_DEV_WRONG_STATE -2
+
+typedef struct host_codec *esp_codec_dev_handle_t;
+
+typedef struct {
+    uint8_t bits_per_sample;
+    uint8_t channel;
+    uint16_t channel_mask;
+    uint32_t sample_rate;
+    int mclk_multiple;
+} esp_codec_dev_sample_info_t;
+
+int esp_codec_dev_open(esp_codec_dev_handle_t dev, esp_codec_dev_sample_info_t *fs);
+int esp_codec_dev_read(esp_codec_dev_handle_t dev, void *data, int len);
+int esp_codec_dev_write(esp_codec_dev_handle_t dev, void *data, int len);
+int esp_codec_dev_close(esp_codec_dev_handle_t dev);
+int esp_codec_dev_set_out_vol(esp_codec_dev_handle_t dev, int volume);
+int esp_codec_dev_set_in_gain(esp_codec_dev_handle_t dev, float db);
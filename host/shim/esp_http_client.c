@@ -0,0 +1,470 @@
+#define _GNU_SOURCE
+
+#include "esp_http_client.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+
+static const char *TAG = "http_client";
+
+#define MAX_HEADERS 16
+#define RX_SIZE 4096
+
+enum { RD_TIMEOUT = -2, RD_ERROR = -1 };
+
+typedef enum {
+    BODY_NONE,
+    BODY_LEN,
+    BODY_CHUNK_SIZE,
+    BODY_CHUNK_DATA,
+    BODY_CHUNK_END,
+    BODY_UNTIL_CLOSE,
+    BODY_DONE,
+} body_state_t;
+
+struct esp_http_client {
+    char host[128];
+    char port[8];
+    char path[256];
+    esp_http_client_method_t method;
+    int timeout_ms;
+    http_event_handle_cb handler;
+    void *user_data;
+    char *hdr_key[MAX_HEADERS];
+    char *hdr_val[MAX_HEADERS];
+    const char *post_data;
+    int post_len;
+
+    int fd;
+    char rx[RX_SIZE];
+    int rx_off;
+    int rx_len;
+
+    int status;
+    int64_t content_length;
+    bool chunked;
+    bool conn_close;
+    body_state_t body;
+    int64_t left;
+};
+
+static void dispatch(esp_http_client_handle_t c, esp_http_client_event_id_t id, void *data, int len,
+                     char *key, char *value)
+{
+    if (!c->handler) return;
+    esp_http_client_event_t evt = {
+        .event_id = id,
+        .client = c,
+        .data = data,
+        .data_len = len,
+        .user_data = c->user_data,
+        .header_key = key,
+        .header_value = value,
+    };
+    c->handler(&evt);
+}
+
+static bool parse_url(esp_http_client_handle_t c, const char *url)
+{
+    if (strncasecmp(url, "https://", 8) == 0) {
+        ESP_LOGE(TAG, "TLS is not supported in the host build: %s", url);
+        return false;
+    }
+    if (strncasecmp(url, "http://", 7) != 0) return false;
+    const char *h = url + 7;
+    const char *slash = strchr(h, '/');
+    const char *end = slash ? slash : h + strlen(h);
+    const char *colon = memchr(h, ':', end - h);
+    const char *hend = colon ? colon : end;
+    if (hend - h <= 0 || hend - h >= (int)sizeof(c->host)) return false;
+    memcpy(c->host, h, hend - h);
+    c->host[hend - h] = 0;
+    if (colon) snprintf(c->port, sizeof(c->port), "%.*s", (int)(end - colon - 1), colon + 1);
+    else strcpy(c->port, "80");
+    snprintf(c->path, sizeof(c->path), "%s", slash ? slash : "/");
+    return true;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    esp_http_client_handle_t c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    if (!config->url || !parse_url(c, config->url)) {
+        free(c);
+        return NULL;
+    }
+    c->method = config->method;
+    c->timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 5000;
+    c->handler = config->event_handler;
+    c->user_data = config->user_data;
+    c->fd = -1;
+    return c;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t c)
+{
+    if (c->fd >= 0) {
+        close(c->fd);
+        c->fd = -1;
+        dispatch(c, HTTP_EVENT_DISCONNECTED, NULL, 0, NULL, NULL);
+    }
+    c->rx_off = c->rx_len = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t c)
+{
+    if (!c) return ESP_FAIL;
+    esp_http_client_close(c);
+    for (int i = 0; i < MAX_HEADERS; i++) {
+        free(c->hdr_key[i]);
+        free(c->hdr_val[i]);
+    }
+    free(c);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t c, const char *key, const char *value)
+{
+    int free_slot = -1;
+    for (int i = 0; i < MAX_HEADERS; i++) {
+        if (c->hdr_key[i] && strcasecmp(c->hdr_key[i], key) == 0) {
+            free(c->hdr_val[i]);
+            c->hdr_val[i] = strdup(value);
+            return ESP_OK;
+        }
+        if (!c->hdr_key[i] && free_slot < 0) free_slot = i;
+    }
+    if (free_slot < 0) return ESP_ERR_NO_MEM;
+    c->hdr_key[free_slot] = strdup(key);
+    c->hdr_val[free_slot] = strdup(value);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t c, const char *key)
+{
+    for (int i = 0; i < MAX_HEADERS; i++) {
+        if (c->hdr_key[i] && strcasecmp(c->hdr_key[i], key) == 0) {
+            free(c->hdr_key[i]);
+            free(c->hdr_val[i]);
+            c->hdr_key[i] = c->hdr_val[i] = NULL;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t c, esp_http_client_method_t method)
+{
+    c->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t c, const char *data, int len)
+{
+    c->post_data = data;
+    c->post_len = data ? len : 0;
+    return ESP_OK;
+}
+
+// ---- socket ----
+
+static void sock_timeout(int fd, int ms)
+{
+    struct timeval tv = {.tv_sec = ms / 1000, .tv_usec = (ms % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static bool sock_connect(esp_http_client_handle_t c)
+{
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    struct addrinfo *res;
+    if (getaddrinfo(c->host, c->port, &hints, &res) != 0) return false;
+    for (struct addrinfo *ai = res; ai && c->fd < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        sock_timeout(fd, c->timeout_ms);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) c->fd = fd;
+        else close(fd);
+    }
+    freeaddrinfo(res);
+    return c->fd >= 0;
+}
+
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t c, int timeout_ms)
+{
+    c->timeout_ms = timeout_ms;
+    if (c->fd >= 0) sock_timeout(c->fd, timeout_ms);
+    return ESP_OK;
+}
+
+static bool sock_send(esp_http_client_handle_t c, const char *data, int len)
+{
+    while (len > 0) {
+        ssize_t n = send(c->fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Refills the receive buffer once it is drained: >0 bytes, 0 peer closed.
+static int rx_fill(esp_http_client_handle_t c)
+{
+    if (c->rx_off < c->rx_len) return c->rx_len - c->rx_off;
+    c->rx_off = c->rx_len = 0;
+    while (1) {
+        ssize_t n = recv(c->fd, c->rx, sizeof(c->rx), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK) ? RD_TIMEOUT : RD_ERROR;
+        c->rx_len = (int)n;
+        return (int)n;
+    }
+}
+
+// One CRLF-terminated line without the terminator.
+static int read_line(esp_http_client_handle_t c, char *line, int cap)
+{
+    int n = 0;
+    while (1) {
+        int r = rx_fill(c);
+        if (r == 0) return RD_ERROR;
+        if (r < 0) return r;
+        char ch = c->rx[c->rx_off++];
+        if (ch == '\n') break;
+        if (ch != '\r' && n < cap - 1) line[n++] = ch;
+    }
+    line[n] = 0;
+    return n;
+}
+
+// ---- request / response ----
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t c, int write_len)
+{
+    // an unread body would be parsed as the next response
+    if (c->fd >= 0 && c->body != BODY_NONE && c->body != BODY_DONE) esp_http_client_close(c);
+    if (c->fd < 0) {
+        if (!sock_connect(c)) {
+            ESP_LOGE(TAG, "Connect to %s:%s failed", c->host, c->port);
+            return ESP_ERR_HTTP_CONNECT;
+        }
+        dispatch(c, HTTP_EVENT_ON_CONNECTED, NULL, 0, NULL, NULL);
+    }
+
+    static const char *methods[] = {"GET", "POST", "PUT", "PATCH", "DELETE", "HEAD"};
+    char req[2048];
+    int n = snprintf(req, sizeof(req), "%s %s HTTP/1.1\r\nHost: %s:%s\r\nUser-Agent: rigo-host\r\n",
+                     methods[c->method], c->path, c->host, c->port);
+    for (int i = 0; i < MAX_HEADERS && n < (int)sizeof(req); i++) {
+        if (c->hdr_key[i]) n += snprintf(req + n, sizeof(req) - n, "%s: %s\r\n", c->hdr_key[i], c->hdr_val[i]);
+    }
+    if (n < (int)sizeof(req)) {
+        if (write_len < 0) n += snprintf(req + n, sizeof(req) - n, "Transfer-Encoding: chunked\r\n\r\n");
+        else n += snprintf(req + n, sizeof(req) - n, "Content-Length: %d\r\n\r\n", write_len);
+    }
+    if (n >= (int)sizeof(req)) return ESP_ERR_INVALID_SIZE;
+
+    c->status = 0;
+    c->content_length = -1;
+    c->chunked = false;
+    c->conn_close = false;
+    c->body = BODY_NONE;
+    if (!sock_send(c, req, n)) {
+        esp_http_client_close(c);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    dispatch(c, HTTP_EVENT_HEADERS_SENT, NULL, 0, NULL, NULL);
+    return ESP_OK;
+}
+
+int esp_http_client_write(esp_http_client_handle_t c, const char *buffer, int len)
+{
+    if (c->fd < 0) return -1;
+    return sock_send(c, buffer, len) ? len : -1;
+}
+
+static void finish_body(esp_http_client_handle_t c)
+{
+    c->body = BODY_DONE;
+    if (c->conn_close) esp_http_client_close(c);
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t c)
+{
+    if (c->fd < 0) return -1;
+    // Like esp_http_client, a timeout before the response starts leaves the
+    // request intact and the call can be repeated. Headers arrive in one
+    // piece, so only the wait for the first byte is resumable here.
+    if (c->rx_off == c->rx_len) {
+        struct pollfd pfd = {.fd = c->fd, .events = POLLIN};
+        int p;
+        while ((p = poll(&pfd, 1, c->timeout_ms)) < 0 && errno == EINTR) {
+        }
+        if (p == 0) return -ESP_ERR_HTTP_EAGAIN;
+    }
+    char line[1024];
+    int r = read_line(c, line, sizeof(line));
+    if (r < 0) return r == RD_TIMEOUT ? -ESP_ERR_HTTP_EAGAIN : -1;
+    if (strncmp(line, "HTTP/1.", 7) != 0 || strlen(line) < 12) return -1;
+    c->status = atoi(line + 9);
+    c->conn_close = line[7] == '0';
+
+    while ((r = read_line(c, line, sizeof(line))) > 0) {
+        char *colon = strchr(line, ':');
+        if (!colon) continue;
+        *colon = 0;
+        char *value = colon + 1;
+        while (*value == ' ') value++;
+        if (strcasecmp(line, "Content-Length") == 0) c->content_length = strtoll(value, NULL, 10);
+        else if (strcasecmp(line, "Transfer-Encoding") == 0 && strcasestr(value, "chunked")) c->chunked = true;
+        else if (strcasecmp(line, "Connection") == 0) c->conn_close = strcasecmp(value, "close") == 0;
+        dispatch(c, HTTP_EVENT_ON_HEADER, NULL, 0, line, value);
+    }
+    if (r < 0) return -1;
+
+    if (c->method == HTTP_METHOD_HEAD || c->status == 204 || c->status == 304 || c->status < 200) {
+        finish_body(c);
+    } else if (c->chunked) {
+        c->content_length = -1;
+        c->body = BODY_CHUNK_SIZE;
+    } else if (c->content_length >= 0) {
+        c->left = c->content_length;
+        c->body = BODY_LEN;
+        if (c->left == 0) finish_body(c);
+    } else {
+        c->body = BODY_UNTIL_CLOSE;
+        c->conn_close = true;
+    }
+    // like esp_http_client: 0 when the length is not known up front
+    return c->content_length > 0 ? c->content_length : 0;
+}
+
+static int take(esp_http_client_handle_t c, char *out, int max)
+{
+    int n = c->rx_len - c->rx_off;
+    if (n > max) n = max;
+    memcpy(out, c->rx + c->rx_off, n);
+    c->rx_off += n;
+    return n;
+}
+
+// Next piece of body data: >0 bytes, 0 at the end of the body.
+static int next_body(esp_http_client_handle_t c, char *out, int max)
+{
+    char line[64];
+    while (1) {
+        int r;
+        switch (c->body) {
+        case BODY_LEN:
+            if ((r = rx_fill(c)) <= 0) return r == 0 ? RD_ERROR : r;
+            r = take(c, out, c->left < max ? (int)c->left : max);
+            c->left -= r;
+            if (c->left == 0) finish_body(c);
+            return r;
+        case BODY_CHUNK_SIZE:
+            if ((r = read_line(c, line, sizeof(line))) < 0) return r;
+            c->left = strtoll(line, NULL, 16);
+            if (c->left > 0) {
+                c->body = BODY_CHUNK_DATA;
+                break;
+            }
+            while ((r = read_line(c, line, sizeof(line))) > 0) {
+            }
+            if (r < 0) return r;
+            finish_body(c);
+            return 0;
+        case BODY_CHUNK_DATA:
+            if ((r = rx_fill(c)) <= 0) return r == 0 ? RD_ERROR : r;
+            r = take(c, out, c->left < max ? (int)c->left : max);
+            c->left -= r;
+            if (c->left == 0) c->body = BODY_CHUNK_END;
+            return r;
+        case BODY_CHUNK_END:
+            if ((r = read_line(c, line, sizeof(line))) < 0) return r;
+            c->body = BODY_CHUNK_SIZE;
+            break;
+        case BODY_UNTIL_CLOSE:
+            if ((r = rx_fill(c)) < 0) return r;
+            if (r == 0) {
+                finish_body(c);
+                return 0;
+            }
+            return take(c, out, max);
+        default:
+            return 0;
+        }
+    }
+}
+
+// Fills the buffer unless the body ends first, as esp_http_client_read does.
+int esp_http_client_read(esp_http_client_handle_t c, char *buffer, int len)
+{
+    int got = 0;
+    while (got < len) {
+        int r = next_body(c, buffer + got, len - got);
+        if (r == 0) break;
+        if (r < 0) {
+            if (got > 0) break;
+            return r == RD_TIMEOUT ? -ESP_ERR_HTTP_EAGAIN : -1;
+        }
+        dispatch(c, HTTP_EVENT_ON_DATA, buffer + got, r, NULL, NULL);
+        got += r;
+    }
+    return got;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t c)
+{
+    esp_err_t err = esp_http_client_open(c, c->post_len);
+    if (err != ESP_OK) return err;
+    if (c->post_len > 0 && esp_http_client_write(c, c->post_data, c->post_len) != c->post_len) {
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    int64_t n = esp_http_client_fetch_headers(c);
+    if (n == -ESP_ERR_HTTP_EAGAIN) return ESP_ERR_HTTP_EAGAIN;
+    if (n < 0) return ESP_ERR_HTTP_FETCH_HEADER;
+
+    char buf[1024];
+    int r;
+    while ((r = next_body(c, buf, sizeof(buf))) > 0) dispatch(c, HTTP_EVENT_ON_DATA, buf, r, NULL, NULL);
+    if (r < 0) return r == RD_TIMEOUT ? ESP_ERR_HTTP_EAGAIN : ESP_FAIL;
+    dispatch(c, HTTP_EVENT_ON_FINISH, NULL, 0, NULL, NULL);
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t c)
+{
+    return c->status;
+}
+
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t c)
+{
+    return c->content_length;
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t c)
+{
+    return c->chunked;
+}
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t c)
+{
+    return c->body == BODY_DONE;
+}
@@ -0,0 +1,123 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+
+// ---- esp_timer ----
+
+int64_t esp_timer_get_time(void)
+{
+    static int64_t t0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if (!t0) t0 = now - 1;
+    return now - t0;
+}
+
+// ---- esp_log ----
+
+static esp_log_level_t log_level(void)
+{
+    static esp_log_level_t level;
+    if (!level) {
+        const char *env = getenv("RIGO_LOG");
+        const char c = env && *env ? *env : 'I';
+        level = c == 'E' ? ESP_LOG_ERROR : c == 'W' ? ESP_LOG_WARN : c == 'D' ? ESP_LOG_DEBUG :
+                c == 'V' ? ESP_LOG_VERBOSE : c == 'N' ? ESP_LOG_NONE : ESP_LOG_INFO;
+    }
+    return level;
+}
+
+void host_log(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+    if (level > log_level()) return;
+    static pthread_mutex_t m = PTHREAD_MUTEX_INITIALIZER;
+    static const char letters[] = "NEWIDV";
+    pthread_mutex_lock(&m);
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&m);
+}
+
+// ---- esp_err ----
+
+const char *esp_err_to_name(esp_err_t err)
+{
+    switch (err) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_HTTP_CONNECT: return "ESP_ERR_HTTP_CONNECT";
+    case ESP_ERR_HTTP_EAGAIN: return "ESP_ERR_HTTP_EAGAIN";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+// ---- esp_partition ----
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    (void)type;
+    (void)subtype;
+    (void)label;
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *p, size_t off, void *dst, size_t size)
+{
+    (void)p;
+    (void)off;
+    (void)dst;
+    (void)size;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *p, size_t off, const void *src, size_t size)
+{
+    (void)p;
+    (void)off;
+    (void)src;
+    (void)size;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *p, size_t off, size_t size)
+{
+    (void)p;
+    (void)off;
+    (void)size;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+// ---- esp_rom_crc ----
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    }
+    return ~crc;
+}
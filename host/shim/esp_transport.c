@@ -0,0 +1,336 @@
+#include "esp_transport.h"
+#include "esp_transport_ssl.h"
+#include "esp_transport_tcp.h"
+#include "esp_transport_ws.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+
+static const char *TAG = "transport";
+
+#define RX_SIZE 4096
+
+struct esp_transport_item_t {
+    esp_transport_handle_t parent;  // WebSocket: the TCP transport below
+    int fd;
+    char rx[RX_SIZE];
+    int rx_off;
+    int rx_len;
+
+    // WebSocket
+    char *path;
+    char *headers;
+    ws_transport_opcodes_t opcode;
+    int payload_len;
+    int left;                       // unread payload of the current frame
+};
+
+static esp_transport_handle_t item_new(void)
+{
+    esp_transport_handle_t t = calloc(1, sizeof(*t));
+    if (t) t->fd = -1;
+    return t;
+}
+
+// ---- TCP ----
+
+esp_transport_handle_t esp_transport_tcp_init(void)
+{
+    return item_new();
+}
+
+esp_transport_handle_t esp_transport_ssl_init(void)
+{
+    ESP_LOGE(TAG, "TLS is not supported in the host build");
+    return NULL;
+}
+
+void esp_transport_ssl_crt_bundle_attach(esp_transport_handle_t t, esp_err_t ((*crt_bundle_attach)(void *conf)))
+{
+}
+
+static int tcp_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    char service[8];
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    struct addrinfo *res;
+    if (getaddrinfo(host, service, &hints, &res) != 0) return -1;
+    for (struct addrinfo *ai = res; ai && t->fd < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        struct timeval tv = {.tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) t->fd = fd;
+        else close(fd);
+    }
+    freeaddrinfo(res);
+    t->rx_off = t->rx_len = 0;
+    return t->fd >= 0 ? 0 : -1;
+}
+
+static bool tcp_send(esp_transport_handle_t t, const char *data, int len)
+{
+    while (len > 0) {
+        ssize_t n = send(t->fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static int tcp_poll(esp_transport_handle_t t, int timeout_ms)
+{
+    if (t->fd < 0) return -1;
+    if (t->rx_off < t->rx_len) return 1;
+    struct pollfd p = {.fd = t->fd, .events = POLLIN};
+    int r;
+    do {
+        r = poll(&p, 1, timeout_ms);
+    } while (r < 0 && errno == EINTR);
+    return r < 0 ? -1 : r > 0;
+}
+
+// Up to len buffered or freshly received bytes: >0, 0 timeout, -1 error or EOF.
+static int tcp_read(esp_transport_handle_t t, char *out, int len, int timeout_ms)
+{
+    if (t->rx_off == t->rx_len) {
+        int p = tcp_poll(t, timeout_ms);
+        if (p <= 0) return p;
+        ssize_t n;
+        do {
+            n = recv(t->fd, t->rx, sizeof(t->rx), 0);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) return -1;
+        t->rx_off = 0;
+        t->rx_len = (int)n;
+    }
+    int n = t->rx_len - t->rx_off;
+    if (n > len) n = len;
+    memcpy(out, t->rx + t->rx_off, n);
+    t->rx_off += n;
+    return n;
+}
+
+// Exactly len bytes or -1.
+static int tcp_read_all(esp_transport_handle_t t, void *out, int len, int timeout_ms)
+{
+    for (int got = 0; got < len;) {
+        int n = tcp_read(t, (char *)out + got, len - got, timeout_ms);
+        if (n <= 0) return -1;
+        got += n;
+    }
+    return len;
+}
+
+// ---- WebSocket ----
+
+esp_transport_handle_t esp_transport_ws_init(esp_transport_handle_t parent_handle)
+{
+    esp_transport_handle_t t = item_new();
+    if (!t) return NULL;
+    t->parent = parent_handle;
+    t->path = strdup("/");
+    t->opcode = WS_TRANSPORT_OPCODES_NONE;
+    return t;
+}
+
+esp_err_t esp_transport_ws_set_path(esp_transport_handle_t t, const char *path)
+{
+    free(t->path);
+    t->path = strdup(path);
+    return t->path ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_transport_ws_set_headers(esp_transport_handle_t t, const char *headers)
+{
+    free(t->headers);
+    t->headers = headers ? strdup(headers) : NULL;
+    return ESP_OK;
+}
+
+static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static int ws_handshake(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    // the key only has to be unique; the server's accept hash is not checked
+    unsigned char nonce[16];
+    for (int i = 0; i < 16; i++) nonce[i] = rand() & 0xff;
+    char key[25];
+    int k = 0;
+    for (int i = 0; i < 16; i += 3) {
+        uint32_t v = nonce[i] << 16 | (i + 1 < 16 ? nonce[i + 1] << 8 : 0) | (i + 2 < 16 ? nonce[i + 2] : 0);
+        key[k++] = b64[v >> 18 & 63];
+        key[k++] = b64[v >> 12 & 63];
+        key[k++] = i + 1 < 16 ? b64[v >> 6 & 63] : '=';
+        key[k++] = i + 2 < 16 ? b64[v & 63] : '=';
+    }
+    key[k] = 0;
+
+    char req[1024];
+    int n = snprintf(req, sizeof(req),
+                     "GET %s HTTP/1.1\r\nHost: %s:%d\r\nUser-Agent: rigo-host\r\nUpgrade: websocket\r\n"
+                     "Connection: Upgrade\r\nSec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n%s\r\n",
+                     t->path, host, port, key, t->headers ? t->headers : "");
+    if (n >= (int)sizeof(req) || !tcp_send(t->parent, req, n)) return -1;
+
+    // status line and headers; frame bytes behind them stay buffered
+    char line[256];
+    int len = 0, status = 0;
+    bool first = true;
+    while (1) {
+        char ch;
+        if (tcp_read(t->parent, &ch, 1, timeout_ms) <= 0) return -1;
+        if (ch != '\n') {
+            if (ch != '\r' && len < (int)sizeof(line) - 1) line[len++] = ch;
+            continue;
+        }
+        line[len] = 0;
+        if (len == 0) break;
+        if (first) sscanf(line, "HTTP/%*s %d", &status);
+        first = false;
+        len = 0;
+    }
+    if (status != 101) {
+        ESP_LOGE(TAG, "WebSocket upgrade refused: HTTP %d", status);
+        return -1;
+    }
+    return 0;
+}
+
+int esp_transport_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    if (!t->parent) return tcp_connect(t, host, port, timeout_ms);
+    t->opcode = WS_TRANSPORT_OPCODES_NONE;
+    t->payload_len = t->left = 0;
+    if (tcp_connect(t->parent, host, port, timeout_ms) < 0) return -1;
+    if (ws_handshake(t, host, port, timeout_ms) < 0) {
+        esp_transport_close(t);
+        return -1;
+    }
+    return 0;
+}
+
+int esp_transport_ws_send_raw(esp_transport_handle_t t, ws_transport_opcodes_t opcode, const char *b, int len,
+                              int timeout_ms)
+{
+    esp_transport_handle_t tcp = t->parent;
+    if (!tcp || tcp->fd < 0) return -1;
+    unsigned char hdr[14];
+    int n = 0;
+    hdr[n++] = opcode & 0xff;
+    if (len < 126) {
+        hdr[n++] = 0x80 | len;
+    } else if (len < 65536) {
+        hdr[n++] = 0x80 | 126;
+        hdr[n++] = len >> 8;
+        hdr[n++] = len & 0xff;
+    } else {
+        hdr[n++] = 0x80 | 127;
+        for (int i = 7; i >= 0; i--) hdr[n++] = i < 4 ? (uint32_t)len >> (8 * i) & 0xff : 0;
+    }
+    unsigned char *mask = hdr + n;
+    for (int i = 0; i < 4; i++) hdr[n++] = rand() & 0xff;
+
+    char *body = malloc(n + len);
+    if (!body) return -1;
+    memcpy(body, hdr, n);
+    for (int i = 0; i < len; i++) body[n + i] = b[i] ^ mask[i & 3];
+    bool ok = tcp_send(tcp, body, n + len);
+    free(body);
+    return ok ? len : -1;
+}
+
+// Next frame header; pings are answered here and show up as empty frames.
+static int ws_read_header(esp_transport_handle_t t, int timeout_ms)
+{
+    unsigned char h[2];
+    int n = tcp_read(t->parent, (char *)h, 1, timeout_ms);
+    if (n <= 0) return n;
+    if (tcp_read_all(t->parent, h + 1, 1, timeout_ms) < 0) return -1;
+    uint64_t len = h[1] & 0x7f;
+    if (len >= 126) {
+        unsigned char ext[8];
+        const int w = len == 126 ? 2 : 8;
+        if (tcp_read_all(t->parent, ext, w, timeout_ms) < 0) return -1;
+        len = 0;
+        for (int i = 0; i < w; i++) len = len << 8 | ext[i];
+    }
+    if (h[1] & 0x80 || len > INT32_MAX) {
+        ESP_LOGE(TAG, "Bad frame from server");
+        return -1;
+    }
+    t->opcode = h[0] & 0x0f;
+    t->payload_len = t->left = (int)len;
+    if (t->opcode == WS_TRANSPORT_OPCODES_PING) {
+        char ping[125];
+        if (len > sizeof(ping) || tcp_read_all(t->parent, ping, (int)len, timeout_ms) < 0) return -1;
+        t->left = 0;
+        esp_transport_ws_send_raw(t, WS_TRANSPORT_OPCODES_PONG | WS_TRANSPORT_OPCODES_FIN, ping, (int)len,
+                                  timeout_ms);
+    }
+    return 1;
+}
+
+int esp_transport_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    if (!t->parent) return tcp_read(t, buffer, len, timeout_ms);
+    if (t->left == 0) {
+        int r = ws_read_header(t, timeout_ms);
+        if (r <= 0) return r;
+        if (t->left == 0) return 0;
+    }
+    int n = tcp_read(t->parent, buffer, len < t->left ? len : t->left, timeout_ms);
+    if (n > 0) t->left -= n;
+    return n;
+}
+
+int esp_transport_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    if (!t->parent) return tcp_poll(t, timeout_ms);
+    return tcp_poll(t->parent, timeout_ms);
+}
+
+ws_transport_opcodes_t esp_transport_ws_get_read_opcode(esp_transport_handle_t t)
+{
+    return t->opcode;
+}
+
+int esp_transport_ws_get_read_payload_len(esp_transport_handle_t t)
+{
+    return t->payload_len;
+}
+
+int esp_transport_close(esp_transport_handle_t t)
+{
+    if (t->parent) return esp_transport_close(t->parent);
+    if (t->fd >= 0) close(t->fd);
+    t->fd = -1;
+    t->rx_off = t->rx_len = 0;
+    return 0;
+}
+
+esp_err_t esp_transport_destroy(esp_transport_handle_t t)
+{
+    if (!t) return ESP_OK;
+    esp_transport_close(t);
+    free(t->path);
+    free(t->headers);
+    free(t);
+    return ESP_OK;
+}
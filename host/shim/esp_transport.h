@@ -0,0 +1,18 @@
+#pragma once
+
+// Host shim: the esp_transport API the streaming STT client uses, over POSIX
+// sockets. TCP and WebSocket (client side) only; no TLS.
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+typedef struct esp_transport_item_t *esp_transport_handle_t;
+
+// 0 on success, -1 on failure
+int esp_transport_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms);
+// Bytes read (of the current WebSocket frame's payload), 0 on timeout, <0 on error or EOF.
+int esp_transport_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms);
+// 1 readable, 0 timeout, -1 error
+int esp_transport_poll_read(esp_transport_handle_t t, int timeout_ms);
+int esp_transport_close(esp_transport_handle_t t);
+esp_err_t esp_transport_destroy(esp_transport_handle_t t);
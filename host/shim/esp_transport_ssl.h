@@ -0,0 +1,7 @@
+#pragma once
+
+#include "esp_transport.h"
+
+// TLS is not supported in the host build: always NULL.
+esp_transport_handle_t esp_transport_ssl_init(void);
+void esp_transport_ssl_crt_bundle_attach(esp_transport_handle_t t, esp_err_t ((*crt_bundle_attach)(void *conf)));
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "esp_transport.h"
+
+esp_transport_handle_t esp_transport_tcp_init(void);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "esp_transport.h"
+
+typedef enum ws_transport_opcodes {
+    WS_TRANSPORT_OPCODES_CONT = 0x00,
+    WS_TRANSPORT_OPCODES_TEXT = 0x01,
+    WS_TRANSPORT_OPCODES_BINARY = 0x02,
+    WS_TRANSPORT_OPCODES_CLOSE = 0x08,
+    WS_TRANSPORT_OPCODES_PING = 0x09,
+    WS_TRANSPORT_OPCODES_PONG = 0x0a,
+    WS_TRANSPORT_OPCODES_FIN = 0x80,
+    WS_TRANSPORT_OPCODES_NONE = 0x100,
+} ws_transport_opcodes_t;
+
+// Wraps a TCP transport; connect performs the opening handshake.
+esp_transport_handle_t esp_transport_ws_init(esp_transport_handle_t parent_handle);
+esp_err_t esp_transport_ws_set_path(esp_transport_handle_t t, const char *path);
+// Extra "Key: value\r\n" lines for the handshake request; copied.
+esp_err_t esp_transport_ws_set_headers(esp_transport_handle_t t, const char *headers);
+// One masked client frame; opcode may carry WS_TRANSPORT_OPCODES_FIN. Returns len or -1.
+int esp_transport_ws_send_raw(esp_transport_handle_t t, ws_transport_opcodes_t opcode, const char *b, int len,
+                              int timeout_ms);
+ws_transport_opcodes_t esp_transport_ws_get_read_opcode(esp_transport_handle_t t);
+int esp_transport_ws_get_read_payload_len(esp_transport_handle_t t);
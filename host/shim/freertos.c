@@ -0,0 +1,473 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "freertos/task.h"
+
+#include "esp_timer.h"
+
+// ---- waiting ----
+
+static void cond_init(pthread_cond_t *c)
+{
+    pthread_condattr_t a;
+    pthread_condattr_init(&a);
+    pthread_condattr_setclock(&a, CLOCK_MONOTONIC);
+    pthread_cond_init(c, &a);
+    pthread_condattr_destroy(&a);
+}
+
+static struct timespec deadline(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+// Waits on c (m held); false once the tick budget is spent.
+static bool wait_until(pthread_cond_t *c, pthread_mutex_t *m, TickType_t ticks, const struct timespec *dl)
+{
+    if (ticks == 0) return false;
+    if (ticks == portMAX_DELAY) return pthread_cond_wait(c, m) == 0;
+    return pthread_cond_timedwait(c, m, dl) != ETIMEDOUT;
+}
+
+// ---- critical sections ----
+
+static pthread_mutex_t crit;
+static pthread_once_t crit_once = PTHREAD_ONCE_INIT;
+
+static void crit_init(void)
+{
+    pthread_mutexattr_t a;
+    pthread_mutexattr_init(&a);
+    pthread_mutexattr_settype(&a, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&crit, &a);
+    pthread_mutexattr_destroy(&a);
+}
+
+void host_critical_enter(void)
+{
+    pthread_once(&crit_once, crit_init);
+    pthread_mutex_lock(&crit);
+}
+
+void host_critical_exit(void)
+{
+    pthread_mutex_unlock(&crit);
+}
+
+// ---- tasks ----
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    char name[16];
+    UBaseType_t prio;
+    BaseType_t core;
+    pthread_mutex_t m;
+    pthread_cond_t c;
+    uint32_t notify;
+    struct host_task *next;
+};
+
+static __thread struct host_task *self;
+static struct host_task *tasks;     // every task ever created; tasks never exit here
+static UBaseType_t task_count;
+static pthread_mutex_t tasks_m = PTHREAD_MUTEX_INITIALIZER;
+
+static void task_register(struct host_task *t)
+{
+    pthread_mutex_lock(&tasks_m);
+    t->next = tasks;
+    tasks = t;
+    task_count++;
+    pthread_mutex_unlock(&tasks_m);
+}
+
+static struct host_task *task_new(void)
+{
+    struct host_task *t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    pthread_mutex_init(&t->m, NULL);
+    cond_init(&t->c);
+    return t;
+}
+
+static void *task_entry(void *arg)
+{
+    self = arg;
+    self->fn(self->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *out, BaseType_t core)
+{
+    (void)stack_depth;
+    struct host_task *t = task_new();
+    if (!t) return pdFAIL;
+    t->fn = fn;
+    t->arg = arg;
+    t->prio = prio;
+    t->core = core;
+    strncpy(t->name, name ? name : "", sizeof(t->name) - 1);
+    if (out) *out = t;
+    pthread_attr_t a;
+    pthread_attr_init(&a);
+    pthread_attr_setdetachstate(&a, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&t->thread, &a, task_entry, t);
+    pthread_attr_destroy(&a);
+    if (rc != 0) {
+        if (out) *out = NULL;
+        free(t);
+        return pdFAIL;
+    }
+    pthread_setname_np(t->thread, t->name);
+    task_register(t);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == self) pthread_exit(NULL);
+    // deleting another task is not supported on the host
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = {.tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    // threads not created through the shim (main) get a handle on first use
+    if (!self) {
+        self = task_new();
+        self->thread = pthread_self();
+        self->core = tskNO_AFFINITY;
+        strcpy(self->name, "main");
+        task_register(self);
+    }
+    return self;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    pthread_mutex_lock(&tasks_m);
+    UBaseType_t n = task_count;
+    pthread_mutex_unlock(&tasks_m);
+    return n;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *out, UBaseType_t max, configRUN_TIME_COUNTER_TYPE *total)
+{
+    UBaseType_t n = 0;
+    pthread_mutex_lock(&tasks_m);
+    for (struct host_task *t = tasks; t && n < max; t = t->next, n++) {
+        struct timespec ts = {0};
+        clockid_t cid;
+        if (pthread_getcpuclockid(t->thread, &cid) == 0) clock_gettime(cid, &ts);
+        out[n] = (TaskStatus_t){
+            .xHandle = t,
+            .pcTaskName = t->name,
+            .xTaskNumber = n,
+            .eCurrentState = eBlocked,
+            .uxCurrentPriority = t->prio,
+            .uxBasePriority = t->prio,
+            .ulRunTimeCounter = (configRUN_TIME_COUNTER_TYPE)ts.tv_sec * 1000000 + ts.tv_nsec / 1000,
+            .xCoreID = t->core,
+        };
+    }
+    pthread_mutex_unlock(&tasks_m);
+    if (total) *total = (configRUN_TIME_COUNTER_TYPE)esp_timer_get_time();
+    return n;
+}
+
+TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t core)
+{
+    (void)core;
+    return NULL;
+}
+
+BaseType_t xTaskGetCoreID(TaskHandle_t task)
+{
+    return task->core;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t t)
+{
+    pthread_mutex_lock(&t->m);
+    t->notify++;
+    pthread_cond_signal(&t->c);
+    pthread_mutex_unlock(&t->m);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct host_task *t = xTaskGetCurrentTaskHandle();
+    struct timespec dl = deadline(ticks);
+    pthread_mutex_lock(&t->m);
+    while (t->notify == 0 && wait_until(&t->c, &t->m, ticks, &dl)) {
+    }
+    uint32_t v = t->notify;
+    if (v) t->notify = clear_on_exit ? 0 : v - 1;
+    pthread_mutex_unlock(&t->m);
+    return v;
+}
+
+// ---- queues and semaphores ----
+
+struct host_queue {
+    pthread_mutex_t m;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    size_t item_size;
+    UBaseType_t len;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t *items;
+};
+
+static QueueHandle_t queue_new(UBaseType_t len, UBaseType_t item_size, UBaseType_t initial)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+    if (!q) return NULL;
+    q->item_size = item_size;
+    q->len = len;
+    q->count = initial;
+    if (item_size) {
+        q->items = calloc(len, item_size);
+        if (!q->items) {
+            free(q);
+            return NULL;
+        }
+    }
+    pthread_mutex_init(&q->m, NULL);
+    cond_init(&q->not_empty);
+    cond_init(&q->not_full);
+    return q;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size)
+{
+    return queue_new(len, item_size, 0);
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    if (!q) return;
+    pthread_mutex_destroy(&q->m);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+    free(q->items);
+    free(q);
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    struct timespec dl = deadline(ticks);
+    pthread_mutex_lock(&q->m);
+    while (q->count == q->len) {
+        if (!wait_until(&q->not_full, &q->m, ticks, &dl)) {
+            pthread_mutex_unlock(&q->m);
+            return pdFALSE;
+        }
+    }
+    if (q->item_size) memcpy(q->items + ((q->head + q->count) % q->len) * q->item_size, item, q->item_size);
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->m);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    struct timespec dl = deadline(ticks);
+    pthread_mutex_lock(&q->m);
+    while (q->count == 0) {
+        if (!wait_until(&q->not_empty, &q->m, ticks, &dl)) {
+            pthread_mutex_unlock(&q->m);
+            return pdFALSE;
+        }
+    }
+    if (q->item_size) {
+        memcpy(item, q->items + q->head * q->item_size, q->item_size);
+        q->head = (q->head + 1) % q->len;
+    }
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->m);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->m);
+    UBaseType_t n = q->count;
+    pthread_mutex_unlock(&q->m);
+    return n;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->m);
+    q->count = 0;
+    q->head = 0;
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->m);
+    return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return queue_new(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return queue_new(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    return queue_new(max, 0, initial);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+    return xQueueReceive(s, NULL, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+    return xQueueSend(s, NULL, 0);
+}
+
+// ---- stream buffers ----
+
+struct host_stream {
+    pthread_mutex_t m;
+    pthread_cond_t readable;
+    pthread_cond_t writable;
+    size_t size;
+    size_t trigger;
+    size_t head;
+    size_t used;
+    uint8_t *buf;
+};
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger_level)
+{
+    struct host_stream *sb = calloc(1, sizeof(*sb));
+    if (!sb) return NULL;
+    sb->buf = malloc(size);
+    if (!sb->buf) {
+        free(sb);
+        return NULL;
+    }
+    sb->size = size;
+    sb->trigger = trigger_level ? trigger_level : 1;
+    pthread_mutex_init(&sb->m, NULL);
+    cond_init(&sb->readable);
+    cond_init(&sb->writable);
+    return sb;
+}
+
+void vStreamBufferDelete(StreamBufferHandle_t sb)
+{
+    if (!sb) return;
+    pthread_mutex_destroy(&sb->m);
+    pthread_cond_destroy(&sb->readable);
+    pthread_cond_destroy(&sb->writable);
+    free(sb->buf);
+    free(sb);
+}
+
+// Like FreeRTOS: waits for room for the whole write (capped at the buffer
+// size), then writes what fits once the wait ends.
+size_t xStreamBufferSend(StreamBufferHandle_t sb, const void *data, size_t len, TickType_t ticks)
+{
+    struct timespec dl = deadline(ticks);
+    size_t want = len < sb->size ? len : sb->size;
+    pthread_mutex_lock(&sb->m);
+    while (sb->size - sb->used < want && wait_until(&sb->writable, &sb->m, ticks, &dl)) {
+    }
+    size_t n = sb->size - sb->used;
+    if (n > len) n = len;
+    size_t tail = (sb->head + sb->used) % sb->size;
+    size_t first = sb->size - tail < n ? sb->size - tail : n;
+    memcpy(sb->buf + tail, data, first);
+    memcpy(sb->buf, (const uint8_t *)data + first, n - first);
+    sb->used += n;
+    if (n) pthread_cond_broadcast(&sb->readable);
+    pthread_mutex_unlock(&sb->m);
+    return n;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t sb, void *data, size_t len, TickType_t ticks)
+{
+    struct timespec dl = deadline(ticks);
+    size_t want = len < sb->trigger ? len : sb->trigger;
+    pthread_mutex_lock(&sb->m);
+    while (sb->used < want && wait_until(&sb->readable, &sb->m, ticks, &dl)) {
+    }
+    size_t n = sb->used < len ? sb->used : len;
+    size_t first = sb->size - sb->head < n ? sb->size - sb->head : n;
+    memcpy(data, sb->buf + sb->head, first);
+    memcpy((uint8_t *)data + first, sb->buf, n - first);
+    sb->head = (sb->head + n) % sb->size;
+    sb->used -= n;
+    if (n) pthread_cond_broadcast(&sb->writable);
+    pthread_mutex_unlock(&sb->m);
+    return n;
+}
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t sb)
+{
+    pthread_mutex_lock(&sb->m);
+    size_t n = sb->used;
+    pthread_mutex_unlock(&sb->m);
+    return n;
+}
+
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t sb)
+{
+    pthread_mutex_lock(&sb->m);
+    size_t n = sb->size - sb->used;
+    pthread_mutex_unlock(&sb->m);
+    return n;
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t sb)
+{
+    pthread_mutex_lock(&sb->m);
+    sb->head = 0;
+    sb->used = 0;
+    pthread_cond_broadcast(&sb->writable);
+    pthread_mutex_unlock(&sb->m);
+    return pdPASS;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_stream *StreamBufferHandle_t;
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger_level);
+static inline StreamBufferHandle_t xStreamBufferCreateWithCaps(size_t size, size_t trigger_level, uint32_t caps)
+{
+    (void)caps;
+    return xStreamBufferCreate(size, trigger_level);
+}
+
+void vStreamBufferDelete(StreamBufferHandle_t sb);
+size_t xStreamBufferSend(StreamBufferHandle_t sb, const void *data, size_t len, TickType_t ticks);
+size_t xStreamBufferReceive(StreamBufferHandle_t sb, void *data, size_t len, TickType_t ticks);
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t sb);
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t sb);
+BaseType_t xStreamBufferReset(StreamBufferHandle_t sb);
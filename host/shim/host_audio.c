@@ -0,0 +1,132 @@
+#include "host_audio.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_timer.h"
+
+#define MAX_LAG_US 100000
+
+struct host_codec {
+    bool is_mic;
+    const int16_t *pcm;
+    int samples;
+    int pos;
+    uint32_t bytes_per_sec;
+    int64_t t0;
+    uint64_t paced_bytes;
+    host_speaker_stats_t stats;
+};
+
+static double speed = 1.0;
+
+void host_audio_set_speed(double s)
+{
+    speed = s > 0 ? s : 1.0;
+}
+
+static void sleep_until(int64_t t_us)
+{
+    int64_t d = t_us - esp_timer_get_time();
+    if (d <= 0) return;
+    struct timespec ts = {.tv_sec = d / 1000000, .tv_nsec = (d % 1000000) * 1000};
+    nanosleep(&ts, NULL);
+}
+
+static void pace(esp_codec_dev_handle_t d, int len)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t due = d->t0 + (int64_t)(d->paced_bytes * 1e6 / d->bytes_per_sec / speed);
+    if (!d->t0 || now - due > MAX_LAG_US) {
+        d->t0 = now;
+        d->paced_bytes = 0;
+    }
+    d->paced_bytes += len;
+    sleep_until(d->t0 + (int64_t)(d->paced_bytes * 1e6 / d->bytes_per_sec / speed));
+}
+
+esp_codec_dev_handle_t host_mic_create(const int16_t *pcm, int samples)
+{
+    esp_codec_dev_handle_t d = calloc(1, sizeof(*d));
+    if (!d) return NULL;
+    d->is_mic = true;
+    d->pcm = pcm;
+    d->samples = samples;
+    d->bytes_per_sec = 16000 * 2;
+    return d;
+}
+
+void host_mic_rewind(esp_codec_dev_handle_t mic)
+{
+    mic->pos = 0;
+    mic->t0 = 0;
+}
+
+esp_codec_dev_handle_t host_speaker_create(void)
+{
+    esp_codec_dev_handle_t d = calloc(1, sizeof(*d));
+    if (d) d->bytes_per_sec = 16000 * 2;
+    return d;
+}
+
+void host_speaker_get_stats(esp_codec_dev_handle_t spk, host_speaker_stats_t *out)
+{
+    *out = spk->stats;
+}
+
+int esp_codec_dev_open(esp_codec_dev_handle_t d, esp_codec_dev_sample_info_t *fs)
+{
+    if (!d || !fs || !fs->sample_rate) return ESP_CODEC_DEV_INVALID_ARG;
+    d->bytes_per_sec = fs->sample_rate * (fs->channel ? fs->channel : 1) * (fs->bits_per_sample / 8);
+    d->t0 = 0;
+    if (!d->is_mic) {
+        d->stats.opens++;
+        d->stats.first_write_us = 0;
+    }
+    return ESP_CODEC_DEV_OK;
+}
+
+int esp_codec_dev_close(esp_codec_dev_handle_t d)
+{
+    return d ? ESP_CODEC_DEV_OK : ESP_CODEC_DEV_INVALID_ARG;
+}
+
+int esp_codec_dev_read(esp_codec_dev_handle_t d, void *data, int len)
+{
+    if (!d || !d->is_mic) return ESP_CODEC_DEV_INVALID_ARG;
+    int n = len / 2;
+    int have = d->samples - d->pos;
+    if (have > n) have = n;
+    if (have > 0) {
+        memcpy(data, d->pcm + d->pos, have * 2);
+        d->pos += have;
+    } else {
+        have = 0;
+    }
+    memset((int16_t *)data + have, 0, (n - have) * 2);
+    pace(d, len);
+    return ESP_CODEC_DEV_OK;
+}
+
+int esp_codec_dev_write(esp_codec_dev_handle_t d, void *data, int len)
+{
+    (void)data;
+    if (!d || d->is_mic) return ESP_CODEC_DEV_INVALID_ARG;
+    if (!d->stats.first_write_us) d->stats.first_write_us = esp_timer_get_time();
+    d->stats.bytes += len;
+    pace(d, len);
+    return ESP_CODEC_DEV_OK;
+}
+
+int esp_codec_dev_set_out_vol(esp_codec_dev_handle_t d, int volume)
+{
+    (void)volume;
+    return d ? ESP_CODEC_DEV_OK : ESP_CODEC_DEV_INVALID_ARG;
+}
+
+int esp_codec_dev_set_in_gain(esp_codec_dev_handle_t d, float db)
+{
+    (void)db;
+    return d ? ESP_CODEC_DEV_OK : ESP_CODEC_DEV_INVALID_ARG;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_codec_dev.h"
+
+// Both devices run on a wall clock scaled by host_audio_set_speed(): a read or
+// write returns when that much audio would have passed through real I2S. A
+// caller that falls behind does not get a catch-up burst, like a DMA ring
+// that has overrun.
+void host_audio_set_speed(double speed);
+
+// Mic replaying 16 kHz mono PCM16 from the start of every host_mic_rewind;
+// silence once the clip has run out. The clip is not copied.
+esp_codec_dev_handle_t host_mic_create(const int16_t *pcm, int samples);
+void host_mic_rewind(esp_codec_dev_handle_t mic);
+
+typedef struct {
+    uint32_t opens;
+    uint64_t bytes;
+    int64_t first_write_us;     // since the last open
+} host_speaker_stats_t;
+
+esp_codec_dev_handle_t host_speaker_create(void);
+void host_speaker_get_stats(esp_codec_dev_handle_t spk, host_speaker_stats_t *out);
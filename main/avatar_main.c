@@ -28,6 +28,19 @@
 
 #include "cJSON.h"
 
+#include "rigo_afe.h"
+#include "rigo_cmd.h"
+#include "rigo_conn.h"
+#include "rigo_metrics.h"
+#include "rigo_mic.h"
+#include "rigo_pipeline.h"
+#include "rigo_player.h"
+#include "rigo_power.h"
+#include "rigo_tasks.h"
+#include "rigo_timeline.h"
+#include "rigo_tts_cache.h"
+#include "rigo_tts_pipe.h"
+
 typedef enum {
     FACE_HAPPY = 0,
     FACE_SAD,
@@ -51,13 +64,20 @@ static portMUX_TYPE state_mux = portMUX_INITIALIZER_UNLOCKED;
 static face_expr_t desired_expr = FACE_HAPPY;
 static bool desired_talk = false;
 static int64_t talk_until_us = 0;
-
-static face_expr_t current_expr = FACE_HAPPY;
-static bool eyes_closed = false;
-static int talk_phase = 0;
+static uint8_t desired_mouth;       // viseme opening from /v1/ws, 0..255
+static int64_t mouth_until_us = 0;
 
 static esp_codec_dev_handle_t mic_dev;
 static esp_codec_dev_handle_t spk_dev;
+static httpd_handle_t http_server;
+
+// /v1/ws subscribers and frame stream
+#define WS_MAX_CLIENTS 4
+#define WS_MAX_FRAME 512
+#define WS_MOUTH_HOLD_MS 200    // an external viseme holds this long without a refresh
+static int ws_fds[WS_MAX_CLIENTS] = {-1, -1, -1, -1};
+static uint32_t ws_updates;
+static uint32_t ws_pushed_state = UINT32_MAX;   // expr | talk << 8, last sent to subscribers
 
 static const char *expr_to_str(face_expr_t e)
 {
@@ -81,110 +101,285 @@ static face_expr_t str_to_expr(const char *s)
     return FACE_NEUTRAL;
 }
 
-static void set_brows(int y_left_in, int y_left_out, int y_right_in, int y_right_out)
+// What the face shows, in screen units. Each frame builds the model from the
+// live state and render() touches only the objects whose fields changed, so
+// an idle face costs LVGL no invalidation at all.
+typedef struct {
+    face_expr_t expr;           // the label
+    int16_t brows[4];           // y: left inner, left outer, right inner, right outer
+    int16_t mouth_start, mouth_end, mouth_y;
+    int16_t eye_h;
+} face_model_t;
+
+static const struct {
+    const char *label;
+    int16_t brows[4];
+    int16_t mouth_start, mouth_end, mouth_y;
+} expr_base[FACE_COUNT] = {
+    [FACE_HAPPY] = {"rigo: happy", {82, 78, 82, 78}, 25, 155, 145},
+    [FACE_SAD] = {"rigo: sad", {78, 82, 78, 82}, 205, 335, 165},
+    [FACE_PUZZLED] = {"rigo: puzzled", {75, 90, 85, 72}, 350, 30, 160},
+    [FACE_ANGRY] = {"rigo: angry", {95, 70, 95, 70}, 350, 20, 165},
+    [FACE_NEUTRAL] = {"rigo: listening", {80, 80, 80, 80}, 0, 180, 165},
+};
+
+// canned talk cycle when no audio or viseme drives the mouth
+static const int16_t talk_phases[4][3] = {{5, 175, 144}, {25, 155, 150}, {10, 170, 146}, {20, 160, 148}};
+
+#define FRAME_MS 40
+#define TALK_PHASE_MS 130
+#define BLINK_PERIOD_MS 2800
+#define BLINK_CLOSED_MS 160
+#define EYE_H 44
+#define EYE_H_CLOSED 5
+
+static face_model_t shown;      // what LVGL currently has
+static bool shown_valid;
+static int env_open;            // smoothed playback envelope
+static uint32_t frame_period = FRAME_MS;    // CONFIG_RIGO_IDLE_FRAME_MS while idle and quiet
+
+typedef struct {
+    uint32_t frames;
+    uint32_t obj_updates;       // LVGL setter calls issued by render()
+    uint64_t frame_us;
+    uint32_t frame_max_us;
+    uint32_t refreshes;         // display refreshes that flushed something
+    uint64_t refresh_us;
+    uint32_t refresh_max_us;
+    uint32_t flushes;
+    uint64_t flush_px;
+    uint64_t invalidated_px;
+} ui_stats_t;
+
+// WakeNet cost per chunk, split by power mode (the idle clock is lower)
+typedef struct {
+    uint32_t chunks;
+    uint64_t detect_us;
+    uint32_t detect_max_us;
+} wake_stats_t;
+
+static portMUX_TYPE stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static ui_stats_t ui_stats;
+static wake_stats_t wake_stats[2];     // [rigo_power_idle()]
+static int wake_chunk_us;
+static int64_t refr_start_us;
+static bool refr_flushed;
+
+static void model_expr(face_model_t *m, face_expr_t expr)
 {
-    brow_l_pts[0].x = 95;  brow_l_pts[0].y = y_left_out;
-    brow_l_pts[1].x = 145; brow_l_pts[1].y = y_left_in;
+    m->expr = expr;
+    memcpy(m->brows, expr_base[expr].brows, sizeof(m->brows));
+    m->mouth_start = expr_base[expr].mouth_start;
+    m->mouth_end = expr_base[expr].mouth_end;
+    m->mouth_y = expr_base[expr].mouth_y;
+}
 
-    brow_r_pts[0].x = 175; brow_r_pts[0].y = y_right_in;
-    brow_r_pts[1].x = 225; brow_r_pts[1].y = y_right_out;
+static void model_mouth_open(face_model_t *m, int open)
+{
+    int spread = open * 20 / 255;
+    m->mouth_start = 25 - spread;
+    m->mouth_end = 155 + spread;
+    m->mouth_y = 150 - open * 8 / 255;
+}
 
-    lv_line_set_points(brow_l, brow_l_pts, 2);
-    lv_line_set_points(brow_r, brow_r_pts, 2);
+static int eye_height(int open)
+{
+    return EYE_H_CLOSED + open * (EYE_H - EYE_H_CLOSED) / 255;
 }
 
-static void set_mouth_arc(int start, int end, int y)
+static void set_brow(lv_obj_t *line, lv_point_precise_t *pts, int x0, int y0, int x1, int y1)
 {
-    lv_obj_set_pos(mouth, 110, y);
-    lv_arc_set_bg_angles(mouth, start, end);
-    lv_arc_set_value(mouth, 0);
+    pts[0].x = x0; pts[0].y = y0;
+    pts[1].x = x1; pts[1].y = y1;
+    lv_line_set_points(line, pts, 2);
 }
 
-static void set_expression(face_expr_t expr)
-{
-    current_expr = expr;
-
-    switch (expr) {
-    case FACE_HAPPY:
-        set_brows(82, 78, 82, 78);
-        set_mouth_arc(25, 155, 145);
-        lv_label_set_text(label, "rigo: happy");
-        break;
-    case FACE_SAD:
-        set_brows(78, 82, 78, 82);
-        set_mouth_arc(205, 335, 165);
-        lv_label_set_text(label, "rigo: sad");
-        break;
-    case FACE_PUZZLED:
-        set_brows(75, 90, 85, 72);
-        set_mouth_arc(350, 30, 160);
-        lv_label_set_text(label, "rigo: puzzled");
-        break;
-    case FACE_ANGRY:
-        set_brows(95, 70, 95, 70);
-        set_mouth_arc(350, 20, 165);
-        lv_label_set_text(label, "rigo: angry");
-        break;
-    case FACE_NEUTRAL:
-    default:
-        set_brows(80, 80, 80, 80);
-        set_mouth_arc(0, 180, 165);
-        lv_label_set_text(label, "rigo: listening");
-        break;
-    }
-}
-
-static void update_talk_mouth(bool talking)
-{
-    if (!talking) {
-        set_expression(current_expr);
-        return;
-    }
+// Returns the number of LVGL setters called.
+static int render(const face_model_t *m)
+{
+    const face_model_t *s = &shown;
+    bool all = !shown_valid;
+    int n = 0;
 
-    talk_phase = (talk_phase + 1) % 4;
-    int y = 150;
-    switch (talk_phase) {
-        case 0: lv_arc_set_bg_angles(mouth, 20, 160); y = 148; break;
-        case 1: lv_arc_set_bg_angles(mouth, 5, 175);  y = 144; break;
-        case 2: lv_arc_set_bg_angles(mouth, 25, 155); y = 150; break;
-        default: lv_arc_set_bg_angles(mouth, 10, 170); y = 146; break;
+    if (all || m->expr != s->expr) {
+        lv_label_set_text_static(label, expr_base[m->expr].label);
+        n++;
     }
-    lv_obj_set_y(mouth, y);
+    if (all || m->brows[0] != s->brows[0] || m->brows[1] != s->brows[1]) {
+        set_brow(brow_l, brow_l_pts, 95, m->brows[1], 145, m->brows[0]);
+        n++;
+    }
+    if (all || m->brows[2] != s->brows[2] || m->brows[3] != s->brows[3]) {
+        set_brow(brow_r, brow_r_pts, 175, m->brows[2], 225, m->brows[3]);
+        n++;
+    }
+    if (all || m->mouth_start != s->mouth_start || m->mouth_end != s->mouth_end) {
+        lv_arc_set_bg_angles(mouth, m->mouth_start, m->mouth_end);
+        n++;
+    }
+    if (all || m->mouth_y != s->mouth_y) {
+        lv_obj_set_y(mouth, m->mouth_y);
+        n++;
+    }
+    if (all || m->eye_h != s->eye_h) {
+        int py = (EYE_H - m->eye_h) / 2;
+        lv_obj_set_size(eye_l, EYE_H, m->eye_h);
+        lv_obj_set_size(eye_r, EYE_H, m->eye_h);
+        lv_obj_align(eye_l, LV_ALIGN_TOP_LEFT, 85, 95 + py);
+        lv_obj_align(eye_r, LV_ALIGN_TOP_LEFT, 190, 95 + py);
+        n += 4;
+        bool pupils = m->eye_h > eye_height(64);
+        if (all || pupils != (s->eye_h > eye_height(64))) {
+            lv_obj_set_style_opa(pupil_l, pupils ? LV_OPA_100 : LV_OPA_0, 0);
+            lv_obj_set_style_opa(pupil_r, pupils ? LV_OPA_100 : LV_OPA_0, 0);
+            n += 2;
+        }
+    }
+    shown = *m;
+    shown_valid = true;
+    return n;
 }
 
-static void blink_cb(lv_timer_t *t)
+static void ws_push_work(void *arg)
 {
-    (void)t;
-    int h = eyes_closed ? 44 : 5;
-    int py = eyes_closed ? 10 : 0;
-
-    lv_obj_set_size(eye_l, 44, h);
-    lv_obj_set_size(eye_r, 44, h);
-    lv_obj_align(eye_l, LV_ALIGN_TOP_LEFT, 85, 95 + py);
-    lv_obj_align(eye_r, LV_ALIGN_TOP_LEFT, 190, 95 + py);
-
-    lv_obj_set_style_opa(pupil_l, eyes_closed ? LV_OPA_0 : LV_OPA_100, 0);
-    lv_obj_set_style_opa(pupil_r, eyes_closed ? LV_OPA_0 : LV_OPA_100, 0);
+    uint32_t st = (uint32_t)(uintptr_t)arg;
+    char out[64];
+    httpd_ws_frame_t f = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)out,
+        .len = snprintf(out, sizeof(out), "{\"emotion\":\"%s\",\"talk\":%s}", expr_to_str(st & 0xff),
+                        (st >> 8) ? "true" : "false"),
+    };
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (ws_fds[i] < 0) continue;
+        // a closed socket, or its fd reused by plain HTTP, drops out here
+        if (httpd_ws_get_fd_info(http_server, ws_fds[i]) != HTTPD_WS_CLIENT_WEBSOCKET ||
+            httpd_ws_send_frame_async(http_server, ws_fds[i], &f) != ESP_OK) {
+            ws_fds[i] = -1;
+        }
+    }
+}
 
-    eyes_closed = !eyes_closed;
+// From the frame timer: subscribers get the visible state whenever it changes.
+static void ws_notify(face_expr_t expr, bool talk)
+{
+    uint32_t st = expr | (talk ? 1u << 8 : 0);
+    if (st == ws_pushed_state || !http_server) return;
+    ws_pushed_state = st;
+    httpd_queue_work(http_server, ws_push_work, (void *)(uintptr_t)st);
 }
 
-static void avatar_tick_cb(lv_timer_t *t)
+// The only UI timer: live state, timeline, lipsync and blink into one model.
+static void frame_cb(lv_timer_t *t)
 {
-    (void)t;
+    int64_t t0 = esp_timer_get_time();
     face_expr_t expr;
     bool talk;
+    int ext = -1;
 
     portENTER_CRITICAL(&state_mux);
     expr = desired_expr;
-    int64_t now = esp_timer_get_time();
-    talk = desired_talk || (talk_until_us > now);
+    talk = desired_talk || (talk_until_us > t0);
+    if (mouth_until_us > t0) ext = desired_mouth;
     portEXIT_CRITICAL(&state_mux);
 
-    if (expr != current_expr) {
-        set_expression(expr);
+    rigo_pose_t pose;
+    if (!rigo_timeline_sample(t0, &pose)) pose.mask = 0;
+
+    face_model_t m;
+    model_expr(&m, (pose.mask & RIGO_POSE_EXPR) ? (face_expr_t)pose.expr : expr);
+    if (pose.mask & RIGO_POSE_BROWS) memcpy(m.brows, pose.brows, sizeof(m.brows));
+
+    // mouth: timeline, then playback envelope, then /v1/ws viseme, then the
+    // canned talk cycle; otherwise the expression's arc stands
+    uint8_t level, peak;
+    bool playing = rigo_player_envelope(&level, &peak);
+    if (!playing) env_open = 0;
+    if (pose.mask & RIGO_POSE_MOUTH) {
+        model_mouth_open(&m, pose.mouth);
+    } else if (playing) {
+        // fast attack, slower release reads as jaw movement rather than flicker
+        int target = (level * 3 + peak) / 4;
+        env_open = target > env_open ? target : env_open - (env_open - target + 2) / 3;
+        model_mouth_open(&m, env_open);
+    } else if (ext >= 0) {
+        model_mouth_open(&m, ext);
+    } else if (talk) {
+        const int16_t *p = talk_phases[(t0 / (TALK_PHASE_MS * 1000)) % 4];
+        m.mouth_start = p[0];
+        m.mouth_end = p[1];
+        m.mouth_y = p[2];
+    }
+
+    // one blink per period, on the wall clock; a timeline with eyes keys pauses it.
+    // Closed for at least one frame, so slow idle frames still show it
+    if (pose.mask & RIGO_POSE_EYES) {
+        m.eye_h = eye_height(pose.eyes);
+    } else {
+        m.eye_h = (t0 / 1000) % BLINK_PERIOD_MS < MAX(BLINK_CLOSED_MS, frame_period) ? EYE_H_CLOSED : EYE_H;
+    }
+
+    int updates = render(&m);
+    ws_notify(expr, talk);
+
+    // nothing moves but the blink between turns: fewer frames
+    const bool quiet = rigo_power_idle() && !pose.mask && !playing && ext < 0 && !talk;
+    const uint32_t period = quiet ? CONFIG_RIGO_IDLE_FRAME_MS : FRAME_MS;
+    if (period != frame_period) {
+        frame_period = period;
+        lv_timer_set_period(t, period);
+    }
+
+    uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+    portENTER_CRITICAL(&stats_mux);
+    ui_stats.frames++;
+    ui_stats.obj_updates += updates;
+    ui_stats.frame_us += us;
+    if (us > ui_stats.frame_max_us) ui_stats.frame_max_us = us;
+    portEXIT_CRITICAL(&stats_mux);
+}
+
+static uint32_t area_px(const lv_area_t *a)
+{
+    return (uint32_t)(a->x2 - a->x1 + 1) * (uint32_t)(a->y2 - a->y1 + 1);
+}
+
+// Display refresh cost: how long LVGL spends per refresh that draws
+// anything, and how many pixels go out over SPI.
+static void display_event_cb(lv_event_t *e)
+{
+    const lv_area_t *area = lv_event_get_param(e);
+    switch (lv_event_get_code(e)) {
+        case LV_EVENT_REFR_START:
+            refr_start_us = esp_timer_get_time();
+            refr_flushed = false;
+            break;
+        case LV_EVENT_INVALIDATE_AREA:
+            portENTER_CRITICAL(&stats_mux);
+            ui_stats.invalidated_px += area_px(area);
+            portEXIT_CRITICAL(&stats_mux);
+            break;
+        case LV_EVENT_FLUSH_START:
+            refr_flushed = true;
+            portENTER_CRITICAL(&stats_mux);
+            ui_stats.flushes++;
+            ui_stats.flush_px += area_px(area);
+            portEXIT_CRITICAL(&stats_mux);
+            break;
+        case LV_EVENT_REFR_READY:
+            if (refr_flushed) {
+                uint32_t us = (uint32_t)(esp_timer_get_time() - refr_start_us);
+                portENTER_CRITICAL(&stats_mux);
+                ui_stats.refreshes++;
+                ui_stats.refresh_us += us;
+                if (us > ui_stats.refresh_max_us) ui_stats.refresh_max_us = us;
+                portEXIT_CRITICAL(&stats_mux);
+            }
+            break;
+        default:
+            break;
     }
-    update_talk_mouth(talk);
 }
 
 static void avatar_set(face_expr_t expr, bool talk, int duration_ms)
@@ -233,6 +428,8 @@ static esp_err_t perform_post_handler(httpd_req_t *req)
     const cJSON *talk = cJSON_GetObjectItemCaseSensitive(root, "talk");
     const cJSON *duration_ms = cJSON_GetObjectItemCaseSensitive(root, "duration_ms");
 
+    const int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&state_mux);
     if (cJSON_IsString(emotion)) {
         desired_expr = str_to_expr(emotion->valuestring);
     }
@@ -240,17 +437,237 @@ static esp_err_t perform_post_handler(httpd_req_t *req)
         desired_talk = cJSON_IsTrue(talk);
     }
     if (cJSON_IsNumber(duration_ms) && duration_ms->valuedouble > 0) {
-        talk_until_us = esp_timer_get_time() + (int64_t)(duration_ms->valuedouble * 1000.0);
+        talk_until_us = now + (int64_t)(duration_ms->valuedouble * 1000.0);
     }
+    portEXIT_CRITICAL(&state_mux);
 
     cJSON_Delete(root);
     return send_json(req, 200, "{\"ok\":true}");
 }
 
+static int expr_index(const char *name)
+{
+    return str_to_expr(name);
+}
+
+// A whole utterance's animation in one request; see rigo_timeline.h.
+static esp_err_t timeline_post_handler(httpd_req_t *req)
+{
+    const size_t max_body = CONFIG_RIGO_TIMELINE_MAX_KEYS * 128;
+    if (req->content_len == 0 || req->content_len > max_body) {
+        return send_json(req, 400, "{\"ok\":false,\"error\":\"body size\"}");
+    }
+    char *buf = heap_caps_malloc(req->content_len + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "no memory");
+    int got = 0;
+    while (got < (int)req->content_len) {
+        int n = httpd_req_recv(req, buf + got, req->content_len - got);
+        if (n <= 0) {
+            free(buf);
+            return ESP_FAIL;
+        }
+        got += n;
+    }
+    buf[got] = '\0';
+    cJSON *root = cJSON_Parse(buf);
+    free(buf);
+    if (!root) return send_json(req, 400, "{\"ok\":false,\"error\":\"invalid JSON\"}");
+
+    const char *err = NULL;
+    int n = rigo_timeline_load(root, expr_index, &err);
+    cJSON_Delete(root);
+    char out[96];
+    if (n < 0) {
+        snprintf(out, sizeof(out), "{\"ok\":false,\"error\":\"%s\"}", err);
+        return send_json(req, 400, out);
+    }
+    snprintf(out, sizeof(out), "{\"ok\":true,\"keyframes\":%d,\"duration_ms\":%u}", n,
+             (unsigned)rigo_timeline_duration_ms());
+    return send_json(req, 200, out);
+}
+
+static void metrics_emit(const char *data, int len, void *ctx)
+{
+    httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+static esp_err_t metrics_get_handler(httpd_req_t *req)
+{
+    // GET /metrics is the Prometheus text format, GET /v1/metrics is JSON
+    bool prom = strcmp(req->uri, "/metrics") == 0;
+    httpd_resp_set_type(req, prom ? "text/plain; version=0.0.4" : "application/json");
+    if (prom) {
+        rigo_metrics_write_prometheus(metrics_emit, req);
+    } else {
+        rigo_metrics_write_json(metrics_emit, req);
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static esp_err_t tasks_get_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    rigo_tasks_write_json(metrics_emit, req);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static esp_err_t display_get_handler(httpd_req_t *req)
+{
+    ui_stats_t st;
+    portENTER_CRITICAL(&stats_mux);
+    st = ui_stats;
+    portEXIT_CRITICAL(&stats_mux);
+
+    char out[384];
+    snprintf(out, sizeof(out),
+             "{\"uptime_ms\":%llu,\"frame_ms\":%d,\"frames\":%u,\"frame_us_avg\":%u,\"frame_us_max\":%u,"
+             "\"obj_updates\":%u,\"refreshes\":%u,\"refresh_us_avg\":%u,\"refresh_us_max\":%u,"
+             "\"flushes\":%u,\"flush_px\":%llu,\"flush_bytes\":%llu,\"invalidated_px\":%llu}",
+             (unsigned long long)(esp_timer_get_time() / 1000), (int)frame_period, (unsigned)st.frames,
+             st.frames ? (unsigned)(st.frame_us / st.frames) : 0, (unsigned)st.frame_max_us,
+             (unsigned)st.obj_updates, (unsigned)st.refreshes,
+             st.refreshes ? (unsigned)(st.refresh_us / st.refreshes) : 0, (unsigned)st.refresh_max_us,
+             (unsigned)st.flushes, (unsigned long long)st.flush_px,
+             (unsigned long long)(st.flush_px * (LV_COLOR_DEPTH / 8)), (unsigned long long)st.invalidated_px);
+    return send_json(req, 200, out);
+}
+
+static int wake_json(char *out, int cap, const char *mode, const wake_stats_t *w)
+{
+    const unsigned avg = w->chunks ? (unsigned)(w->detect_us / w->chunks) : 0;
+    return snprintf(out, cap, "\"%s\":{\"chunks\":%u,\"detect_us_avg\":%u,\"detect_us_max\":%u,\"load_pct\":%u}",
+                    mode, (unsigned)w->chunks, avg, (unsigned)w->detect_max_us,
+                    wake_chunk_us ? avg * 100 / wake_chunk_us : 0);
+}
+
+// Idle power mode and the WakeNet duty cycle; CPU per task is in /v1/tasks
+// and LVGL cost in /v1/display.
+static esp_err_t power_get_handler(httpd_req_t *req)
+{
+    rigo_power_stats_t ps;
+    rigo_power_get_stats(&ps);
+    wake_stats_t w[2];
+    portENTER_CRITICAL(&stats_mux);
+    memcpy(w, wake_stats, sizeof(w));
+    portEXIT_CRITICAL(&stats_mux);
+
+    char out[640];
+    int n = snprintf(out, sizeof(out),
+                     "{\"enabled\":%s,\"dfs\":%s,\"mode\":\"%s\",\"cpu_mhz\":%u,\"idle_entries\":%u,\"idle_ms\":%llu,"
+                     "\"active_ms\":%llu,\"ramp_us_last\":%u,\"ramp_us_max\":%u,\"frame_ms\":%d,"
+                     "\"wakenet\":{\"chunk_us\":%d,",
+                     ps.enabled ? "true" : "false", ps.dfs ? "true" : "false", ps.idle ? "idle" : "active", (unsigned)ps.cpu_mhz,
+                     (unsigned)ps.idle_entries, (unsigned long long)ps.idle_ms, (unsigned long long)ps.active_ms,
+                     (unsigned)ps.ramp_us_last, (unsigned)ps.ramp_us_max, (int)frame_period, wake_chunk_us);
+    n += wake_json(out + n, sizeof(out) - n, "active", &w[0]);
+    out[n++] = ',';
+    n += wake_json(out + n, sizeof(out) - n, "idle", &w[1]);
+    snprintf(out + n, sizeof(out) - n, "}}");
+    return send_json(req, 200, out);
+}
+
+// Binary /v1/ws frames carry 4-byte records:
+// {flags, expression, mouth 0..255, talk duration in 20 ms units}.
+#define WS_F_EXPR 0x01
+#define WS_F_TALK 0x02      // talk = WS_F_TALK_ON
+#define WS_F_TALK_ON 0x04
+#define WS_F_MOUTH 0x08
+
+static void ws_apply(int expr, int talk, int mouth, int duration_ms)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&state_mux);
+    if (expr >= 0) desired_expr = expr;
+    if (talk >= 0) desired_talk = talk;
+    if (duration_ms > 0) talk_until_us = now + (int64_t)duration_ms * 1000;
+    if (mouth >= 0) {
+        desired_mouth = mouth;
+        mouth_until_us = now + WS_MOUTH_HOLD_MS * 1000;
+    }
+    portEXIT_CRITICAL(&state_mux);
+    ws_updates++;
+}
+
+static void ws_binary(const uint8_t *p, size_t len)
+{
+    for (; len >= 4; p += 4, len -= 4) {
+        uint8_t fl = p[0];
+        ws_apply((fl & WS_F_EXPR) && p[1] < FACE_COUNT ? p[1] : -1, (fl & WS_F_TALK) ? !!(fl & WS_F_TALK_ON) : -1,
+                 (fl & WS_F_MOUTH) ? p[2] : -1, p[3] * 20);
+    }
+}
+
+// Text frames: the /v1/perform object plus "mouth" (0..255). "sync" is
+// answered with the number of updates applied so far, so a client can time
+// a burst end to end.
+static esp_err_t ws_text(httpd_req_t *req, const char *buf)
+{
+    cJSON *root = cJSON_Parse(buf);
+    if (!root) return ESP_OK;
+    const cJSON *emotion = cJSON_GetObjectItemCaseSensitive(root, "emotion");
+    const cJSON *talk = cJSON_GetObjectItemCaseSensitive(root, "talk");
+    const cJSON *duration_ms = cJSON_GetObjectItemCaseSensitive(root, "duration_ms");
+    const cJSON *mouth = cJSON_GetObjectItemCaseSensitive(root, "mouth");
+    const cJSON *sync = cJSON_GetObjectItemCaseSensitive(root, "sync");
+    if (cJSON_IsString(emotion) || cJSON_IsBool(talk) || cJSON_IsNumber(duration_ms) || cJSON_IsNumber(mouth)) {
+        ws_apply(cJSON_IsString(emotion) ? (int)str_to_expr(emotion->valuestring) : -1,
+                 cJSON_IsBool(talk) ? cJSON_IsTrue(talk) : -1,
+                 cJSON_IsNumber(mouth) ? MAX(0, MIN(255, mouth->valueint)) : -1,
+                 cJSON_IsNumber(duration_ms) ? duration_ms->valueint : 0);
+    }
+    esp_err_t err = ESP_OK;
+    if (cJSON_IsNumber(sync)) {
+        char out[64];
+        httpd_ws_frame_t f = {
+            .final = true,
+            .type = HTTPD_WS_TYPE_TEXT,
+            .payload = (uint8_t *)out,
+            .len = snprintf(out, sizeof(out), "{\"sync\":%d,\"updates\":%u}", sync->valueint,
+                            (unsigned)ws_updates),
+        };
+        err = httpd_ws_send_frame(req, &f);
+    }
+    cJSON_Delete(root);
+    return err;
+}
+
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        // handshake: subscribe to state pushes
+        int fd = httpd_req_to_sockfd(req);
+        for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+            if (ws_fds[i] < 0 || httpd_ws_get_fd_info(req->handle, ws_fds[i]) != HTTPD_WS_CLIENT_WEBSOCKET) {
+                ws_fds[i] = fd;
+                ws_pushed_state = UINT32_MAX;   // the newcomer gets the current state on the next tick
+                return ESP_OK;
+            }
+        }
+        ESP_LOGW(TAG, "WebSocket client limit (%d) reached", WS_MAX_CLIENTS);
+        return ESP_FAIL;
+    }
+
+    static uint8_t buf[WS_MAX_FRAME + 1];
+    httpd_ws_frame_t f = {.payload = buf};
+    esp_err_t err = httpd_ws_recv_frame(req, &f, 0);
+    if (err != ESP_OK) return err;
+    if (f.len > WS_MAX_FRAME) return ESP_ERR_INVALID_SIZE;  // closes the connection
+    err = httpd_ws_recv_frame(req, &f, WS_MAX_FRAME);
+    if (err != ESP_OK) return err;
+    if (f.type == HTTPD_WS_TYPE_BINARY) {
+        ws_binary(buf, f.len);
+    } else if (f.type == HTTPD_WS_TYPE_TEXT) {
+        buf[f.len] = '\0';
+        err = ws_text(req, (const char *)buf);
+    }
+    return err;
+}
+
 static httpd_handle_t start_http_service(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 8080;
+    config.max_uri_handlers = 12;
 
     httpd_handle_t server = NULL;
     if (httpd_start(&server, &config) != ESP_OK) {
@@ -260,11 +677,26 @@ static httpd_handle_t start_http_service(void)
 
     httpd_uri_t u_state = {.uri = "/v1/state", .method = HTTP_GET, .handler = state_get_handler};
     httpd_uri_t u_perform = {.uri = "/v1/perform", .method = HTTP_POST, .handler = perform_post_handler};
+    httpd_uri_t u_metrics = {.uri = "/v1/metrics", .method = HTTP_GET, .handler = metrics_get_handler};
+    httpd_uri_t u_prom = {.uri = "/metrics", .method = HTTP_GET, .handler = metrics_get_handler};
+    httpd_uri_t u_tasks = {.uri = "/v1/tasks", .method = HTTP_GET, .handler = tasks_get_handler};
+    httpd_uri_t u_timeline = {.uri = "/v1/timeline", .method = HTTP_POST, .handler = timeline_post_handler};
+    httpd_uri_t u_display = {.uri = "/v1/display", .method = HTTP_GET, .handler = display_get_handler};
+    httpd_uri_t u_power = {.uri = "/v1/power", .method = HTTP_GET, .handler = power_get_handler};
+    httpd_uri_t u_ws = {.uri = "/v1/ws", .method = HTTP_GET, .handler = ws_handler, .is_websocket = true};
 
     httpd_register_uri_handler(server, &u_state);
     httpd_register_uri_handler(server, &u_perform);
+    httpd_register_uri_handler(server, &u_metrics);
+    httpd_register_uri_handler(server, &u_prom);
+    httpd_register_uri_handler(server, &u_tasks);
+    httpd_register_uri_handler(server, &u_timeline);
+    httpd_register_uri_handler(server, &u_display);
+    httpd_register_uri_handler(server, &u_power);
+    httpd_register_uri_handler(server, &u_ws);
 
     ESP_LOGI(TAG, "HTTP service ready on port 8080");
+    http_server = server;
     return server;
 }
 
@@ -304,6 +736,9 @@ static void start_network(void)
         strncpy((char *)sta_config.sta.ssid, CONFIG_RIGO_WIFI_STA_SSID, sizeof(sta_config.sta.ssid) - 1);
         strncpy((char *)sta_config.sta.password, CONFIG_RIGO_WIFI_STA_PASSWORD, sizeof(sta_config.sta.password) - 1);
         sta_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+#if CONFIG_RIGO_IDLE_POWER
+        sta_config.sta.listen_interval = CONFIG_RIGO_IDLE_LISTEN_INTERVAL;
+#endif
         ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sta_config));
     }
 
@@ -313,208 +748,48 @@ static void start_network(void)
     }
 }
 
-typedef struct {
-    uint8_t *data;
-    int len;
-} mem_resp_t;
-
-static esp_err_t http_evt(esp_http_client_event_t *evt)
-{
-    mem_resp_t *m = (mem_resp_t *)evt->user_data;
-    if (evt->event_id == HTTP_EVENT_ON_DATA && evt->data_len > 0 && m) {
-        uint8_t *n = realloc(m->data, m->len + evt->data_len + 1);
-        if (!n) return ESP_FAIL;
-        m->data = n;
-        memcpy(m->data + m->len, evt->data, evt->data_len);
-        m->len += evt->data_len;
-        m->data[m->len] = 0;
-    }
-    return ESP_OK;
-}
-
-static void set_auth_header(esp_http_client_handle_t c)
-{
-    if (strlen(CONFIG_RIGO_API_BEARER) > 0) {
-        char auth[256];
-        snprintf(auth, sizeof(auth), "Bearer %s", CONFIG_RIGO_API_BEARER);
-        esp_http_client_set_header(c, "Authorization", auth);
-    }
-}
-
-static uint8_t *build_wav(const int16_t *pcm, int bytes, int sample_rate, int channels, int *out_len)
-{
-    const int total = 44 + bytes;
-    uint8_t *wav = malloc(total);
-    if (!wav) return NULL;
-
-    memcpy(wav, "RIFF", 4);
-    *(uint32_t *)(wav + 4) = total - 8;
-    memcpy(wav + 8, "WAVEfmt ", 8);
-    *(uint32_t *)(wav + 16) = 16;
-    *(uint16_t *)(wav + 20) = 1;
-    *(uint16_t *)(wav + 22) = channels;
-    *(uint32_t *)(wav + 24) = sample_rate;
-    *(uint32_t *)(wav + 28) = sample_rate * channels * 2;
-    *(uint16_t *)(wav + 32) = channels * 2;
-    *(uint16_t *)(wav + 34) = 16;
-    memcpy(wav + 36, "data", 4);
-    *(uint32_t *)(wav + 40) = bytes;
-    memcpy(wav + 44, pcm, bytes);
-    *out_len = total;
-    return wav;
-}
-
-static char *cloud_stt(const int16_t *pcm, int bytes)
-{
-    if (strlen(CONFIG_RIGO_STT_URL) == 0) return NULL;
-    int wav_len = 0;
-    uint8_t *wav = build_wav(pcm, bytes, 16000, 1, &wav_len);
-    if (!wav) return NULL;
-
-    mem_resp_t out = {0};
-    esp_http_client_config_t cfg = {
-        .url = CONFIG_RIGO_STT_URL,
-        .method = HTTP_METHOD_POST,
-        .event_handler = http_evt,
-        .user_data = &out,
-        .timeout_ms = 20000,
-    };
-    esp_http_client_handle_t c = esp_http_client_init(&cfg);
-    esp_http_client_set_header(c, "Content-Type", "audio/wav");
-    set_auth_header(c);
-    esp_http_client_set_post_field(c, (const char *)wav, wav_len);
-    esp_err_t err = esp_http_client_perform(c);
-    free(wav);
-
-    if (err != ESP_OK) {
-        esp_http_client_cleanup(c);
-        free(out.data);
-        return NULL;
-    }
-
-    cJSON *r = cJSON_Parse((char *)out.data);
-    char *txt = NULL;
-    if (r) {
-        cJSON *t = cJSON_GetObjectItemCaseSensitive(r, "text");
-        if (cJSON_IsString(t) && t->valuestring && strlen(t->valuestring) > 0) {
-            txt = strdup(t->valuestring);
-        }
-        cJSON_Delete(r);
-    }
-
-    esp_http_client_cleanup(c);
-    free(out.data);
-    return txt;
+static void player_event(bool playing)
+{
+    // an uploaded timeline with "start":"audio" runs from the first sample
+    if (playing) rigo_timeline_audio_started(esp_timer_get_time());
+    avatar_set(FACE_HAPPY, playing, 0);
 }
 
-static char *cloud_assistant(const char *user_text)
+static void turn_captured(void)
 {
-    if (strlen(CONFIG_RIGO_ASSISTANT_URL) == 0 || !user_text) return NULL;
-    cJSON *req = cJSON_CreateObject();
-    cJSON_AddStringToObject(req, "text", user_text);
-    char *body = cJSON_PrintUnformatted(req);
-    cJSON_Delete(req);
-
-    mem_resp_t out = {0};
-    esp_http_client_config_t cfg = {
-        .url = CONFIG_RIGO_ASSISTANT_URL,
-        .method = HTTP_METHOD_POST,
-        .event_handler = http_evt,
-        .user_data = &out,
-        .timeout_ms = 20000,
-    };
-    esp_http_client_handle_t c = esp_http_client_init(&cfg);
-    esp_http_client_set_header(c, "Content-Type", "application/json");
-    set_auth_header(c);
-    esp_http_client_set_post_field(c, body, strlen(body));
-    free(body);
-
-    esp_err_t err = esp_http_client_perform(c);
-    if (err != ESP_OK) {
-        esp_http_client_cleanup(c);
-        free(out.data);
-        return NULL;
-    }
-
-    cJSON *r = cJSON_Parse((char *)out.data);
-    char *txt = NULL;
-    if (r) {
-        cJSON *t = cJSON_GetObjectItemCaseSensitive(r, "reply");
-        if (!cJSON_IsString(t)) t = cJSON_GetObjectItemCaseSensitive(r, "text");
-        if (cJSON_IsString(t) && t->valuestring && strlen(t->valuestring) > 0) {
-            txt = strdup(t->valuestring);
-        }
-        cJSON_Delete(r);
-    }
-
-    esp_http_client_cleanup(c);
-    free(out.data);
-    return txt;
+    avatar_set(FACE_NEUTRAL, false, 0);
 }
 
-static uint8_t *cloud_tts(const char *text, int *audio_len)
+static void turn_done(uint32_t turn)
 {
-    if (strlen(CONFIG_RIGO_TTS_URL) == 0 || !text) return NULL;
-    cJSON *req = cJSON_CreateObject();
-    cJSON_AddStringToObject(req, "text", text);
-    char *body = cJSON_PrintUnformatted(req);
-    cJSON_Delete(req);
-
-    mem_resp_t out = {0};
-    esp_http_client_config_t cfg = {
-        .url = CONFIG_RIGO_TTS_URL,
-        .method = HTTP_METHOD_POST,
-        .event_handler = http_evt,
-        .user_data = &out,
-        .timeout_ms = 30000,
-    };
-    esp_http_client_handle_t c = esp_http_client_init(&cfg);
-    esp_http_client_set_header(c, "Content-Type", "application/json");
-    set_auth_header(c);
-    esp_http_client_set_post_field(c, body, strlen(body));
-    free(body);
-
-    esp_err_t err = esp_http_client_perform(c);
-    esp_http_client_cleanup(c);
-    if (err != ESP_OK || out.len <= 0) {
-        free(out.data);
-        return NULL;
-    }
-
-    *audio_len = out.len;
-    return out.data;
+    (void)turn;
+    rigo_power_turn_done();
 }
 
-static void play_wav(uint8_t *wav, int len)
+#if CONFIG_RIGO_CMD_ENABLE
+static void run_command(uint32_t turn, const rigo_cmd_t *cmd)
 {
-    if (!wav || len < 44 || memcmp(wav, "RIFF", 4) != 0 || memcmp(wav + 8, "WAVE", 4) != 0) return;
-
-    uint16_t channels = *(uint16_t *)(wav + 22);
-    uint32_t sample_rate = *(uint32_t *)(wav + 24);
-    uint16_t bps = *(uint16_t *)(wav + 34);
-    if (bps != 16) return;
-
-    int data_len = *(uint32_t *)(wav + 40);
-    if (44 + data_len > len) data_len = len - 44;
-
-    esp_codec_dev_sample_info_t fs = {
-        .sample_rate = sample_rate,
-        .channel = channels,
-        .bits_per_sample = 16,
-    };
-
-    if (esp_codec_dev_open(spk_dev, &fs) != ESP_OK) return;
-    avatar_set(FACE_HAPPY, true, 0);
-    esp_codec_dev_write(spk_dev, wav + 44, data_len);
-    avatar_set(FACE_HAPPY, false, 0);
-    esp_codec_dev_close(spk_dev);
+    int64_t t0 = esp_timer_get_time();
+    if (!rigo_pipeline_local(turn, cmd->say, cmd->stop)) {
+        ESP_LOGI(TAG, "Command \"%s\" ignored, turn %u already went to the cloud", cmd->phrase, (unsigned)turn);
+        return;
+    }
+    if (cmd->face) avatar_set(str_to_expr(cmd->face), false, 0);
+    if (cmd->has_volume) {
+        int vol = cmd->volume;
+        if (cmd->volume_rel && esp_codec_dev_get_out_vol(spk_dev, &vol) == ESP_CODEC_DEV_OK) vol += cmd->volume;
+        vol = vol < 0 ? 0 : vol > 100 ? 100 : vol;
+        esp_codec_dev_set_out_vol(spk_dev, vol);
+        ESP_LOGI(TAG, "Volume %d", vol);
+    }
+    ESP_LOGI(TAG, "Command \"%s\" done in %d us", cmd->phrase, (int)(esp_timer_get_time() - t0));
 }
+#endif
 
-static void voice_task(void *arg)
+static void wake_task(void *arg)
 {
-    (void)arg;
-
-    srmodel_list_t *models = esp_srmodel_init("model");
+    // loaded once in app_main and shared with the AFE and MultiNet, so never freed here
+    srmodel_list_t *models = (srmodel_list_t *)arg;
     if (!models) {
         ESP_LOGE(TAG, "No SR models. Enable Hi ESP model in menuconfig.");
         vTaskDelete(NULL);
@@ -525,7 +800,6 @@ static void voice_task(void *arg)
     if (!wn) wn = esp_srmodel_filter(models, ESP_WN_PREFIX, NULL);
     if (!wn) {
         ESP_LOGE(TAG, "No WakeNet model found in srmodels (need Hi ESP model)");
-        esp_srmodel_deinit(models);
         vTaskDelete(NULL);
         return;
     }
@@ -533,7 +807,6 @@ static void voice_task(void *arg)
     const esp_wn_iface_t *wakenet = esp_wn_handle_from_name(wn);
     if (!wakenet) {
         ESP_LOGE(TAG, "Failed to get WakeNet interface for model: %s", wn);
-        esp_srmodel_deinit(models);
         vTaskDelete(NULL);
         return;
     }
@@ -541,64 +814,54 @@ static void voice_task(void *arg)
     model_iface_data_t *wn_data = wakenet->create(wn, DET_MODE_90);
     if (!wn_data) {
         ESP_LOGE(TAG, "Failed to create WakeNet model data");
-        esp_srmodel_deinit(models);
         vTaskDelete(NULL);
         return;
     }
 
     int feed_n = wakenet->get_samp_chunksize(wn_data);
+    wake_chunk_us = feed_n * 1000 / (RIGO_MIC_RATE / 1000);
     int16_t *feed = heap_caps_calloc(feed_n, sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
 
-    esp_codec_dev_sample_info_t mic_fmt = {
-        .sample_rate = 16000,
-        .channel = 1,
-        .bits_per_sample = 16,
-    };
-    ESP_ERROR_CHECK(esp_codec_dev_open(mic_dev, &mic_fmt));
+    // WakeNet keeps listening through every turn; the uplink stage starts
+    // its own cursor where this one detected the wake word
+    static rigo_mic_reader_t mic_rd;
+    ESP_ERROR_CHECK(rigo_mic_reader_init(&mic_rd));
 
-    const int max_bytes = CONFIG_RIGO_CAPTURE_MS * 16 * 2;
-    int16_t *capt = heap_caps_malloc(max_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#if CONFIG_RIGO_CMD_ENABLE
+    // without a model every utterance simply goes to the cloud
+    bool commands = rigo_cmd_init(models) == ESP_OK;
+#endif
 
     ESP_LOGI(TAG, "WakeNet ready (%s). Say: Hi ESP", wn);
 
     while (1) {
-        esp_codec_dev_read(mic_dev, feed, feed_n * sizeof(int16_t));
-        if (wakenet->detect(wn_data, feed) == WAKENET_DETECTED) {
-            avatar_set(FACE_PUZZLED, false, 0);
-            ESP_LOGI(TAG, "Wake detected");
-
-            int cap_bytes = 0;
-            while (cap_bytes < max_bytes) {
-                int rd = feed_n * sizeof(int16_t);
-                if (cap_bytes + rd > max_bytes) rd = max_bytes - cap_bytes;
-                esp_codec_dev_read(mic_dev, ((uint8_t *)capt) + cap_bytes, rd);
-                cap_bytes += rd;
-            }
-
-            avatar_set(FACE_NEUTRAL, false, 0);
-            char *text = cloud_stt(capt, cap_bytes);
-            ESP_LOGI(TAG, "STT: %s", text ? text : "(null)");
-            if (!text || strlen(text) == 0) {
-                free(text);
-                continue;
-            }
-
-            char *reply = cloud_assistant(text);
-            free(text);
-            ESP_LOGI(TAG, "Assistant: %s", reply ? reply : "(null)");
-            if (!reply || strlen(reply) == 0) {
-                free(reply);
-                continue;
-            }
-
-            int tts_len = 0;
-            uint8_t *tts = cloud_tts(reply, &tts_len);
-            free(reply);
-            if (tts && tts_len > 44) {
-                play_wav(tts, tts_len);
-            }
-            free(tts);
+        rigo_mic_read(&mic_rd, feed, feed_n, portMAX_DELAY);
+        const bool idle = rigo_power_idle();
+        const int64_t t0 = esp_timer_get_time();
+        const wakenet_state_t det = wakenet->detect(wn_data, feed);
+        const uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+        portENTER_CRITICAL(&stats_mux);
+        wake_stats[idle].chunks++;
+        wake_stats[idle].detect_us += us;
+        if (us > wake_stats[idle].detect_max_us) wake_stats[idle].detect_max_us = us;
+        portEXIT_CRITICAL(&stats_mux);
+        if (det != WAKENET_DETECTED) continue;
+
+        // full clock before the uplink starts; the capture itself begins in the mic ring
+        rigo_power_wake();
+        uint32_t turn = rigo_pipeline_wake(mic_rd.pos);
+        if (!turn) {
+            rigo_power_turn_done();
+            ESP_LOGI(TAG, "Wake ignored, previous turn still capturing");
+            continue;
         }
+        avatar_set(FACE_PUZZLED, false, 0);
+        ESP_LOGI(TAG, "Wake detected, turn %u", (unsigned)turn);
+#if CONFIG_RIGO_CMD_ENABLE
+        // WakeNet pauses while MultiNet listens to the same audio the uplink is capturing
+        const rigo_cmd_t *cmd = commands ? rigo_cmd_listen(&mic_rd) : NULL;
+        if (cmd) run_command(turn, cmd);
+#endif
     }
 }
 
@@ -661,11 +924,15 @@ static void init_ui(void)
     lv_obj_set_style_text_font(label, &lv_font_montserrat_14, 0);
     lv_obj_align(label, LV_ALIGN_BOTTOM_MID, 0, -12);
 
-    set_expression(FACE_HAPPY);
+    lv_obj_set_pos(mouth, 110, 0);
+    lv_arc_set_value(mouth, 0);
+    face_model_t m;
+    model_expr(&m, FACE_HAPPY);
+    m.eye_h = EYE_H;
+    render(&m);
 
-    lv_timer_create(blink_cb, 220, NULL);
-    lv_timer_create(blink_cb, 2800, NULL);
-    lv_timer_create(avatar_tick_cb, 130, NULL);
+    lv_display_add_event_cb(lv_display_get_default(), display_event_cb, LV_EVENT_ALL, NULL);
+    lv_timer_create(frame_cb, FRAME_MS, NULL);
 
     bsp_display_unlock();
     bsp_display_backlight_on();
@@ -674,6 +941,7 @@ static void init_ui(void)
 void app_main(void)
 {
     ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(rigo_timeline_init());
     init_ui();
 
     ESP_ERROR_CHECK(bsp_audio_init(NULL));
@@ -681,10 +949,28 @@ void app_main(void)
     mic_dev = bsp_audio_codec_microphone_init();
     ESP_ERROR_CHECK(esp_codec_dev_set_out_vol(spk_dev, 55));
     ESP_ERROR_CHECK(esp_codec_dev_set_in_gain(mic_dev, 35));
+    // WakeNet, MultiNet and the AFE all draw on the one model partition
+    srmodel_list_t *models = esp_srmodel_init("model");
+#if CONFIG_RIGO_AFE_ENABLE
+    ESP_ERROR_CHECK(rigo_afe_init(mic_dev, models));
+    ESP_ERROR_CHECK(rigo_mic_init_source(rigo_afe_read, NULL));
+#else
+    ESP_ERROR_CHECK(rigo_mic_init(mic_dev));
+#endif
+    ESP_ERROR_CHECK(rigo_player_init(spk_dev, player_event));
 
     start_network();
+    ESP_ERROR_CHECK(rigo_power_init(strlen(CONFIG_RIGO_WIFI_STA_SSID) > 0));
     start_http_service();
-
-    xTaskCreatePinnedToCore(voice_task, "voice", 12 * 1024, NULL, 5, NULL, 1);
+    ESP_ERROR_CHECK(rigo_conn_init());
+#if CONFIG_RIGO_TTS_CACHE_ENABLE
+    ESP_ERROR_CHECK(rigo_tts_cache_init());
+#endif
+    ESP_ERROR_CHECK(rigo_tts_pipe_init());
+    const rigo_pipeline_cb_t pipeline_cb = {.on_captured = turn_captured, .on_turn_done = turn_done};
+    ESP_ERROR_CHECK(rigo_pipeline_init(&pipeline_cb));
+
+    xTaskCreatePinnedToCore(wake_task, "wake", 12 * 1024, models, CONFIG_RIGO_TASK_WAKE_PRIO, NULL,
+                            RIGO_TASK_CORE(CONFIG_RIGO_TASK_WAKE_CORE));
     ESP_LOGI(TAG, "Rigo voice pipeline ready");
 }
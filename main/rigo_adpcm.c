@@ -0,0 +1,110 @@
+#include "rigo_adpcm.h"
+
+#include <string.h>
+
+static const int16_t step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static int clamp_index(int i)
+{
+    return i < 0 ? 0 : (i > 88 ? 88 : i);
+}
+
+static int clamp16(int v)
+{
+    return v < -32768 ? -32768 : (v > 32767 ? 32767 : v);
+}
+
+// Shared by encoder and decoder so both track the identical predictor.
+static int step_decode(int *pred, int *index, int code)
+{
+    int step = step_table[*index];
+    int diff = step >> 3;
+    if (code & 4) diff += step;
+    if (code & 2) diff += step >> 1;
+    if (code & 1) diff += step >> 2;
+    *pred = clamp16(code & 8 ? *pred - diff : *pred + diff);
+    *index = clamp_index(*index + index_table[code]);
+    return *pred;
+}
+
+static int step_encode(int *pred, int *index, int sample)
+{
+    int step = step_table[*index];
+    int diff = sample - *pred;
+    int code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= step) { code |= 4; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 2; diff -= step; }
+    step >>= 1;
+    if (diff >= step) { code |= 1; }
+    step_decode(pred, index, code);
+    return code;
+}
+
+void rigo_adpcm_enc_init(rigo_adpcm_enc_t *e)
+{
+    e->index = 0;
+}
+
+void rigo_adpcm_encode_block(rigo_adpcm_enc_t *e, const int16_t *pcm, int samples, uint8_t *block)
+{
+    if (samples <= 0) {
+        memset(block, 0, RIGO_ADPCM_BLOCK_ALIGN);
+        return;
+    }
+    int pred = pcm[0];
+    int index = e->index;
+
+    block[0] = pred & 0xff;
+    block[1] = (pred >> 8) & 0xff;
+    block[2] = index;
+    block[3] = 0;
+
+    int16_t last = pcm[samples - 1];
+    uint8_t *out = block + 4;
+    for (int i = 1; i < RIGO_ADPCM_BLOCK_SAMPLES; i += 2) {
+        int s0 = i < samples ? pcm[i] : last;
+        int s1 = i + 1 < samples ? pcm[i + 1] : last;
+        int lo = step_encode(&pred, &index, s0);
+        int hi = step_encode(&pred, &index, s1);
+        *out++ = lo | (hi << 4);
+    }
+    e->index = index;
+}
+
+int rigo_adpcm_decode_block(const uint8_t *block, int block_align, int16_t *pcm)
+{
+    if (block_align < 4) return 0;
+    int pred = (int16_t)(block[0] | (block[1] << 8));
+    int index = clamp_index(block[2]);
+    int n = 0;
+
+    pcm[n++] = pred;
+    for (int i = 4; i < block_align; i++) {
+        pcm[n++] = step_decode(&pred, &index, block[i] & 0x0f);
+        pcm[n++] = step_decode(&pred, &index, block[i] >> 4);
+    }
+    return n;
+}
+
+int rigo_adpcm_encoded_bytes(int samples)
+{
+    return (samples + RIGO_ADPCM_BLOCK_SAMPLES - 1) / RIGO_ADPCM_BLOCK_SAMPLES * RIGO_ADPCM_BLOCK_ALIGN;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+// IMA-ADPCM as used in WAV (format tag 0x11), mono. Each block carries a
+// 4-byte preamble (first sample + step index) and is decodable on its own.
+#define RIGO_ADPCM_BLOCK_ALIGN 256
+#define RIGO_ADPCM_BLOCK_SAMPLES ((RIGO_ADPCM_BLOCK_ALIGN - 4) * 2 + 1)
+
+typedef struct {
+    int index;      // step index carried from block to block
+} rigo_adpcm_enc_t;
+
+void rigo_adpcm_enc_init(rigo_adpcm_enc_t *e);
+
+// Encode up to RIGO_ADPCM_BLOCK_SAMPLES samples into one block of
+// RIGO_ADPCM_BLOCK_ALIGN bytes; a short input is padded with its last sample.
+void rigo_adpcm_encode_block(rigo_adpcm_enc_t *e, const int16_t *pcm, int samples, uint8_t *block);
+
+// Decode one block of block_align bytes; returns the number of samples written.
+int rigo_adpcm_decode_block(const uint8_t *block, int block_align, int16_t *pcm);
+
+// Encoded size of `samples` PCM samples (whole blocks).
+int rigo_adpcm_encoded_bytes(int samples);
@@ -0,0 +1,114 @@
+#include "rigo_afe.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_afe_config.h"
+#include "esp_afe_sr_iface.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "rigo_mic.h"
+#include "rigo_tasks.h"
+
+static const char *TAG = "rigo_afe";
+
+static esp_codec_dev_handle_t dev;
+static const esp_afe_sr_iface_t *afe;
+static esp_afe_sr_data_t *afe_data;
+
+// a fetched chunk larger than the caller's space is handed out over two reads
+static const int16_t *carry;
+static int carry_len;
+
+static void feed_task_fn(void *arg)
+{
+    int16_t *buf = (int16_t *)arg;
+    const int bytes = afe->get_feed_chunksize(afe_data) * afe->get_feed_channel_num(afe_data) * sizeof(int16_t);
+    while (1) {
+        if (esp_codec_dev_read(dev, buf, bytes) != ESP_CODEC_DEV_OK) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+        afe->feed(afe_data, buf);
+    }
+}
+
+int rigo_afe_read(int16_t *dst, int max, void *ctx)
+{
+    (void)ctx;
+    if (carry_len == 0) {
+        afe_fetch_result_t *res = afe->fetch(afe_data);
+        if (!res || res->ret_value == ESP_FAIL) return -1;
+        carry = res->data;
+        carry_len = res->data_size / sizeof(int16_t);
+    }
+    int n = carry_len < max ? carry_len : max;
+    memcpy(dst, carry, n * sizeof(int16_t));
+    carry += n;
+    carry_len -= n;
+    return n;
+}
+
+esp_err_t rigo_afe_init(esp_codec_dev_handle_t mic, srmodel_list_t *models)
+{
+    const size_t psram0 = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    const size_t internal0 = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+
+    afe_config_t *cfg = afe_config_init(CONFIG_RIGO_AFE_INPUT_FORMAT, models, AFE_TYPE_SR, AFE_MODE_LOW_COST);
+    if (!cfg) {
+        ESP_LOGE(TAG, "Bad AFE input format \"%s\"", CONFIG_RIGO_AFE_INPUT_FORMAT);
+        return ESP_ERR_INVALID_ARG;
+    }
+    // WakeNet and VAD keep running on the ring (wake task, rigo_vad), so
+    // the AFE only cleans the signal
+    cfg->aec_init = true;
+    cfg->se_init = false;
+    cfg->vad_init = false;
+    cfg->wakenet_init = false;
+#if CONFIG_RIGO_AFE_NS
+    cfg->ns_init = true;
+    cfg->afe_ns_mode = AFE_NS_MODE_WEBRTC;
+#else
+    cfg->ns_init = false;
+#endif
+#if CONFIG_RIGO_AFE_AGC
+    cfg->agc_init = true;
+#else
+    cfg->agc_init = false;
+#endif
+    cfg->memory_alloc_mode = AFE_MEMORY_ALLOC_MORE_PSRAM;
+    cfg->afe_perferred_core = CONFIG_RIGO_TASK_INGEST_CORE < 0 ? 0 : CONFIG_RIGO_TASK_INGEST_CORE;
+    cfg->afe_perferred_priority = CONFIG_RIGO_TASK_INGEST_PRIO;
+    afe = esp_afe_handle_from_config(cfg);
+    afe_data = afe ? afe->create_from_config(cfg) : NULL;
+    afe_config_free(cfg);
+    if (!afe_data) {
+        ESP_LOGE(TAG, "AFE create failed");
+        return ESP_FAIL;
+    }
+
+    const int ch = strlen(CONFIG_RIGO_AFE_INPUT_FORMAT);
+    esp_codec_dev_sample_info_t fs = {
+        .sample_rate = RIGO_MIC_RATE,
+        .channel = ch,
+        .bits_per_sample = 16,
+    };
+    if (esp_codec_dev_open(mic, &fs) != ESP_CODEC_DEV_OK) return ESP_FAIL;
+    dev = mic;
+
+    const int feed_n = afe->get_feed_chunksize(afe_data);
+    int16_t *buf = heap_caps_malloc(feed_n * ch * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!buf) return ESP_ERR_NO_MEM;
+    if (xTaskCreatePinnedToCore(feed_task_fn, "afe_feed", 4 * 1024, buf, CONFIG_RIGO_TASK_INGEST_PRIO, NULL,
+                                RIGO_TASK_CORE(CONFIG_RIGO_TASK_INGEST_CORE)) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "AFE %s, %d-sample feed, %d-sample fetch; %u KB PSRAM, %u KB internal",
+             CONFIG_RIGO_AFE_INPUT_FORMAT, feed_n, afe->get_fetch_chunksize(afe_data),
+             (unsigned)((psram0 - heap_caps_get_free_size(MALLOC_CAP_SPIRAM)) / 1024),
+             (unsigned)((internal0 - heap_caps_get_free_size(MALLOC_CAP_INTERNAL)) / 1024));
+    return ESP_OK;
+}
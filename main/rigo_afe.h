@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_codec_dev.h"
+#include "model_path.h"
+
+// esp-sr audio front end between the codec and the mic ring. The mic codec
+// is opened with the playback reference channel (CONFIG_RIGO_AFE_INPUT_FORMAT)
+// and a feed task pushes every TDM frame into the AFE, which cancels the
+// speaker echo and applies noise suppression and AGC.
+
+// Opens the codec and starts the feed task. `models` is the SR model list
+// app_main loaded for the wake task as well.
+esp_err_t rigo_afe_init(esp_codec_dev_handle_t mic, srmodel_list_t *models);
+
+// rigo_mic_source_t: blocks for the next cleaned 16 kHz mono chunk.
+int rigo_afe_read(int16_t *dst, int max, void *ctx);
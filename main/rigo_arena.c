@@ -0,0 +1,203 @@
+#include "rigo_arena.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "cJSON.h"
+
+static const char *TAG = "rigo_arena";
+
+// Every block starts with a header; blocks are 8-byte multiples, so bit 0 of
+// size is free to mark a released block.
+typedef struct {
+    uint32_t prev;      // offset of the block below
+    uint32_t size;      // header + payload
+} blk_t;
+
+#define FREED 1u
+
+#if CONFIG_RIGO_ARENA_ENABLE
+#define SLOTS CONFIG_RIGO_ARENA_SLOTS
+#else
+#define SLOTS 1     // never allocated; everything goes to the heap
+#endif
+
+struct rigo_arena {
+    uint8_t *base;
+    uint32_t used;      // bump offset
+    uint32_t top;       // offset of the newest block, valid while used > 0
+    uint32_t peak;
+    uint32_t turn;
+    bool busy;
+};
+
+static portMUX_TYPE arena_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t *pool;
+static rigo_arena_t arenas[SLOTS];
+static rigo_arena_stats_t stats;
+static _Thread_local rigo_arena_t *cur;
+
+esp_err_t rigo_arena_init(void)
+{
+#if CONFIG_RIGO_ARENA_ENABLE
+    const size_t size = CONFIG_RIGO_ARENA_KB * 1024;
+    pool = heap_caps_malloc(size * SLOTS, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!pool) return ESP_ERR_NO_MEM;
+    for (int i = 0; i < SLOTS; i++) arenas[i].base = pool + i * size;
+    stats.size = size;
+    stats.slots = SLOTS;
+
+    cJSON_Hooks hooks = {.malloc_fn = rigo_arena_malloc, .free_fn = rigo_arena_free};
+    cJSON_InitHooks(&hooks);
+    ESP_LOGI(TAG, "%d x %d KB turn arenas in PSRAM", CONFIG_RIGO_ARENA_SLOTS, CONFIG_RIGO_ARENA_KB);
+#endif
+    return ESP_OK;
+}
+
+rigo_arena_t *rigo_arena_begin(uint32_t turn)
+{
+    if (!pool) return NULL;
+    rigo_arena_t *a = NULL;
+    portENTER_CRITICAL(&arena_mux);
+    for (int i = 0; i < SLOTS && !a; i++) {
+        if (arenas[i].busy) continue;
+        a = &arenas[i];
+        a->busy = true;
+        a->used = 0;
+        a->peak = 0;
+        a->turn = turn;
+    }
+    if (!a) stats.no_slot++;
+    portEXIT_CRITICAL(&arena_mux);
+    if (!a) ESP_LOGW(TAG, "Turn %u: all arenas busy, using the heap", (unsigned)turn);
+    return a;
+}
+
+void rigo_arena_end(rigo_arena_t *a)
+{
+    if (!a) return;
+    // the heap walk takes its own locks; sample before entering ours
+    size_t spiram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    size_t spiram_largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+    size_t spiram_min = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
+    size_t internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t internal_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+
+    portENTER_CRITICAL(&arena_mux);
+    uint32_t turn = a->turn, peak = a->peak;
+    a->used = 0;
+    a->busy = false;
+    stats.turns++;
+    stats.last_peak = peak;
+    if (peak > stats.max_peak) stats.max_peak = peak;
+    stats.spiram_free = spiram_free;
+    stats.spiram_largest = spiram_largest;
+    stats.spiram_min_free = spiram_min;
+    stats.internal_free = internal_free;
+    stats.internal_largest = internal_largest;
+    uint32_t overflows = stats.overflows;
+    portEXIT_CRITICAL(&arena_mux);
+
+    ESP_LOGI(TAG, "Turn %u: arena peak %u of %u bytes (%u overflows total); PSRAM free %u KB, largest %u KB; "
+             "internal free %u KB, largest %u KB",
+             (unsigned)turn, (unsigned)peak, (unsigned)stats.size, (unsigned)overflows, (unsigned)(spiram_free / 1024),
+             (unsigned)(spiram_largest / 1024), (unsigned)(internal_free / 1024), (unsigned)(internal_largest / 1024));
+}
+
+rigo_arena_t *rigo_arena_enter(rigo_arena_t *a)
+{
+    rigo_arena_t *prev = cur;
+    cur = a;
+    return prev;
+}
+
+rigo_arena_t *rigo_arena_of(const void *p)
+{
+    if (!pool || (const uint8_t *)p < pool) return NULL;
+    size_t i = ((const uint8_t *)p - pool) / stats.size;
+    return i < SLOTS ? &arenas[i] : NULL;
+}
+
+static void *arena_alloc(rigo_arena_t *a, size_t n)
+{
+    const size_t need = sizeof(blk_t) + ((n + 7) & ~(size_t)7);
+    void *p = NULL;
+    portENTER_CRITICAL(&arena_mux);
+    if (a->used + need <= stats.size) {
+        blk_t *b = (blk_t *)(a->base + a->used);
+        b->prev = a->top;
+        b->size = need;
+        a->top = a->used;
+        a->used += need;
+        if (a->used > a->peak) a->peak = a->used;
+        p = b + 1;
+    } else {
+        stats.overflows++;
+    }
+    portEXIT_CRITICAL(&arena_mux);
+    return p;
+}
+
+void *rigo_arena_malloc(size_t n)
+{
+    void *p = cur ? arena_alloc(cur, n) : NULL;
+    return p ? p : malloc(n);
+}
+
+void *rigo_arena_calloc(size_t n, size_t size)
+{
+    void *p = rigo_arena_malloc(n * size);
+    if (p) memset(p, 0, n * size);
+    return p;
+}
+
+static char *copy_str(const char *s, size_t len)
+{
+    char *p = rigo_arena_malloc(len + 1);
+    if (!p) return NULL;
+    memcpy(p, s, len);
+    p[len] = '\0';
+    return p;
+}
+
+char *rigo_arena_strdup(const char *s)
+{
+    return copy_str(s, strlen(s));
+}
+
+char *rigo_arena_strndup(const char *s, size_t n)
+{
+    return copy_str(s, strnlen(s, n));
+}
+
+void rigo_arena_free(void *p)
+{
+    if (!p) return;
+    rigo_arena_t *a = rigo_arena_of(p);
+    if (!a) {
+        free(p);
+        return;
+    }
+    portENTER_CRITICAL(&arena_mux);
+    ((blk_t *)p - 1)->size |= FREED;
+    // pop released blocks off the top; one still in use stops the walk
+    while (a->used > 0) {
+        blk_t *top = (blk_t *)(a->base + a->top);
+        if (!(top->size & FREED)) break;
+        a->used = a->top;
+        a->top = top->prev;
+    }
+    portEXIT_CRITICAL(&arena_mux);
+}
+
+void rigo_arena_get_stats(rigo_arena_stats_t *out)
+{
+    portENTER_CRITICAL(&arena_mux);
+    *out = stats;
+    portEXIT_CRITICAL(&arena_mux);
+}
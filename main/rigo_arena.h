@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Per-turn bump allocator for the pipeline's short-lived allocations
+// (transcripts, request bodies, cJSON trees, reply text, TTS segments).
+// CONFIG_RIGO_ARENA_SLOTS arenas of CONFIG_RIGO_ARENA_KB are carved out of
+// PSRAM once at boot; each turn in flight owns one and the whole arena is
+// reset when the turn ends, so the heap sees no per-turn churn.
+//
+// A task allocates from the arena it has entered; cJSON is hooked to the same
+// allocator. A freed block is reclaimed as soon as everything above it is
+// free too. Without an entered arena, or when a turn outgrows its arena,
+// allocations fall back to malloc. rigo_arena_free takes either kind.
+
+typedef struct rigo_arena rigo_arena_t;
+
+typedef struct {
+    size_t size;                // bytes per arena
+    int slots;
+    uint32_t turns;             // turns that ran in an arena
+    uint32_t no_slot;           // turns that found every arena busy and used the heap
+    uint32_t overflows;         // allocations that did not fit and went to the heap
+    size_t last_peak;           // high-water mark of the last finished turn
+    size_t max_peak;
+    // heap state after the last turn
+    size_t spiram_free;
+    size_t spiram_largest;      // largest free block
+    size_t spiram_min_free;     // low-water mark since boot
+    size_t internal_free;
+    size_t internal_largest;
+} rigo_arena_stats_t;
+
+// Allocates the arenas and installs the cJSON hooks.
+esp_err_t rigo_arena_init(void);
+
+// Claims a free arena for `turn`, or NULL when all are busy (the turn then
+// runs on the heap). rigo_arena_end resets it and records its peak.
+rigo_arena_t *rigo_arena_begin(uint32_t turn);
+void rigo_arena_end(rigo_arena_t *a);
+
+// Makes `a` (may be NULL) the calling task's arena; returns the previous one.
+rigo_arena_t *rigo_arena_enter(rigo_arena_t *a);
+// The arena `p` was allocated from, or NULL.
+rigo_arena_t *rigo_arena_of(const void *p);
+
+void *rigo_arena_malloc(size_t n);
+void *rigo_arena_calloc(size_t n, size_t size);
+char *rigo_arena_strdup(const char *s);
+char *rigo_arena_strndup(const char *s, size_t n);
+void rigo_arena_free(void *p);
+
+void rigo_arena_get_stats(rigo_arena_stats_t *out);
@@ -0,0 +1,338 @@
+#include "rigo_cloud.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+
+#include "rigo_arena.h"
+#include "rigo_conn.h"
+#include "rigo_metrics.h"
+#include "rigo_respbuf.h"
+#include "rigo_stt_ws.h"
+#include "rigo_wav.h"
+
+static const char *TAG = "rigo_cloud";
+
+// one per stage: the uplink and assistant tasks run concurrently
+static rigo_respbuf_t stt_buf = RIGO_RESPBUF_INIT("stt");
+static rigo_respbuf_t asst_buf = RIGO_RESPBUF_INIT("assistant");
+
+static char *json_text(const char *json, const char *key, const char *alt_key)
+{
+    cJSON *r = cJSON_Parse(json);
+    char *txt = NULL;
+    if (r) {
+        cJSON *t = cJSON_GetObjectItemCaseSensitive(r, key);
+        if (!cJSON_IsString(t) && alt_key) t = cJSON_GetObjectItemCaseSensitive(r, alt_key);
+        if (cJSON_IsString(t) && t->valuestring && strlen(t->valuestring) > 0) {
+            txt = rigo_arena_strdup(t->valuestring);
+        }
+        cJSON_Delete(r);
+    }
+    return txt;
+}
+
+// NULL when out of memory (the arena spills to a heap that may be exhausted too).
+static char *text_body(const char *user_text)
+{
+    cJSON *req = cJSON_CreateObject();
+    if (!req) return NULL;
+    char *body = cJSON_AddStringToObject(req, "text", user_text) ? cJSON_PrintUnformatted(req) : NULL;
+    cJSON_Delete(req);
+    if (!body) ESP_LOGE(TAG, "No memory for the request body");
+    return body;
+}
+
+static bool stt_raw(rigo_stt_upload_t *u, const void *data, int len)
+{
+    if (len > 0 && esp_http_client_write(u->client, data, len) != len) {
+        u->failed = true;
+    }
+    return !u->failed;
+}
+
+#if CONFIG_RIGO_STT_CODEC_ADPCM
+// RFC 2361 naming for WAVE format tag 0x0011
+#define STT_CONTENT_TYPE "audio/vnd.wave; codec=11"
+#define STT_HDR_LEN RIGO_WAV_ADPCM_HDR_LEN
+#define STT_WS_ENCODING "ima_adpcm"
+#else
+#define STT_CONTENT_TYPE "audio/wav"
+#define STT_HDR_LEN RIGO_WAV_HDR_LEN
+#define STT_WS_ENCODING "pcm_s16le"
+#endif
+
+static bool stt_send(rigo_stt_upload_t *u, const void *data, int len)
+{
+    if (len <= 0) return !u->failed;
+
+#if CONFIG_RIGO_STT_WS
+    if (!u->failed && !rigo_stt_ws_send(data, len)) u->failed = true;
+#else
+    if (u->chunked) {
+        char hdr[12];
+        int n = snprintf(hdr, sizeof(hdr), "%x\r\n", len);
+        stt_raw(u, hdr, n);
+        stt_raw(u, data, len);
+        stt_raw(u, "\r\n", 2);
+    } else {
+        stt_raw(u, data, len);
+    }
+#endif
+    if (!u->failed) u->sent += len;
+    return !u->failed;
+}
+
+#if CONFIG_RIGO_STT_CODEC_ADPCM
+static void stt_encode_block(rigo_stt_upload_t *u)
+{
+    if (u->out_len + RIGO_ADPCM_BLOCK_ALIGN > (int)sizeof(u->out)) {
+        stt_send(u, u->out, u->out_len);
+        u->out_len = 0;
+    }
+    int64_t t0 = esp_timer_get_time();
+    rigo_adpcm_encode_block(&u->enc, u->block, u->block_fill, u->out + u->out_len);
+    u->encode_us += esp_timer_get_time() - t0;
+    u->out_len += RIGO_ADPCM_BLOCK_ALIGN;
+    u->block_fill = 0;
+    u->blocks++;
+}
+#endif
+
+bool rigo_cloud_stt_write(rigo_stt_upload_t *u, const void *data, int len)
+{
+    if (!u->open || u->failed) return false;
+    if (len <= 0) return true;
+    u->pcm_bytes += len;
+
+#if CONFIG_RIGO_STT_CODEC_ADPCM
+    const int16_t *pcm = (const int16_t *)data;
+    int n = len / 2;
+    while (n > 0) {
+        int take = RIGO_ADPCM_BLOCK_SAMPLES - u->block_fill;
+        if (take > n) take = n;
+        memcpy(u->block + u->block_fill, pcm, take * sizeof(int16_t));
+        u->block_fill += take;
+        pcm += take;
+        n -= take;
+        if (u->block_fill == RIGO_ADPCM_BLOCK_SAMPLES) stt_encode_block(u);
+    }
+    // whole blocks go out with this mic frame, the partial one waits
+    stt_send(u, u->out, u->out_len);
+    u->out_len = 0;
+    return !u->failed;
+#else
+    return stt_send(u, data, len);
+#endif
+}
+
+bool rigo_cloud_stt_begin(rigo_stt_upload_t *u, uint32_t turn, int pcm_bytes)
+{
+    memset(u, 0, sizeof(*u));
+    u->turn = turn;
+    u->chunked = pcm_bytes < 0;
+    rigo_adpcm_enc_init(&u->enc);
+
+#if CONFIG_RIGO_STT_WS
+    // the start message carries the format; frames are bare encoded audio
+    u->open = rigo_stt_ws_begin(STT_WS_ENCODING);
+    return u->open;
+#endif
+
+    uint8_t hdr[STT_HDR_LEN];
+#if CONFIG_RIGO_STT_CODEC_ADPCM
+    const int samples = pcm_bytes < 0 ? -1 : pcm_bytes / 2;
+    const int body = samples < 0 ? -1 : rigo_adpcm_encoded_bytes(samples);
+    rigo_wav_build_adpcm_header(hdr, samples, 16000);
+#else
+    const int body = pcm_bytes;
+    rigo_wav_build_header(hdr, pcm_bytes, 16000, 1);
+#endif
+
+    u->client = rigo_conn_open(RIGO_EP_STT, STT_CONTENT_TYPE, "application/json",
+                               u->chunked ? -1 : STT_HDR_LEN + body);
+    if (!u->client) return false;
+    u->open = true;
+
+    stt_send(u, hdr, sizeof(hdr));
+    u->sent = 0;
+    return !u->failed;
+}
+
+void rigo_cloud_stt_abort(rigo_stt_upload_t *u)
+{
+    if (!u->open) return;
+#if CONFIG_RIGO_STT_WS
+    rigo_stt_ws_abort();
+#else
+    rigo_conn_release(RIGO_EP_STT, false);
+#endif
+    u->open = false;
+    u->client = NULL;
+}
+
+char *rigo_cloud_stt_finish(rigo_stt_upload_t *u)
+{
+    if (!u->open) return NULL;
+
+#if CONFIG_RIGO_STT_CODEC_ADPCM
+    if (u->block_fill > 0) stt_encode_block(u);
+    stt_send(u, u->out, u->out_len);
+    u->out_len = 0;
+    if (u->blocks > 0 && u->pcm_bytes > 0) {
+        // audio_us = pcm_bytes / 32 bytes per ms * 1000
+        const int64_t audio_us = (int64_t)u->pcm_bytes * 1000 / 32;
+        ESP_LOGI(TAG, "STT upload %d -> %d bytes (%d%%), encode %d us/block, %d.%02d%% of real time",
+                 u->pcm_bytes, u->sent, (int)((int64_t)u->sent * 100 / u->pcm_bytes),
+                 (int)(u->encode_us / u->blocks), (int)(u->encode_us * 100 / audio_us),
+                 (int)(u->encode_us * 10000 / audio_us % 100));
+    }
+#endif
+
+#if CONFIG_RIGO_STT_WS
+    u->open = false;
+    if (u->failed) {
+        rigo_stt_ws_abort();
+        return NULL;
+    }
+    return rigo_stt_ws_finish(u->turn);
+#endif
+
+    bool ok = !u->failed;
+    if (ok && u->chunked) ok = stt_raw(u, "0\r\n\r\n", 5);
+    if (ok) rigo_metrics_mark(u->turn, RIGO_MARK_STT_SENT);
+    if (ok) ok = rigo_conn_wait_response(RIGO_EP_STT) > 0;
+    if (ok) rigo_metrics_mark(u->turn, RIGO_MARK_STT_FIRST_BYTE);
+    if (ok) ok = rigo_respbuf_read_http(&stt_buf, u->client);
+    if (ok) rigo_metrics_mark(u->turn, RIGO_MARK_STT_DONE);
+
+    char *txt = ok ? json_text((char *)stt_buf.data, "text", NULL) : NULL;
+    rigo_conn_release(RIGO_EP_STT, ok);
+    u->open = false;
+    u->client = NULL;
+    return txt;
+}
+
+bool rigo_cloud_stt_final(const rigo_stt_upload_t *u)
+{
+#if CONFIG_RIGO_STT_WS
+    return u->open && rigo_stt_ws_final();
+#else
+    (void)u;
+    return false;
+#endif
+}
+
+char *rigo_cloud_stt(uint32_t turn, const int16_t *pcm, int bytes)
+{
+    rigo_stt_upload_t up;
+    if (!rigo_cloud_stt_begin(&up, turn, bytes)) return NULL;
+    rigo_cloud_stt_write(&up, pcm, bytes);
+    return rigo_cloud_stt_finish(&up);
+}
+
+char *rigo_cloud_assistant(const char *user_text)
+{
+    if (!rigo_conn_configured(RIGO_EP_ASSISTANT) || !user_text) return NULL;
+    char *body = text_body(user_text);
+    if (!body) return NULL;
+
+    esp_http_client_handle_t c = rigo_conn_request(RIGO_EP_ASSISTANT, "application/json", "application/json",
+                                                   body, strlen(body));
+    cJSON_free(body);
+    if (!c) return NULL;
+
+    if (!rigo_respbuf_read_http(&asst_buf, c)) {
+        rigo_conn_release(RIGO_EP_ASSISTANT, false);
+        return NULL;
+    }
+    rigo_conn_release(RIGO_EP_ASSISTANT, true);
+
+    return json_text((char *)asst_buf.data, "reply", "text");
+}
+
+typedef struct {
+    rigo_stream_t parser;
+    rigo_stream_text_cb_t on_text;
+    void *ctx;
+    bool first;
+    bool json;      // server ignored Accept and sent the single-JSON contract
+} assistant_stream_t;
+
+static void assistant_delta(const char *text, int len, void *ctx)
+{
+    assistant_stream_t *st = (assistant_stream_t *)ctx;
+    rigo_respbuf_append(&asst_buf, text, len);
+    st->on_text(text, len, st->ctx);
+}
+
+static void assistant_data(const char *data, int len, void *ctx)
+{
+    assistant_stream_t *st = (assistant_stream_t *)ctx;
+    if (st->first) {
+        st->first = false;
+        const char *ct = rigo_conn_content_type(RIGO_EP_ASSISTANT);
+        int status = rigo_conn_status(RIGO_EP_ASSISTANT);
+        // error bodies are collected, never spoken
+        st->json = strncasecmp(ct, "application/json", 16) == 0 || status < 200 || status >= 300;
+        if (strstr(ct, "event-stream")) st->parser.mode = RIGO_STREAM_SSE;
+        else if (strstr(ct, "ndjson") || strstr(ct, "jsonl")) st->parser.mode = RIGO_STREAM_NDJSON;
+        ESP_LOGD(TAG, "Assistant reply %d: %s", status, ct[0] ? ct : "(no content-type)");
+    }
+    if (st->json) {
+        rigo_respbuf_append(&asst_buf, data, len);
+    } else {
+        rigo_stream_feed(&st->parser, data, len);
+    }
+}
+
+char *rigo_cloud_assistant_stream(const char *user_text, rigo_stream_text_cb_t on_text, void *ctx)
+{
+    if (!rigo_conn_configured(RIGO_EP_ASSISTANT) || !user_text) return NULL;
+    char *body = text_body(user_text);
+
+#if CONFIG_RIGO_ASSISTANT_NDJSON
+    const rigo_stream_mode_t mode = RIGO_STREAM_NDJSON;
+    const char *accept = "application/x-ndjson";
+#else
+    const rigo_stream_mode_t mode = RIGO_STREAM_SSE;
+    const char *accept = "text/event-stream";
+#endif
+
+    // the parser holds two line buffers; keep it off the caller's stack
+    assistant_stream_t *st = rigo_arena_calloc(1, sizeof(*st));
+    if (!body || !st) {
+        cJSON_free(body);
+        rigo_arena_free(st);
+        return NULL;
+    }
+    rigo_stream_init(&st->parser, mode, assistant_delta, st);
+    st->on_text = on_text;
+    st->ctx = ctx;
+    st->first = true;
+    rigo_respbuf_reset(&asst_buf);
+
+    int status = rigo_conn_perform(RIGO_EP_ASSISTANT, "application/json", accept, body, strlen(body),
+                                   assistant_data, st);
+    cJSON_free(body);
+
+    char *txt = NULL;
+    if (status >= 200 && status < 300) {
+        if (st->json) {
+            txt = json_text((char *)asst_buf.data, "reply", "text");
+            if (txt) on_text(txt, strlen(txt), ctx);
+        } else {
+            rigo_stream_finish(&st->parser);
+            if (asst_buf.len > 0) txt = rigo_arena_strndup((char *)asst_buf.data, asst_buf.len);
+        }
+    } else if (status > 0) {
+        ESP_LOGE(TAG, "Assistant HTTP %d", status);
+    }
+    rigo_arena_free(st);
+    return txt;
+}
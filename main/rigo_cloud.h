@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_http_client.h"
+
+#include "rigo_adpcm.h"
+#include "rigo_stream.h"
+
+typedef struct {
+    bool open;
+    uint32_t turn;      // rigo_metrics turn of the utterance
+    esp_http_client_handle_t client;    // HTTP transport
+    bool chunked;
+    bool failed;
+    int sent;           // encoded body bytes after the header
+    int pcm_bytes;      // PCM handed to rigo_cloud_stt_write
+
+    // IMA-ADPCM stage (CONFIG_RIGO_STT_CODEC_ADPCM)
+    rigo_adpcm_enc_t enc;
+    int16_t block[RIGO_ADPCM_BLOCK_SAMPLES];
+    int block_fill;
+    uint8_t out[2 * RIGO_ADPCM_BLOCK_ALIGN];
+    int out_len;
+    int blocks;
+    int64_t encode_us;
+} rigo_stt_upload_t;
+
+// pcm_bytes < 0 opens a chunked request so PCM can be pushed while still capturing
+bool rigo_cloud_stt_begin(rigo_stt_upload_t *u, uint32_t turn, int pcm_bytes);
+// Takes 16 kHz mono PCM16; encodes it first when an upload codec is selected.
+bool rigo_cloud_stt_write(rigo_stt_upload_t *u, const void *data, int len);
+void rigo_cloud_stt_abort(rigo_stt_upload_t *u);
+// Ends the upload and returns the transcript or NULL; free it with rigo_arena_free.
+char *rigo_cloud_stt_finish(rigo_stt_upload_t *u);
+// The streaming transport already has the final transcript, so capture can
+// stop; always false over HTTP.
+bool rigo_cloud_stt_final(const rigo_stt_upload_t *u);
+
+char *rigo_cloud_stt(uint32_t turn, const int16_t *pcm, int bytes);
+
+// Single-JSON contract: {"text":...} -> {"reply":...} (or "text").
+char *rigo_cloud_assistant(const char *user_text);
+
+// Streaming contract (SSE or NDJSON per Kconfig). on_text receives deltas as
+// they arrive; a plain application/json reply is still accepted and delivered
+// as one delta. Returns the whole reply or NULL; free it with rigo_arena_free.
+char *rigo_cloud_assistant_stream(const char *user_text, rigo_stream_text_cb_t on_text, void *ctx);
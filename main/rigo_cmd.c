@@ -0,0 +1,122 @@
+#include "rigo_cmd.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_mn_iface.h"
+#include "esp_mn_models.h"
+#include "esp_mn_speech_commands.h"
+
+static const char *TAG = "rigo_cmd";
+
+#define MAX_CMDS 32
+
+static rigo_cmd_t cmds[MAX_CMDS];
+static int ncmds;
+static char *table;     // parsed copy of CONFIG_RIGO_CMD_TABLE; entries point into it
+
+static const esp_mn_iface_t *multinet;
+static model_iface_data_t *mn_data;
+static int16_t *chunk;
+static int chunk_n;
+
+static bool parse_action(rigo_cmd_t *c, char *act)
+{
+    if (strncmp(act, "face:", 5) == 0) {
+        c->face = act + 5;
+    } else if (strncmp(act, "volume:", 7) == 0) {
+        const char *v = act + 7;
+        c->has_volume = true;
+        c->volume_rel = v[0] == '+' || v[0] == '-';
+        c->volume = atoi(v);
+    } else if (strcmp(act, "stop") == 0) {
+        c->stop = true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// "phrase=action,action;..."; say:<text> runs to the end of its entry
+static bool parse_entry(char *entry)
+{
+    char *eq = strchr(entry, '=');
+    if (!eq || eq == entry || ncmds == MAX_CMDS) return false;
+    *eq = '\0';
+    rigo_cmd_t *c = &cmds[ncmds];
+    memset(c, 0, sizeof(*c));
+    c->phrase = entry;
+    char *act = eq + 1;
+    while (*act) {
+        if (strncmp(act, "say:", 4) == 0) {
+            c->say = act + 4;
+            break;
+        }
+        char *comma = strchr(act, ',');
+        if (comma) *comma = '\0';
+        if (!parse_action(c, act)) {
+            ESP_LOGW(TAG, "\"%s\": unknown action \"%s\"", c->phrase, act);
+            return false;
+        }
+        if (!comma) break;
+        act = comma + 1;
+    }
+    ncmds++;
+    return true;
+}
+
+static void parse_table(void)
+{
+    table = strdup(CONFIG_RIGO_CMD_TABLE);
+    if (!table) return;
+    char *save = NULL;
+    for (char *e = strtok_r(table, ";", &save); e; e = strtok_r(NULL, ";", &save)) {
+        if (!parse_entry(e)) ESP_LOGW(TAG, "Skipped command entry \"%s\"", e);
+    }
+}
+
+esp_err_t rigo_cmd_init(srmodel_list_t *models)
+{
+    char *mn = esp_srmodel_filter(models, ESP_MN_PREFIX, ESP_MN_ENGLISH);
+    if (!mn) {
+        ESP_LOGE(TAG, "No English MultiNet model (enable CONFIG_SR_MN_EN_MULTINET7_QUANT)");
+        return ESP_ERR_NOT_FOUND;
+    }
+    multinet = esp_mn_handle_from_name(mn);
+    mn_data = multinet ? multinet->create(mn, CONFIG_RIGO_CMD_TIMEOUT_MS) : NULL;
+    if (!mn_data) {
+        ESP_LOGE(TAG, "Failed to create MultiNet %s", mn);
+        return ESP_FAIL;
+    }
+    chunk_n = multinet->get_samp_chunksize(mn_data);
+    chunk = heap_caps_malloc(chunk_n * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!chunk) return ESP_ERR_NO_MEM;
+
+    parse_table();
+    esp_mn_commands_alloc(multinet, mn_data);
+    esp_mn_commands_clear();
+    for (int i = 0; i < ncmds; i++) esp_mn_commands_add(i, cmds[i].phrase);
+    esp_mn_error_t *err = esp_mn_commands_update();
+    if (err && err->num > 0) ESP_LOGW(TAG, "%d command phrases rejected by MultiNet", err->num);
+    ESP_LOGI(TAG, "MultiNet %s, %d commands", mn, ncmds);
+    return ESP_OK;
+}
+
+const rigo_cmd_t *rigo_cmd_listen(rigo_mic_reader_t *rd)
+{
+    if (!mn_data || ncmds == 0) return NULL;
+    multinet->clean(mn_data);
+    while (1) {
+        rigo_mic_read(rd, chunk, chunk_n, portMAX_DELAY);
+        esp_mn_state_t st = multinet->detect(mn_data, chunk);
+        if (st == ESP_MN_STATE_TIMEOUT) return NULL;
+        if (st != ESP_MN_STATE_DETECTED) continue;
+        esp_mn_results_t *res = multinet->get_results(mn_data);
+        int id = res->num > 0 ? res->command_id[0] : -1;
+        if (id < 0 || id >= ncmds) return NULL;
+        ESP_LOGI(TAG, "Command \"%s\" (p=%.2f)", cmds[id].phrase, res->prob[0]);
+        return &cmds[id];
+    }
+}
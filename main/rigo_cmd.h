@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "model_path.h"
+
+#include "rigo_mic.h"
+
+// On-device commands: MultiNet listens to the audio right after the wake
+// word for the phrases in CONFIG_RIGO_CMD_TABLE.
+
+typedef struct {
+    const char *phrase;
+    const char *face;       // expression name, or NULL
+    bool has_volume;
+    bool volume_rel;        // volume is a step, not a level
+    int volume;
+    bool stop;              // end the reply in progress
+    const char *say;        // canned reply, or NULL
+} rigo_cmd_t;
+
+// Parses the table and loads the English MultiNet model from `models`.
+esp_err_t rigo_cmd_init(srmodel_list_t *models);
+
+// Runs MultiNet on `rd` from its current position until a command is
+// recognized or CONFIG_RIGO_CMD_TIMEOUT_MS passes without one (NULL).
+const rigo_cmd_t *rigo_cmd_listen(rigo_mic_reader_t *rd);
@@ -0,0 +1,587 @@
+#include "rigo_conn.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/param.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "rigo_conn";
+
+#define LAT_SAMPLES 32          // first-byte times kept per endpoint for the hedge delay
+#define LAT_MIN_SAMPLES 8       // below this the initial delay applies
+#define SLICE_MS 20             // poll interval while two requests are in flight
+
+typedef struct conn_slot {
+    const char *name;
+    const char *url;
+    int timeout_ms;
+    esp_http_client_handle_t client;
+    SemaphoreHandle_t lock;
+    bool connected;
+    int64_t last_used_us;
+    char content_type[48];
+    bool responded;     // response headers seen for the current request
+    rigo_conn_data_cb_t on_data;
+    void *data_ctx;
+    int delivered;
+    rigo_ep_t hedge;                // secondary; 0 (STT) means none, STT is never hedged
+    struct conn_slot *active;       // slot serving the current request, NULL: this one
+    uint16_t lat_ms[LAT_SAMPLES];
+    int lat_n, lat_pos;
+    rigo_conn_stats_t stats;
+} conn_slot_t;
+
+static conn_slot_t slots[RIGO_EP_COUNT] = {
+    [RIGO_EP_STT] = {.name = "stt", .url = CONFIG_RIGO_STT_URL, .timeout_ms = 20000},
+    [RIGO_EP_ASSISTANT] = {.name = "assistant", .url = CONFIG_RIGO_ASSISTANT_URL, .timeout_ms = 20000,
+                           .hedge = RIGO_EP_ASSISTANT_HEDGE},
+    [RIGO_EP_TTS] = {.name = "tts", .url = CONFIG_RIGO_TTS_URL, .timeout_ms = 30000, .hedge = RIGO_EP_TTS_HEDGE},
+    [RIGO_EP_TTS_ALT] = {.name = "tts2", .url = CONFIG_RIGO_TTS_URL, .timeout_ms = 30000,
+                         .hedge = RIGO_EP_TTS_ALT_HEDGE},
+    [RIGO_EP_ASSISTANT_HEDGE] = {.name = "assistant_hedge", .url = CONFIG_RIGO_ASSISTANT_SECONDARY_URL,
+                                 .timeout_ms = 20000},
+    [RIGO_EP_TTS_HEDGE] = {.name = "tts_hedge", .url = CONFIG_RIGO_TTS_SECONDARY_URL, .timeout_ms = 30000},
+    [RIGO_EP_TTS_ALT_HEDGE] = {.name = "tts2_hedge", .url = CONFIG_RIGO_TTS_SECONDARY_URL, .timeout_ms = 30000},
+};
+
+static TaskHandle_t prewarm_task;
+static _Atomic uint32_t prewarm_mask;
+static _Thread_local int64_t cur_deadline;
+
+static esp_err_t conn_evt(esp_http_client_event_t *evt)
+{
+    conn_slot_t *s = (conn_slot_t *)evt->user_data;
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+        s->connected = true;
+        s->stats.connects++;
+    } else if (evt->event_id == HTTP_EVENT_DISCONNECTED) {
+        s->connected = false;
+    } else if (evt->event_id == HTTP_EVENT_ON_HEADER) {
+        s->responded = true;
+        if (strcasecmp(evt->header_key, "Content-Type") == 0) {
+            snprintf(s->content_type, sizeof(s->content_type), "%s", evt->header_value);
+        }
+    } else if (evt->event_id == HTTP_EVENT_ON_DATA && s->on_data && evt->data_len > 0) {
+        s->on_data((const char *)evt->data, evt->data_len, s->data_ctx);
+        s->delivered += evt->data_len;
+    }
+    return ESP_OK;
+}
+
+static void set_auth_header(esp_http_client_handle_t c)
+{
+    if (strlen(CONFIG_RIGO_API_BEARER) > 0) {
+        char auth[256];
+        snprintf(auth, sizeof(auth), "Bearer %s", CONFIG_RIGO_API_BEARER);
+        esp_http_client_set_header(c, "Authorization", auth);
+    }
+}
+
+static bool slot_client(conn_slot_t *s)
+{
+    if (s->client) return true;
+
+    esp_http_client_config_t cfg = {
+        .url = s->url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = s->timeout_ms,
+        .event_handler = conn_evt,
+        .user_data = s,
+        .keep_alive_enable = true,
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        .save_client_session = true,
+#endif
+    };
+    s->client = esp_http_client_init(&cfg);
+    if (!s->client) return false;
+    set_auth_header(s->client);
+    return true;
+}
+
+static void slot_close(conn_slot_t *s)
+{
+    if (s->client) esp_http_client_close(s->client);
+    s->connected = false;
+}
+
+// Servers drop idle keep-alive sockets silently; a send on such a socket can
+// still "succeed", so treat anything idle longer than the budget as dead.
+static void drop_if_stale(conn_slot_t *s)
+{
+    if (s->connected && esp_timer_get_time() - s->last_used_us > (int64_t)CONFIG_RIGO_CONN_IDLE_MS * 1000) {
+        ESP_LOGD(TAG, "%s: idle connection dropped", s->name);
+        slot_close(s);
+    }
+}
+
+static conn_slot_t *lock_slot(rigo_ep_t ep)
+{
+    if (ep >= RIGO_EP_COUNT || !rigo_conn_configured(ep)) return NULL;
+    conn_slot_t *s = &slots[ep];
+    xSemaphoreTake(s->lock, portMAX_DELAY);
+    if (!slot_client(s)) {
+        xSemaphoreGive(s->lock);
+        return NULL;
+    }
+    drop_if_stale(s);
+    return s;
+}
+
+static void set_headers(conn_slot_t *s, const char *content_type, const char *accept)
+{
+    esp_http_client_set_method(s->client, HTTP_METHOD_POST);
+    esp_http_client_set_header(s->client, "Content-Type", content_type);
+    if (accept) {
+        esp_http_client_set_header(s->client, "Accept", accept);
+    } else {
+        esp_http_client_delete_header(s->client, "Accept");
+    }
+    s->content_type[0] = 0;
+    s->responded = false;
+}
+
+static void count_failure(conn_slot_t *s, esp_err_t err, int64_t t0)
+{
+    s->stats.failures++;
+    // sync esp_http_client reports most timeouts as generic errors; the clock does not lie
+    if (err == ESP_ERR_HTTP_EAGAIN || err == ESP_ERR_TIMEOUT ||
+        esp_timer_get_time() - t0 >= (int64_t)s->timeout_ms * 1000) {
+        s->stats.timeouts++;
+    }
+}
+
+static void count_status(conn_slot_t *s)
+{
+    if (s->responded && esp_http_client_get_status_code(s->client) >= 400) s->stats.http_errors++;
+}
+
+static esp_err_t send_request(conn_slot_t *s, int write_len, const char *body)
+{
+    esp_err_t err = esp_http_client_open(s->client, write_len);
+    if (err == ESP_OK && body && write_len > 0 && esp_http_client_write(s->client, body, write_len) != write_len) {
+        err = ESP_FAIL;
+    }
+    return err;
+}
+
+static conn_slot_t *hedge_slot(const conn_slot_t *s)
+{
+    return s->hedge && rigo_conn_configured(s->hedge) ? &slots[s->hedge] : NULL;
+}
+
+static conn_slot_t *active_slot(rigo_ep_t ep)
+{
+    return slots[ep].active ? slots[ep].active : &slots[ep];
+}
+
+static void lat_add(conn_slot_t *s, int64_t us)
+{
+    s->lat_ms[s->lat_pos] = MIN(us / 1000, UINT16_MAX);
+    s->lat_pos = (s->lat_pos + 1) % LAT_SAMPLES;
+    if (s->lat_n < LAT_SAMPLES) s->lat_n++;
+}
+
+// CONFIG_RIGO_HEDGE_PERCENTILE of the recent first-byte times: only the
+// slowest few requests are duplicated, whatever the endpoint's usual speed.
+static uint32_t hedge_delay_ms(const conn_slot_t *s)
+{
+    if (s->lat_n < LAT_MIN_SAMPLES) return CONFIG_RIGO_HEDGE_INITIAL_MS;
+    uint16_t v[LAT_SAMPLES];
+    for (int i = 0; i < s->lat_n; i++) {
+        uint16_t x = s->lat_ms[i];
+        int j = i;
+        for (; j > 0 && v[j - 1] > x; j--) v[j] = v[j - 1];
+        v[j] = x;
+    }
+    const int k = (s->lat_n * CONFIG_RIGO_HEDGE_PERCENTILE + 99) / 100 - 1;
+    return MAX(v[MAX(k, 0)], CONFIG_RIGO_HEDGE_MIN_MS);
+}
+
+// Response wait bound: the endpoint timeout, cut short by the caller's deadline.
+static int64_t wait_until(const conn_slot_t *s, int64_t t0)
+{
+    int64_t end = t0 + (int64_t)s->timeout_ms * 1000;
+    return cur_deadline && cur_deadline < end ? cur_deadline : end;
+}
+
+// Nothing by the wait bound: late for the caller's deadline, else a timeout.
+static void count_missed(conn_slot_t *s, int64_t deadline, int64_t t0)
+{
+    if (deadline == cur_deadline) {
+        s->stats.late++;
+    } else {
+        count_failure(s, ESP_ERR_HTTP_EAGAIN, t0);
+    }
+    ESP_LOGW(TAG, "%s: no response in %d ms", s->name, (int)((esp_timer_get_time() - t0) / 1000));
+}
+
+static int ms_until(int64_t t, int64_t now)
+{
+    return t > now ? (int)((t - now + 999) / 1000) : 1;
+}
+
+typedef struct {
+    const char *content_type, *accept, *body;
+    int len;
+} req_t;
+
+// One copy of a request in flight on a locked slot.
+typedef struct {
+    conn_slot_t *s;
+    bool reused;
+    bool live;          // sent, response not started yet
+    int64_t t0;
+} leg_t;
+
+// Sends the request; a failed send on a reused socket is retried once.
+static bool leg_start(leg_t *l, conn_slot_t *s, const req_t *r)
+{
+    l->s = s;
+    l->reused = s->connected;
+    l->t0 = esp_timer_get_time();
+    s->stats.requests++;
+    set_headers(s, r->content_type, r->accept);
+    esp_http_client_set_timeout_ms(s->client, s->timeout_ms);
+    esp_err_t err = send_request(s, r->len, r->body);
+    if (err != ESP_OK && l->reused) {
+        s->stats.retries++;
+        ESP_LOGW(TAG, "%s: reused connection failed, reconnecting", s->name);
+        slot_close(s);
+        l->reused = false;
+        l->t0 = esp_timer_get_time();
+        err = send_request(s, r->len, r->body);
+    }
+    l->live = err == ESP_OK;
+    if (!l->live) {
+        count_failure(s, err, l->t0);
+        ESP_LOGE(TAG, "%s: request failed (%s)", s->name, esp_err_to_name(err));
+        slot_close(s);
+    }
+    return l->live;
+}
+
+// Waits up to wait_ms for the response headers. 1: in, 0: not yet, -1: failed.
+// A dead keep-alive socket usually only shows here, after the write was
+// buffered, so a reused connection gets its one retry at this point too.
+// slice: a poll that is expected to run out (hedge pending or two legs in
+// flight); the sync client warns on every such timeout, so HTTP_CLIENT is
+// held to errors for just this call.
+static int leg_wait(leg_t *l, const req_t *r, int wait_ms, bool slice)
+{
+    conn_slot_t *s = l->s;
+    esp_http_client_set_timeout_ms(s->client, wait_ms);
+    const esp_log_level_t level = esp_log_level_get("HTTP_CLIENT");
+    if (slice) esp_log_level_set("HTTP_CLIENT", MIN(level, ESP_LOG_ERROR));
+    int64_t n = esp_http_client_fetch_headers(s->client);
+    if (slice) esp_log_level_set("HTTP_CLIENT", level);
+    if (n == -ESP_ERR_HTTP_EAGAIN) return 0;
+    if (n >= 0) {
+        esp_http_client_set_timeout_ms(s->client, s->timeout_ms);   // for the body
+        if (l->reused) s->stats.reuses++;
+        l->live = false;
+        return 1;
+    }
+    if (l->reused) {
+        s->stats.retries++;
+        ESP_LOGW(TAG, "%s: reused connection failed, reconnecting", s->name);
+        slot_close(s);
+        l->reused = false;
+        l->t0 = esp_timer_get_time();
+        set_headers(s, r->content_type, r->accept);
+        esp_http_client_set_timeout_ms(s->client, s->timeout_ms);
+        if (send_request(s, r->len, r->body) == ESP_OK) return 0;
+    }
+    count_failure(s, ESP_FAIL, l->t0);
+    ESP_LOGE(TAG, "%s: request failed", s->name);
+    slot_close(s);
+    l->live = false;
+    return -1;
+}
+
+// Sends the request on the locked slot p and waits for the response to start,
+// hedging to p's secondary when one is configured. The first leg with headers
+// wins and the other is closed, which is the only way to cancel a request
+// on a sync client. Returns the winning slot, or NULL with every connection
+// closed; p stays locked either way, a winning secondary until release.
+static conn_slot_t *exchange(conn_slot_t *p, const req_t *r)
+{
+    const int64_t t0 = esp_timer_get_time();
+    const int64_t deadline = wait_until(p, t0);
+    conn_slot_t *h = hedge_slot(p);
+    int64_t hedge_at = INT64_MAX;
+    if (h) {
+        p->stats.hedge_ms = hedge_delay_ms(p);
+        hedge_at = t0 + (int64_t)p->stats.hedge_ms * 1000;
+    }
+
+    leg_t legs[2] = {0};
+    int n = 1;
+    leg_start(&legs[0], p, r);
+    bool hedged = !h;
+    int won = -1;
+    int64_t now = esp_timer_get_time();
+    while (won < 0 && now < deadline) {
+        // a primary that fails outright fails over at once
+        if (!hedged && (now >= hedge_at || !legs[0].live)) {
+            hedged = true;
+            // prewarm may hold the secondary for a moment; never wait on it
+            if (xSemaphoreTake(h->lock, 0) == pdTRUE) {
+                if (slot_client(h)) {
+                    drop_if_stale(h);
+                    p->stats.hedges++;
+                    ESP_LOGI(TAG, "%s: no response after %d ms, hedging to %s", p->name,
+                             (int)((now - t0) / 1000), h->name);
+                    leg_start(&legs[1], h, r);
+                }
+                n = 2;
+            }
+        }
+        const int live = legs[0].live + legs[1].live;
+        if (live == 0) break;
+        for (int i = 0; i < n && won < 0; i++) {
+            if (!legs[i].live) continue;
+            int64_t until = deadline;
+            if (live > 1) until = MIN(until, now + SLICE_MS * 1000);
+            else if (!hedged) until = MIN(until, hedge_at);
+            if (leg_wait(&legs[i], r, ms_until(until, now), until < deadline) > 0) won = i;
+            now = esp_timer_get_time();
+        }
+    }
+
+    if (won < 0 && now >= deadline) count_missed(p, deadline, t0);
+    for (int i = 0; i < n; i++) {
+        if (i != won && legs[i].live) slot_close(legs[i].s);
+    }
+    if (n == 2 && won != 1) {
+        h->last_used_us = esp_timer_get_time();
+        xSemaphoreGive(h->lock);
+    }
+    if (won < 0) return NULL;
+
+    conn_slot_t *w = legs[won].s;
+    lat_add(w, now - legs[won].t0);
+    if (w == h) p->stats.hedge_wins++;
+    ESP_LOGD(TAG, "%s: %s connection, %d ms", w->name, legs[won].reused ? "reused" : "new",
+             (int)((now - t0) / 1000));
+    return w;
+}
+
+static esp_http_client_handle_t do_request(rigo_ep_t ep, const req_t *r, bool fetch)
+{
+    conn_slot_t *s = lock_slot(ep);
+    if (!s) return NULL;
+    s->active = NULL;
+
+    if (fetch) {
+        conn_slot_t *w = exchange(s, r);
+        if (!w) {
+            xSemaphoreGive(s->lock);
+            return NULL;
+        }
+        s->active = w;
+        return w->client;
+    }
+
+    leg_t l;
+    if (!leg_start(&l, s, r)) {
+        xSemaphoreGive(s->lock);
+        return NULL;
+    }
+    if (l.reused) s->stats.reuses++;
+    return s->client;
+}
+
+esp_http_client_handle_t rigo_conn_open(rigo_ep_t ep, const char *content_type, const char *accept, int write_len)
+{
+    req_t r = {.content_type = content_type, .accept = accept, .len = write_len};
+    return do_request(ep, &r, false);
+}
+
+int rigo_conn_wait_response(rigo_ep_t ep)
+{
+    conn_slot_t *s = &slots[ep];
+    const int64_t t0 = esp_timer_get_time();
+    const int64_t deadline = wait_until(s, t0);
+    esp_http_client_set_timeout_ms(s->client, ms_until(deadline, t0));
+    int64_t n = esp_http_client_fetch_headers(s->client);
+    esp_http_client_set_timeout_ms(s->client, s->timeout_ms);
+    if (n >= 0) {
+        lat_add(s, esp_timer_get_time() - t0);
+        return 1;
+    }
+    if (n == -ESP_ERR_HTTP_EAGAIN && esp_timer_get_time() >= deadline) {
+        count_missed(s, deadline, t0);
+        return 0;
+    }
+    count_failure(s, ESP_FAIL, t0);
+    return -1;
+}
+
+esp_http_client_handle_t rigo_conn_request(rigo_ep_t ep, const char *content_type, const char *accept,
+                                           const char *body, int len)
+{
+    req_t r = {.content_type = content_type, .accept = accept, .body = body, .len = len};
+    return do_request(ep, &r, true);
+}
+
+int rigo_conn_perform(rigo_ep_t ep, const char *content_type, const char *accept,
+                      const char *body, int len, rigo_conn_data_cb_t on_data, void *ctx)
+{
+    conn_slot_t *s = lock_slot(ep);
+    if (!s) return -1;
+    s->active = NULL;
+
+    // both legs deliver; only the winner gets past its headers before the
+    // other is closed, so the callback sees a single body
+    conn_slot_t *h = hedge_slot(s);
+    for (conn_slot_t *x = s; x; x = x == s ? h : NULL) {
+        x->on_data = on_data;
+        x->data_ctx = ctx;
+        x->delivered = 0;
+    }
+
+    req_t r = {.content_type = content_type, .accept = accept, .body = body, .len = len};
+    conn_slot_t *w = exchange(s, &r);
+    int status = -1;
+    if (w) {
+        // the data goes out through on_data as each read is parsed; this
+        // buffer only drains the client
+        char sink[256];
+        int64_t t0 = esp_timer_get_time();
+        int rd;
+        while ((rd = esp_http_client_read(w->client, sink, sizeof(sink))) > 0) {
+        }
+        if (rd < 0 || !esp_http_client_is_complete_data_received(w->client)) {
+            count_failure(w, ESP_FAIL, t0);
+            ESP_LOGE(TAG, "%s: response cut short", w->name);
+            slot_close(w);
+        } else {
+            count_status(w);
+            status = esp_http_client_get_status_code(w->client);
+        }
+        w->last_used_us = esp_timer_get_time();
+        if (w != s) xSemaphoreGive(w->lock);
+    }
+
+    for (conn_slot_t *x = s; x; x = x == s ? h : NULL) {
+        x->on_data = NULL;
+        x->data_ctx = NULL;
+    }
+    s->last_used_us = esp_timer_get_time();
+    xSemaphoreGive(s->lock);
+    return status;
+}
+
+int rigo_conn_status(rigo_ep_t ep)
+{
+    conn_slot_t *s = active_slot(ep);
+    return s->client ? esp_http_client_get_status_code(s->client) : -1;
+}
+
+const char *rigo_conn_content_type(rigo_ep_t ep)
+{
+    return active_slot(ep)->content_type;
+}
+
+void rigo_conn_release(rigo_ep_t ep, bool keep)
+{
+    conn_slot_t *s = &slots[ep], *a = active_slot(ep);
+    count_status(a);
+    if (!keep || !esp_http_client_is_complete_data_received(a->client)) {
+        slot_close(a);
+    }
+    a->last_used_us = s->last_used_us = esp_timer_get_time();
+    if (a != s) xSemaphoreGive(a->lock);
+    s->active = NULL;
+    xSemaphoreGive(s->lock);
+}
+
+int64_t rigo_conn_deadline_enter(int64_t deadline_us)
+{
+    int64_t prev = cur_deadline;
+    cur_deadline = deadline_us;
+    return prev;
+}
+
+int64_t rigo_conn_deadline(void)
+{
+    return cur_deadline;
+}
+
+static void prewarm_one(conn_slot_t *s)
+{
+    if (xSemaphoreTake(s->lock, 0) != pdTRUE) return;  // in use right now, nothing to warm
+    if (slot_client(s)) {
+        drop_if_stale(s);
+        if (!s->connected) {
+            int64_t t0 = esp_timer_get_time();
+            // HEAD is cheap on any server; a 404/405 still leaves a warm keep-alive socket
+            esp_http_client_set_method(s->client, HTTP_METHOD_HEAD);
+            esp_err_t err = esp_http_client_perform(s->client);
+            esp_http_client_set_method(s->client, HTTP_METHOD_POST);
+            if (err != ESP_OK) slot_close(s);
+            ESP_LOGI(TAG, "%s: prewarm %s in %d ms", s->name, err == ESP_OK ? "ok" : "failed",
+                     (int)((esp_timer_get_time() - t0) / 1000));
+        }
+        s->last_used_us = esp_timer_get_time();
+    }
+    xSemaphoreGive(s->lock);
+}
+
+static void prewarm_task_fn(void *arg)
+{
+    (void)arg;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // bits set after the exchange come with a fresh notification
+        uint32_t mask = atomic_exchange(&prewarm_mask, 0);
+        for (int ep = 0; ep < RIGO_EP_COUNT; ep++) {
+            if (!(mask & RIGO_EP_BIT(ep)) || !rigo_conn_configured(ep)) continue;
+            prewarm_one(&slots[ep]);
+            conn_slot_t *h = hedge_slot(&slots[ep]);
+            if (h) prewarm_one(h);
+        }
+    }
+}
+
+esp_err_t rigo_conn_init(void)
+{
+    for (int ep = 0; ep < RIGO_EP_COUNT; ep++) {
+        slots[ep].lock = xSemaphoreCreateMutex();
+        if (!slots[ep].lock) return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(prewarm_task_fn, "conn_warm", 6 * 1024, NULL, 4, &prewarm_task, 0) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool rigo_conn_configured(rigo_ep_t ep)
+{
+    return ep < RIGO_EP_COUNT && slots[ep].url && strlen(slots[ep].url) > 0;
+}
+
+void rigo_conn_prewarm(uint32_t ep_mask)
+{
+    if (!prewarm_task) return;
+    atomic_fetch_or(&prewarm_mask, ep_mask);
+    xTaskNotifyGive(prewarm_task);
+}
+
+void rigo_conn_get_stats(rigo_ep_t ep, rigo_conn_stats_t *out)
+{
+    *out = slots[ep].stats;
+}
+
+const char *rigo_conn_name(rigo_ep_t ep)
+{
+    return ep < RIGO_EP_COUNT ? slots[ep].name : "?";
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_http_client.h"
+
+typedef enum {
+    RIGO_EP_STT = 0,
+    RIGO_EP_ASSISTANT,
+    RIGO_EP_TTS,
+    RIGO_EP_TTS_ALT,    // second TTS connection so the next segment can be fetched in parallel
+    // secondaries that slow requests are hedged to; unused while their URL is empty
+    RIGO_EP_ASSISTANT_HEDGE,
+    RIGO_EP_TTS_HEDGE,
+    RIGO_EP_TTS_ALT_HEDGE,
+    RIGO_EP_COUNT
+} rigo_ep_t;
+
+#define RIGO_EP_BIT(ep) (1u << (ep))
+
+typedef struct {
+    uint32_t requests;
+    uint32_t connects;
+    uint32_t reuses;
+    uint32_t retries;
+    uint32_t failures;      // transport errors after the retry (includes timeouts)
+    uint32_t timeouts;
+    uint32_t http_errors;   // responses with status >= 400
+    uint32_t late;          // no response by the caller's deadline
+    uint32_t hedges;        // requests also sent to the secondary
+    uint32_t hedge_wins;    // ... and answered there first
+    uint32_t hedge_ms;      // current hedge delay, 0 without a secondary
+} rigo_conn_stats_t;
+
+// One long-lived esp_http_client per endpoint, kept open across turns
+// (HTTP keep-alive) with TLS session tickets for cheap reconnects.
+esp_err_t rigo_conn_init(void);
+bool rigo_conn_configured(rigo_ep_t ep);
+
+// Deadline for requests made by the calling task, in esp_timer microseconds
+// (0: none, the endpoint's own timeout applies). The response must start by
+// then or the request fails. Returns the previous deadline.
+int64_t rigo_conn_deadline_enter(int64_t deadline_us);
+int64_t rigo_conn_deadline(void);
+
+// Open a request with a streamed body (write_len < 0: chunked). On success the
+// endpoint is locked until rigo_conn_release. Stale idle connections are
+// dropped first and a failed send on a reused socket is retried once.
+// accept may be NULL.
+esp_http_client_handle_t rigo_conn_open(rigo_ep_t ep, const char *content_type, const char *accept, int write_len);
+
+// Waits for the response headers of a request opened with rigo_conn_open,
+// until the calling task's deadline. 1: headers in, 0: deadline passed,
+// -1: error. The endpoint stays locked either way.
+int rigo_conn_wait_response(rigo_ep_t ep);
+
+// open + write a body held in memory + fetch headers, with the same retry
+// rule. With a secondary configured the request is hedged: if the response
+// has not started after the hedge delay (CONFIG_RIGO_HEDGE_PERCENTILE of the
+// endpoint's recent first-byte times), it is sent to the secondary too and
+// the first to answer wins; the other connection is closed. The returned
+// client may belong to the secondary; ep still names the request for
+// status, content type and release.
+esp_http_client_handle_t rigo_conn_request(rigo_ep_t ep, const char *content_type, const char *accept,
+                                           const char *body, int len);
+
+// keep: response fully consumed and the connection may be reused.
+void rigo_conn_release(rigo_ep_t ep, bool keep);
+
+// Response status and Content-Type of the current request (valid until release).
+int rigo_conn_status(rigo_ep_t ep);
+const char *rigo_conn_content_type(rigo_ep_t ep);
+
+typedef void (*rigo_conn_data_cb_t)(const char *data, int len, void *ctx);
+
+// Whole request in one call, hedged like rigo_conn_request; body bytes are
+// handed to on_data as each socket read is parsed, without waiting for a read
+// buffer to fill. Returns the HTTP status or -1. The endpoint is released
+// before returning.
+int rigo_conn_perform(rigo_ep_t ep, const char *content_type, const char *accept,
+                      const char *body, int len, rigo_conn_data_cb_t on_data, void *ctx);
+
+// Connect the given endpoints in the background (non-blocking).
+void rigo_conn_prewarm(uint32_t ep_mask);
+
+void rigo_conn_get_stats(rigo_ep_t ep, rigo_conn_stats_t *out);
+const char *rigo_conn_name(rigo_ep_t ep);
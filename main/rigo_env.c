@@ -0,0 +1,56 @@
+#include "rigo_env.h"
+
+static uint32_t isqrt32(uint32_t x)
+{
+    uint32_t r = 0, bit = 1u << 30;
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+void rigo_env_measure(const int16_t *pcm, int samples, rigo_env_t *out)
+{
+    // four independent accumulators keep the MAC pipeline busy; each lane
+    // sums at most samples/4 squares < 2^30, so 64-bit never overflows
+    uint64_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+    int32_t lo = 0, hi = 0;
+    int i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        int32_t s0 = pcm[i], s1 = pcm[i + 1], s2 = pcm[i + 2], s3 = pcm[i + 3];
+        a0 += (uint32_t)(s0 * s0);
+        a1 += (uint32_t)(s1 * s1);
+        a2 += (uint32_t)(s2 * s2);
+        a3 += (uint32_t)(s3 * s3);
+        int32_t mn = s0 < s1 ? s0 : s1, mx = s0 < s1 ? s1 : s0;
+        int32_t mn2 = s2 < s3 ? s2 : s3, mx2 = s2 < s3 ? s3 : s2;
+        if (mn2 < mn) mn = mn2;
+        if (mx2 > mx) mx = mx2;
+        if (mn < lo) lo = mn;
+        if (mx > hi) hi = mx;
+    }
+    for (; i < samples; i++) {
+        int32_t s = pcm[i];
+        a0 += (uint32_t)(s * s);
+        if (s < lo) lo = s;
+        if (s > hi) hi = s;
+    }
+
+    uint32_t peak = -lo > hi ? -lo : hi;
+    out->peak = peak > 0xffff ? 0xffff : peak;
+    out->rms = samples > 0 ? isqrt32((uint32_t)((a0 + a1 + a2 + a3) / samples)) : 0;
+}
+
+uint8_t rigo_env_level(uint32_t amplitude)
+{
+    // sqrt(32768) = 181
+    uint32_t l = isqrt32(amplitude) * 255 / 181;
+    return l > 255 ? 255 : l;
+}
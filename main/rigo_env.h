@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+// Amplitude envelope of one PCM16 frame (interleaved channels are fine).
+typedef struct {
+    uint16_t rms;
+    uint16_t peak;
+} rigo_env_t;
+
+void rigo_env_measure(const int16_t *pcm, int samples, rigo_env_t *out);
+
+// 0..255 on a square-root scale so quiet speech still moves the mouth.
+uint8_t rigo_env_level(uint32_t amplitude);
@@ -0,0 +1,371 @@
+#include "rigo_metrics.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_timer.h"
+
+#include "rigo_arena.h"
+#include "rigo_conn.h"
+#include "rigo_mic.h"
+#include "rigo_player.h"
+#include "rigo_stt_ws.h"
+
+static const char *stage_names[RIGO_MARK_COUNT] = {
+    "wake", "capture_end", "stt_sent", "stt_first_byte", "stt_done",
+    "assistant_done", "tts_first_byte", "play_start", "play_end",
+};
+
+// upper bounds in ms; one more bucket catches everything above
+static const uint16_t bounds_ms[] = {
+    25, 50, 100, 150, 200, 300, 400, 500, 750, 1000,
+    1500, 2000, 3000, 4000, 6000, 8000, 12000, 20000,
+};
+#define NBOUNDS (sizeof(bounds_ms) / sizeof(bounds_ms[0]))
+
+typedef struct {
+    uint32_t buckets[NBOUNDS + 1];
+    uint32_t count;
+    uint32_t max_ms;
+    uint64_t sum_ms;
+} hist_t;
+
+typedef struct {
+    uint32_t turns;
+    hist_t since_wake[RIGO_MARK_COUNT];  // stage time measured from the wake word
+    hist_t delta[RIGO_MARK_COUNT];       // stage time measured from the stage reached just before it
+} metrics_t;
+
+// open turns: one capturing, one waiting for the assistant, one speaking
+#define OPEN_TURNS 4
+
+typedef struct {
+    uint32_t id;        // 0: slot free
+    int64_t marks[RIGO_MARK_COUNT];
+} turn_t;
+
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+static turn_t open_turns[OPEN_TURNS];
+static uint32_t next_id = 1;
+static metrics_t m;
+
+static void hist_add(hist_t *h, uint32_t ms)
+{
+    size_t b = 0;
+    while (b < NBOUNDS && ms > bounds_ms[b]) b++;
+    h->buckets[b]++;
+    h->count++;
+    h->sum_ms += ms;
+    if (ms > h->max_ms) h->max_ms = ms;
+}
+
+// Linear interpolation inside the bucket holding the q-th observation.
+static uint32_t hist_quantile(const hist_t *h, int q_pct)
+{
+    if (h->count == 0) return 0;
+    uint64_t rank = ((uint64_t)h->count * q_pct + 99) / 100;
+    uint32_t seen = 0;
+    for (size_t b = 0; b <= NBOUNDS; b++) {
+        if (seen + h->buckets[b] >= rank) {
+            if (b == NBOUNDS) return h->max_ms;
+            uint32_t lo = b ? bounds_ms[b - 1] : 0;
+            uint32_t hi = bounds_ms[b] < h->max_ms ? bounds_ms[b] : h->max_ms;
+            if (hi < lo) hi = lo;
+            return lo + (uint32_t)((uint64_t)(hi - lo) * (rank - seen) / h->buckets[b]);
+        }
+        seen += h->buckets[b];
+    }
+    return h->max_ms;
+}
+
+uint32_t rigo_metrics_turn_begin(void)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&mux);
+    // a turn that never ended gives its slot to the new one
+    turn_t *t = &open_turns[0];
+    for (int i = 0; i < OPEN_TURNS; i++) {
+        if (!open_turns[i].id) {
+            t = &open_turns[i];
+            break;
+        }
+        if (open_turns[i].id < t->id) t = &open_turns[i];
+    }
+    memset(t, 0, sizeof(*t));
+    t->id = next_id++;
+    if (!next_id) next_id = 1;
+    t->marks[RIGO_MARK_WAKE] = now;
+    uint32_t id = t->id;
+    portEXIT_CRITICAL(&mux);
+    return id;
+}
+
+void rigo_metrics_mark(uint32_t turn, rigo_mark_t mk)
+{
+    if (!turn) return;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < OPEN_TURNS; i++) {
+        turn_t *t = &open_turns[i];
+        if (t->id == turn && !t->marks[mk]) t->marks[mk] = now;
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+void rigo_metrics_turn_end(uint32_t turn)
+{
+    portENTER_CRITICAL(&mux);
+    for (int k = 0; k < OPEN_TURNS; k++) {
+        if (!turn || open_turns[k].id != turn) continue;
+        const int64_t *marks = open_turns[k].marks;
+        m.turns++;
+        for (int i = 1; i < RIGO_MARK_COUNT; i++) {
+            if (!marks[i]) continue;
+            // previous in time, not in enum order: with a streaming assistant
+            // TTS starts before the assistant is done
+            int64_t prev = marks[RIGO_MARK_WAKE];
+            for (int j = 1; j < RIGO_MARK_COUNT; j++) {
+                if (j != i && marks[j] > prev && (marks[j] < marks[i] || (marks[j] == marks[i] && j < i))) {
+                    prev = marks[j];
+                }
+            }
+            hist_add(&m.since_wake[i], (uint32_t)((marks[i] - marks[RIGO_MARK_WAKE]) / 1000));
+            hist_add(&m.delta[i], (uint32_t)((marks[i] - prev) / 1000));
+        }
+        open_turns[k].id = 0;
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+// ---- output ----
+
+typedef struct {
+    rigo_metrics_emit_t emit;
+    void *ctx;
+    int len;
+    char buf[512];
+} out_t;
+
+static void out_flush(out_t *o)
+{
+    if (o->len > 0) o->emit(o->buf, o->len, o->ctx);
+    o->len = 0;
+}
+
+static void outf(out_t *o, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void outf(out_t *o, const char *fmt, ...)
+{
+    if (o->len > (int)sizeof(o->buf) - 160) out_flush(o);
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->len, sizeof(o->buf) - o->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) o->len += n < (int)sizeof(o->buf) - o->len ? n : (int)sizeof(o->buf) - o->len - 1;
+}
+
+static metrics_t *snapshot(void)
+{
+    metrics_t *snap = malloc(sizeof(*snap));
+    if (!snap) return NULL;
+    portENTER_CRITICAL(&mux);
+    *snap = m;
+    portEXIT_CRITICAL(&mux);
+    return snap;
+}
+
+static void json_hist(out_t *o, const char *name, const hist_t *h)
+{
+    outf(o, "\"%s\":{\"count\":%u,\"p50\":%u,\"p95\":%u,\"p99\":%u,\"max\":%u,\"sum\":%llu}", name,
+         (unsigned)h->count, (unsigned)hist_quantile(h, 50), (unsigned)hist_quantile(h, 95),
+         (unsigned)hist_quantile(h, 99), (unsigned)h->max_ms, (unsigned long long)h->sum_ms);
+}
+
+void rigo_metrics_write_json(rigo_metrics_emit_t emit, void *ctx)
+{
+    out_t *o = calloc(1, sizeof(*o));
+    metrics_t *snap = snapshot();
+    if (!o || !snap) {
+        free(o);
+        free(snap);
+        return;
+    }
+    o->emit = emit;
+    o->ctx = ctx;
+
+    outf(o, "{\"turns\":%u,\"stages_ms\":{", (unsigned)snap->turns);
+    for (int i = 1; i < RIGO_MARK_COUNT; i++) {
+        outf(o, "%s\"%s\":{", i > 1 ? "," : "", stage_names[i]);
+        json_hist(o, "since_wake", &snap->since_wake[i]);
+        outf(o, ",");
+        json_hist(o, "from_prev", &snap->delta[i]);
+        outf(o, "}");
+    }
+    outf(o, "},\"endpoints\":{");
+    for (int ep = 0; ep < RIGO_EP_COUNT; ep++) {
+        rigo_conn_stats_t st;
+        rigo_conn_get_stats(ep, &st);
+        outf(o, "%s\"%s\":{\"requests\":%u,\"connects\":%u,\"reuses\":%u,\"retries\":%u,"
+             "\"failures\":%u,\"timeouts\":%u,\"http_errors\":%u,",
+             ep ? "," : "", rigo_conn_name(ep), (unsigned)st.requests, (unsigned)st.connects,
+             (unsigned)st.reuses, (unsigned)st.retries, (unsigned)st.failures, (unsigned)st.timeouts,
+             (unsigned)st.http_errors);
+        outf(o, "\"late\":%u,\"hedges\":%u,\"hedge_wins\":%u,\"hedge_ms\":%u}", (unsigned)st.late,
+             (unsigned)st.hedges, (unsigned)st.hedge_wins, (unsigned)st.hedge_ms);
+    }
+    rigo_mic_stats_t mic;
+    rigo_mic_get_stats(&mic);
+    outf(o, "},\"mic\":{\"ring_ms\":%u,\"frames\":%u,\"overruns\":%u,\"lost_ms\":%u,\"codec_errors\":%u}",
+         (unsigned)mic.ring_ms, (unsigned)mic.frames, (unsigned)mic.overruns,
+         (unsigned)(mic.lost_samples / (RIGO_MIC_RATE / 1000)), (unsigned)mic.codec_errors);
+    rigo_player_stats_t ps;
+    rigo_player_get_stats(&ps);
+    outf(o, ",\"barge_in\":{\"count\":%u,\"stop_max_ms\":%u}", (unsigned)ps.stops, (unsigned)ps.stop_max_ms);
+#if CONFIG_RIGO_STT_WS
+    rigo_stt_ws_stats_t ws;
+    rigo_stt_ws_get_stats(&ws);
+    outf(o, ",\"stt_ws\":{\"sessions\":%u,\"connects\":%u,\"reuses\":%u,\"partials\":%u,\"finals\":%u,",
+         (unsigned)ws.sessions, (unsigned)ws.connects, (unsigned)ws.reuses, (unsigned)ws.partials,
+         (unsigned)ws.finals);
+    outf(o, "\"early_finals\":%u,\"failures\":%u,\"late\":%u,\"final_ms_last\":%u,\"final_ms_max\":%u}",
+         (unsigned)ws.early_finals, (unsigned)ws.failures, (unsigned)ws.late, (unsigned)ws.final_ms_last,
+         (unsigned)ws.final_ms_max);
+#endif
+    rigo_arena_stats_t ar;
+    rigo_arena_get_stats(&ar);
+    outf(o, ",\"memory\":{\"arena_kb\":%u,\"arenas\":%d,\"arena_turns\":%u,\"arena_busy\":%u,"
+         "\"arena_overflows\":%u,\"arena_peak_last\":%u,\"arena_peak_max\":%u,",
+         (unsigned)(ar.size / 1024), ar.slots, (unsigned)ar.turns, (unsigned)ar.no_slot, (unsigned)ar.overflows,
+         (unsigned)ar.last_peak, (unsigned)ar.max_peak);
+    outf(o, "\"spiram_free\":%u,\"spiram_largest\":%u,\"spiram_min_free\":%u,\"internal_free\":%u,"
+         "\"internal_largest\":%u}}",
+         (unsigned)ar.spiram_free, (unsigned)ar.spiram_largest, (unsigned)ar.spiram_min_free,
+         (unsigned)ar.internal_free, (unsigned)ar.internal_largest);
+    out_flush(o);
+    free(snap);
+    free(o);
+}
+
+static void prom_hist(out_t *o, const char *metric, const char *stage, const hist_t *h)
+{
+    uint32_t cum = 0;
+    for (size_t b = 0; b < NBOUNDS; b++) {
+        cum += h->buckets[b];
+        outf(o, "%s_bucket{stage=\"%s\",le=\"%u\"} %u\n", metric, stage, bounds_ms[b], (unsigned)cum);
+    }
+    outf(o, "%s_bucket{stage=\"%s\",le=\"+Inf\"} %u\n", metric, stage, (unsigned)h->count);
+    outf(o, "%s_sum{stage=\"%s\"} %llu\n", metric, stage, (unsigned long long)h->sum_ms);
+    outf(o, "%s_count{stage=\"%s\"} %u\n", metric, stage, (unsigned)h->count);
+}
+
+static void prom_quantiles(out_t *o, const char *metric, const char *stage, const hist_t *h)
+{
+    static const int qs[] = {50, 95, 99};
+    for (size_t i = 0; i < sizeof(qs) / sizeof(qs[0]); i++) {
+        outf(o, "%s{stage=\"%s\",quantile=\"0.%02d\"} %u\n", metric, stage, qs[i],
+             (unsigned)hist_quantile(h, qs[i]));
+    }
+}
+
+void rigo_metrics_write_prometheus(rigo_metrics_emit_t emit, void *ctx)
+{
+    out_t *o = calloc(1, sizeof(*o));
+    metrics_t *snap = snapshot();
+    if (!o || !snap) {
+        free(o);
+        free(snap);
+        return;
+    }
+    o->emit = emit;
+    o->ctx = ctx;
+
+    outf(o, "# TYPE rigo_turns_total counter\nrigo_turns_total %u\n", (unsigned)snap->turns);
+
+    outf(o, "# HELP rigo_stage_ms Time from the wake word to each pipeline stage.\n");
+    outf(o, "# TYPE rigo_stage_ms histogram\n");
+    for (int i = 1; i < RIGO_MARK_COUNT; i++) prom_hist(o, "rigo_stage_ms", stage_names[i], &snap->since_wake[i]);
+    outf(o, "# HELP rigo_stage_delta_ms Time from the previous stage reached to each stage.\n");
+    outf(o, "# TYPE rigo_stage_delta_ms histogram\n");
+    for (int i = 1; i < RIGO_MARK_COUNT; i++) prom_hist(o, "rigo_stage_delta_ms", stage_names[i], &snap->delta[i]);
+
+    outf(o, "# TYPE rigo_stage_quantile_ms gauge\n");
+    for (int i = 1; i < RIGO_MARK_COUNT; i++) {
+        prom_quantiles(o, "rigo_stage_quantile_ms", stage_names[i], &snap->since_wake[i]);
+    }
+    outf(o, "# TYPE rigo_stage_delta_quantile_ms gauge\n");
+    for (int i = 1; i < RIGO_MARK_COUNT; i++) {
+        prom_quantiles(o, "rigo_stage_delta_quantile_ms", stage_names[i], &snap->delta[i]);
+    }
+
+    static const char *counters[] = {
+        "requests", "connects", "reuses", "retries", "failures", "timeouts", "http_errors",
+        "late", "hedges", "hedge_wins",
+    };
+    for (size_t c = 0; c < sizeof(counters) / sizeof(counters[0]); c++) {
+        outf(o, "# TYPE rigo_http_%s_total counter\n", counters[c]);
+        for (int ep = 0; ep < RIGO_EP_COUNT; ep++) {
+            rigo_conn_stats_t st;
+            rigo_conn_get_stats(ep, &st);
+            const uint32_t v[] = {st.requests, st.connects, st.reuses, st.retries, st.failures, st.timeouts,
+                                  st.http_errors, st.late, st.hedges, st.hedge_wins};
+            outf(o, "rigo_http_%s_total{endpoint=\"%s\"} %u\n", counters[c], rigo_conn_name(ep), (unsigned)v[c]);
+        }
+    }
+    outf(o, "# TYPE rigo_http_hedge_delay_ms gauge\n");
+    for (int ep = 0; ep < RIGO_EP_COUNT; ep++) {
+        rigo_conn_stats_t st;
+        rigo_conn_get_stats(ep, &st);
+        outf(o, "rigo_http_hedge_delay_ms{endpoint=\"%s\"} %u\n", rigo_conn_name(ep), (unsigned)st.hedge_ms);
+    }
+
+    rigo_mic_stats_t mic;
+    rigo_mic_get_stats(&mic);
+    outf(o, "# HELP rigo_mic_overruns_total Mic readers lapped by the ingest ring.\n");
+    outf(o, "# TYPE rigo_mic_overruns_total counter\nrigo_mic_overruns_total %u\n", (unsigned)mic.overruns);
+    outf(o, "# TYPE rigo_mic_lost_ms_total counter\nrigo_mic_lost_ms_total %u\n",
+         (unsigned)(mic.lost_samples / (RIGO_MIC_RATE / 1000)));
+    outf(o, "# TYPE rigo_mic_codec_errors_total counter\nrigo_mic_codec_errors_total %u\n",
+         (unsigned)mic.codec_errors);
+    rigo_player_stats_t ps;
+    rigo_player_get_stats(&ps);
+    outf(o, "# HELP rigo_barge_ins_total Replies cut off by a wake word.\n");
+    outf(o, "# TYPE rigo_barge_ins_total counter\nrigo_barge_ins_total %u\n", (unsigned)ps.stops);
+    outf(o, "# TYPE rigo_barge_in_stop_max_ms gauge\nrigo_barge_in_stop_max_ms %u\n", (unsigned)ps.stop_max_ms);
+#if CONFIG_RIGO_STT_WS
+    rigo_stt_ws_stats_t ws;
+    rigo_stt_ws_get_stats(&ws);
+    static const char *ws_counters[] = {
+        "sessions", "connects", "reuses", "partials", "finals", "early_finals", "failures", "late",
+    };
+    const uint32_t ws_v[] = {ws.sessions, ws.connects, ws.reuses, ws.partials,
+                             ws.finals, ws.early_finals, ws.failures, ws.late};
+    outf(o, "# HELP rigo_stt_ws_sessions_total Utterances streamed over the STT WebSocket.\n");
+    for (size_t c = 0; c < sizeof(ws_counters) / sizeof(ws_counters[0]); c++) {
+        outf(o, "# TYPE rigo_stt_ws_%s_total counter\nrigo_stt_ws_%s_total %u\n", ws_counters[c], ws_counters[c],
+             (unsigned)ws_v[c]);
+    }
+    outf(o, "# HELP rigo_stt_ws_final_ms End of speech to the final transcript.\n");
+    outf(o, "# TYPE rigo_stt_ws_final_ms gauge\nrigo_stt_ws_final_ms{turn=\"last\"} %u\n"
+         "rigo_stt_ws_final_ms{turn=\"max\"} %u\n", (unsigned)ws.final_ms_last, (unsigned)ws.final_ms_max);
+#endif
+    rigo_arena_stats_t ar;
+    rigo_arena_get_stats(&ar);
+    outf(o, "# HELP rigo_arena_overflows_total Turn allocations that did not fit the arena.\n");
+    outf(o, "# TYPE rigo_arena_overflows_total counter\nrigo_arena_overflows_total %u\n", (unsigned)ar.overflows);
+    outf(o, "# TYPE rigo_arena_busy_total counter\nrigo_arena_busy_total %u\n", (unsigned)ar.no_slot);
+    outf(o, "# TYPE rigo_arena_peak_bytes gauge\nrigo_arena_peak_bytes{turn=\"last\"} %u\n"
+         "rigo_arena_peak_bytes{turn=\"max\"} %u\n", (unsigned)ar.last_peak, (unsigned)ar.max_peak);
+    outf(o, "# HELP rigo_heap_largest_free_bytes Largest free heap block after the last turn.\n");
+    outf(o, "# TYPE rigo_heap_largest_free_bytes gauge\nrigo_heap_largest_free_bytes{heap=\"spiram\"} %u\n"
+         "rigo_heap_largest_free_bytes{heap=\"internal\"} %u\n", (unsigned)ar.spiram_largest,
+         (unsigned)ar.internal_largest);
+    outf(o, "# TYPE rigo_heap_free_bytes gauge\nrigo_heap_free_bytes{heap=\"spiram\"} %u\n"
+         "rigo_heap_free_bytes{heap=\"internal\"} %u\n", (unsigned)ar.spiram_free, (unsigned)ar.internal_free);
+    out_flush(o);
+    free(snap);
+    free(o);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+// Per-turn stage timestamps folded into fixed-bucket histograms.
+typedef enum {
+    RIGO_MARK_WAKE = 0,
+    RIGO_MARK_CAPTURE_END,
+    RIGO_MARK_STT_SENT,
+    RIGO_MARK_STT_FIRST_BYTE,
+    RIGO_MARK_STT_DONE,
+    RIGO_MARK_ASSISTANT_DONE,
+    RIGO_MARK_TTS_FIRST_BYTE,
+    RIGO_MARK_PLAY_START,
+    RIGO_MARK_PLAY_END,
+    RIGO_MARK_COUNT
+} rigo_mark_t;
+
+// Starts a turn (marks WAKE) and returns its id. Turns overlap in the stage
+// pipeline, so every mark names its turn; the first mark of a stage counts,
+// and marks for turn 0 or a turn that already ended are dropped.
+uint32_t rigo_metrics_turn_begin(void);
+void rigo_metrics_mark(uint32_t turn, rigo_mark_t m);
+// Folds the turn's marks into the histograms; stages never reached are skipped.
+void rigo_metrics_turn_end(uint32_t turn);
+
+// Output goes out in pieces of a few hundred bytes.
+typedef void (*rigo_metrics_emit_t)(const char *data, int len, void *ctx);
+
+void rigo_metrics_write_json(rigo_metrics_emit_t emit, void *ctx);
+void rigo_metrics_write_prometheus(rigo_metrics_emit_t emit, void *ctx);
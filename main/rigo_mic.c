@@ -0,0 +1,240 @@
+#include "rigo_mic.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "rigo_tasks.h"
+
+static const char *TAG = "rigo_mic";
+
+#define FRAME 256           // samples per codec read (16 ms); divides the ring
+#define MARGIN (FRAME * 4)  // a lapped reader lands this far inside the ring
+#define STAGE 2048          // source chunks (AFE fetch size) are staged here
+
+static esp_codec_dev_handle_t dev;
+static rigo_mic_source_t source;
+static void *source_ctx;
+static int16_t *stage;
+static int stage_fill;
+static int16_t *ring;
+static uint32_t ring_len;   // samples, power of two
+static _Atomic uint32_t wpos;
+static SemaphoreHandle_t ready[RIGO_MIC_MAX_READERS];
+static volatile bool slot_used[RIGO_MIC_MAX_READERS];
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+static rigo_mic_stats_t stats;
+
+static void publish(uint32_t w)
+{
+    atomic_store_explicit(&wpos, w + FRAME, memory_order_release);
+    stats.frames++;
+    for (int i = 0; i < RIGO_MIC_MAX_READERS; i++) {
+        if (slot_used[i]) xSemaphoreGive(ready[i]);
+    }
+}
+
+// Source chunks are copied in a frame at a time, so the span being
+// overwritten is never more than FRAME, as for the codec.
+static void ingest_source(void)
+{
+    int n = source(stage + stage_fill, STAGE - stage_fill, source_ctx);
+    if (n < 0) {
+        stats.codec_errors++;
+        vTaskDelay(pdMS_TO_TICKS(10));
+        return;
+    }
+    stage_fill += n;
+    int off = 0;
+    for (; stage_fill - off >= FRAME; off += FRAME) {
+        uint32_t w = atomic_load_explicit(&wpos, memory_order_relaxed);
+        memcpy(ring + (w & (ring_len - 1)), stage + off, FRAME * sizeof(int16_t));
+        publish(w);
+    }
+    memmove(stage, stage + off, (stage_fill - off) * sizeof(int16_t));
+    stage_fill -= off;
+}
+
+static void ingest_task_fn(void *arg)
+{
+    (void)arg;
+    while (1) {
+        if (source) {
+            ingest_source();
+            continue;
+        }
+        uint32_t w = atomic_load_explicit(&wpos, memory_order_relaxed);
+        // straight into the ring; readers treat the frame in flight as gone
+        if (esp_codec_dev_read(dev, ring + (w & (ring_len - 1)), FRAME * sizeof(int16_t)) != ESP_CODEC_DEV_OK) {
+            stats.codec_errors++;
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+        publish(w);
+    }
+}
+
+static esp_err_t ring_init(void)
+{
+    ring_len = FRAME;
+    while (ring_len < (uint32_t)CONFIG_RIGO_MIC_RING_MS * (RIGO_MIC_RATE / 1000)) ring_len <<= 1;
+    ring = heap_caps_calloc(ring_len, sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ring) return ESP_ERR_NO_MEM;
+    for (int i = 0; i < RIGO_MIC_MAX_READERS; i++) {
+        ready[i] = xSemaphoreCreateBinary();
+        if (!ready[i]) return ESP_ERR_NO_MEM;
+    }
+    stats.ring_ms = ring_len / (RIGO_MIC_RATE / 1000);
+    return ESP_OK;
+}
+
+static esp_err_t start_ingest(void)
+{
+    if (xTaskCreatePinnedToCore(ingest_task_fn, "mic_ingest", 3 * 1024, NULL, CONFIG_RIGO_TASK_INGEST_PRIO, NULL,
+                                RIGO_TASK_CORE(CONFIG_RIGO_TASK_INGEST_CORE)) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Ingest ring %u ms (%u KB PSRAM)%s", (unsigned)stats.ring_ms,
+             (unsigned)(ring_len * sizeof(int16_t) / 1024), source ? ", processed source" : "");
+    return ESP_OK;
+}
+
+esp_err_t rigo_mic_init(esp_codec_dev_handle_t mic)
+{
+    esp_err_t err = ring_init();
+    if (err != ESP_OK) return err;
+    esp_codec_dev_sample_info_t fs = {
+        .sample_rate = RIGO_MIC_RATE,
+        .channel = 1,
+        .bits_per_sample = 16,
+    };
+    if (esp_codec_dev_open(mic, &fs) != ESP_CODEC_DEV_OK) return ESP_FAIL;
+    dev = mic;
+    return start_ingest();
+}
+
+esp_err_t rigo_mic_init_source(rigo_mic_source_t src, void *ctx)
+{
+    esp_err_t err = ring_init();
+    if (err != ESP_OK) return err;
+    stage = heap_caps_malloc(STAGE * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!stage) return ESP_ERR_NO_MEM;
+    source = src;
+    source_ctx = ctx;
+    return start_ingest();
+}
+
+esp_err_t rigo_mic_reader_init(rigo_mic_reader_t *r)
+{
+    if (!ring) return ESP_ERR_INVALID_STATE;
+    memset(r, 0, sizeof(*r));
+    r->slot = -1;
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < RIGO_MIC_MAX_READERS && r->slot < 0; i++) {
+        if (!slot_used[i]) {
+            slot_used[i] = true;
+            r->slot = i;
+        }
+    }
+    portEXIT_CRITICAL(&mux);
+    if (r->slot < 0) return ESP_ERR_NO_MEM;
+    rigo_mic_sync(r);
+    return ESP_OK;
+}
+
+void rigo_mic_reader_deinit(rigo_mic_reader_t *r)
+{
+    if (r->slot < 0) return;
+    portENTER_CRITICAL(&mux);
+    slot_used[r->slot] = false;
+    portEXIT_CRITICAL(&mux);
+    r->slot = -1;
+}
+
+// The producer is writing [w, w + FRAME) right now.
+static bool lapped(uint32_t pos, uint32_t w)
+{
+    return w + FRAME - pos > ring_len;
+}
+
+static void skip_ahead(rigo_mic_reader_t *r, uint32_t w)
+{
+    uint32_t to = w + MARGIN - ring_len;
+    uint32_t lost = to - r->pos;
+    r->pos = to;
+    r->overruns++;
+    portENTER_CRITICAL(&mux);
+    stats.overruns++;
+    stats.lost_samples += lost;
+    portEXIT_CRITICAL(&mux);
+    ESP_LOGW(TAG, "Reader %d overrun, %u ms of audio lost", r->slot, (unsigned)(lost / (RIGO_MIC_RATE / 1000)));
+}
+
+int rigo_mic_read(rigo_mic_reader_t *r, int16_t *dst, int samples, TickType_t wait)
+{
+    int got = 0;
+    while (got < samples) {
+        uint32_t w = atomic_load_explicit(&wpos, memory_order_acquire);
+        if (lapped(r->pos, w)) {
+            skip_ahead(r, w);
+            continue;
+        }
+        uint32_t avail = w - r->pos;
+        if (avail == 0) {
+            if (xSemaphoreTake(ready[r->slot], wait) != pdTRUE) break;
+            continue;
+        }
+        uint32_t n = MIN(avail, (uint32_t)(samples - got));
+        uint32_t off = r->pos & (ring_len - 1);
+        uint32_t first = MIN(n, ring_len - off);
+        memcpy(dst + got, ring + off, first * sizeof(int16_t));
+        memcpy(dst + got + first, ring, (n - first) * sizeof(int16_t));
+        // seqlock-style check: the producer may have come round during the copy
+        atomic_thread_fence(memory_order_acquire);
+        if (lapped(r->pos, atomic_load_explicit(&wpos, memory_order_relaxed))) continue;
+        r->pos += n;
+        got += n;
+    }
+    return got;
+}
+
+int rigo_mic_rewind(rigo_mic_reader_t *r, int ms)
+{
+    uint32_t w = atomic_load_explicit(&wpos, memory_order_acquire);
+    // Positions are compared modulo 2^32, so this keeps working after the
+    // sample counter wraps (~74 h); only the ring length bounds the rewind.
+    // Right after boot that can reach into the never-written, zeroed part of
+    // the ring, which is silence.
+    const uint32_t kept = ring_len - MARGIN;
+    uint32_t behind = w - r->pos;
+    uint32_t n = (uint32_t)ms * (RIGO_MIC_RATE / 1000);
+    if (behind >= kept) return 0;
+    if (n > kept - behind) n = kept - behind;
+    r->pos -= n;
+    return n;
+}
+
+void rigo_mic_seek(rigo_mic_reader_t *r, uint32_t pos)
+{
+    xSemaphoreTake(ready[r->slot], 0);
+    r->pos = pos;
+}
+
+void rigo_mic_sync(rigo_mic_reader_t *r)
+{
+    xSemaphoreTake(ready[r->slot], 0);
+    r->pos = atomic_load_explicit(&wpos, memory_order_acquire);
+}
+
+void rigo_mic_get_stats(rigo_mic_stats_t *out)
+{
+    portENTER_CRITICAL(&mux);
+    *out = stats;
+    portEXIT_CRITICAL(&mux);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_codec_dev.h"
+#include "freertos/FreeRTOS.h"
+
+// Mic ingest. One task drains the codec (16 kHz mono PCM16) into a PSRAM
+// ring all the time; up to RIGO_MIC_MAX_READERS readers follow it, each with
+// its own cursor. The producer never waits for readers: a reader that falls
+// more than the ring behind skips ahead and the lost audio is counted as an
+// overrun.
+
+#define RIGO_MIC_RATE 16000
+#define RIGO_MIC_MAX_READERS 4
+
+typedef struct {
+    uint32_t pos;       // absolute sample index of the next read
+    int slot;           // wake-up slot, signalled after every frame
+    uint32_t overruns;
+} rigo_mic_reader_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t overruns;          // times a reader was lapped, all readers
+    uint32_t lost_samples;
+    uint32_t codec_errors;
+    uint32_t ring_ms;
+} rigo_mic_stats_t;
+
+// Opens the codec and starts the ingest task.
+esp_err_t rigo_mic_init(esp_codec_dev_handle_t mic);
+
+// Processed audio instead of the raw codec (e.g. the AFE): blocks for the
+// next chunk of 16 kHz mono samples, returns how many it wrote (at most
+// `max`) or < 0 on error.
+typedef int (*rigo_mic_source_t)(int16_t *dst, int max, void *ctx);
+
+// Starts the ingest task on a source.
+esp_err_t rigo_mic_init_source(rigo_mic_source_t src, void *ctx);
+
+// A new reader starts at the live edge.
+esp_err_t rigo_mic_reader_init(rigo_mic_reader_t *r);
+void rigo_mic_reader_deinit(rigo_mic_reader_t *r);
+
+// Copies the next `samples` samples, waiting up to `wait` for the producer.
+// Returns the number copied (short only on timeout).
+int rigo_mic_read(rigo_mic_reader_t *r, int16_t *dst, int samples, TickType_t wait);
+
+// Moves the cursor back by up to `ms` of audio still in the ring (pre-roll);
+// returns the number of samples it moved.
+int rigo_mic_rewind(rigo_mic_reader_t *r, int ms);
+
+// Puts the cursor at an absolute position, e.g. where another reader
+// detected the wake word. A position already overwritten counts as an overrun
+// on the next read.
+void rigo_mic_seek(rigo_mic_reader_t *r, uint32_t pos);
+
+// Drops everything not read yet: the cursor jumps to the live edge.
+void rigo_mic_sync(rigo_mic_reader_t *r);
+
+void rigo_mic_get_stats(rigo_mic_stats_t *out);
@@ -0,0 +1,194 @@
+#include "rigo_pipeline.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "rigo_arena.h"
+#include "rigo_metrics.h"
+#include "rigo_mic.h"
+#include "rigo_tasks.h"
+#include "rigo_tts_pipe.h"
+#include "rigo_turn.h"
+
+static const char *TAG = "rigo_pipeline";
+
+#define FRAME_SAMPLES 512
+
+typedef struct {
+    uint32_t turn;
+    uint32_t mic_pos;   // uplink: where the wake word ended
+    char *text;         // assistant: the transcript
+    bool canned;        // assistant: text is a local reply, spoken as is
+    rigo_turn_budget_t budget;  // stage deadlines, set when capture ends
+    rigo_arena_t *arena;    // the turn's allocations; NULL runs on the heap
+} turn_msg_t;
+
+static rigo_pipeline_cb_t cbs;
+static QueueHandle_t uplink_q;
+static QueueHandle_t assistant_q;
+static atomic_bool uplink_busy;
+static rigo_mic_reader_t uplink_rd;
+static _Atomic uint32_t uplink_turn;
+// turns below this id were interrupted (barge-in, stop command); reply_turn
+// is the one the assistant stage is answering (0 when idle)
+static _Atomic uint32_t superseded_below;
+static _Atomic uint32_t reply_turn;
+// last turn decided, as turn << 1 | answered on the device: a voice command
+// and the uplink's transcript race for each turn and only the first counts
+static _Atomic uint32_t decided;
+static _Atomic(char *) local_say;   // the command's canned reply
+
+static void turn_done(const turn_msg_t *msg)
+{
+    rigo_metrics_turn_end(msg->turn);
+    rigo_arena_end(msg->arena);
+    if (cbs.on_turn_done) cbs.on_turn_done(msg->turn);
+}
+
+static void supersede(uint32_t turn)
+{
+    atomic_store(&superseded_below, turn);
+    uint32_t replying = atomic_load(&reply_turn);
+    if (replying && replying < turn) {
+        ESP_LOGI(TAG, "Turn %u interrupts turn %u", (unsigned)turn, (unsigned)replying);
+        rigo_tts_pipe_cancel();
+    }
+}
+
+static bool is_local(uint32_t turn)
+{
+    return atomic_load(&decided) == (turn << 1 | 1);
+}
+
+// false: the turn was already decided the other way
+static bool decide(uint32_t turn, bool local)
+{
+    const uint32_t mine = turn << 1 | local;
+    uint32_t cur = atomic_load(&decided);
+    while ((cur >> 1) < turn) {
+        if (atomic_compare_exchange_weak(&decided, &cur, mine)) return true;
+    }
+    return cur == mine;
+}
+
+static bool uplink_handled(void)
+{
+    return is_local(atomic_load(&uplink_turn));
+}
+
+static void uplink_task_fn(void *arg)
+{
+    int16_t *frame = (int16_t *)arg;
+    const rigo_turn_io_t io = {
+        .mic = &uplink_rd,
+        .frame = frame,
+        .frame_samples = FRAME_SAMPLES,
+        .on_captured = cbs.on_captured,
+        .handled = uplink_handled,
+    };
+
+    while (1) {
+        turn_msg_t msg;
+        xQueueReceive(uplink_q, &msg, portMAX_DELAY);
+        atomic_store(&uplink_turn, msg.turn);
+        rigo_mic_seek(&uplink_rd, msg.mic_pos);
+        rigo_arena_enter(msg.arena);
+        msg.text = rigo_turn_listen(&io, msg.turn, &msg.budget);
+        rigo_arena_enter(NULL);
+        msg.canned = msg.budget.late;
+        if (!decide(msg.turn, false)) {
+            rigo_arena_free(msg.text);  // a transcript that beat the command is not needed
+            msg.text = atomic_exchange(&local_say, NULL);
+            msg.canned = true;
+        }
+        if (msg.text) {
+            // waits while the assistant still has an earlier transcript queued
+            xQueueSend(assistant_q, &msg, portMAX_DELAY);
+        } else {
+            turn_done(&msg);
+        }
+        atomic_store(&uplink_busy, false);
+    }
+}
+
+static void assistant_task_fn(void *arg)
+{
+    (void)arg;
+    while (1) {
+        turn_msg_t msg;
+        xQueueReceive(assistant_q, &msg, portMAX_DELAY);
+        atomic_store(&reply_turn, msg.turn);
+        rigo_arena_enter(msg.arena);
+        rigo_tts_pipe_rearm();
+        // a cancel after the store is seen by the pipe; one before it shows up here
+        if (msg.turn < atomic_load(&superseded_below)) {
+            ESP_LOGI(TAG, "Turn %u superseded, reply dropped", (unsigned)msg.turn);
+            rigo_arena_free(msg.text);
+        } else if (msg.canned) {
+            rigo_tts_pipe_speak(msg.turn, msg.text);
+            rigo_arena_free(msg.text);
+        } else {
+            rigo_turn_reply(msg.turn, msg.text, &msg.budget);
+        }
+        rigo_arena_enter(NULL);
+        atomic_store(&reply_turn, 0);
+        turn_done(&msg);
+    }
+}
+
+esp_err_t rigo_pipeline_init(const rigo_pipeline_cb_t *cb)
+{
+    if (cb) cbs = *cb;
+    esp_err_t err = rigo_arena_init();
+    if (err != ESP_OK) return err;
+    uplink_q = xQueueCreate(1, sizeof(turn_msg_t));
+    assistant_q = xQueueCreate(1, sizeof(turn_msg_t));
+    int16_t *frame = heap_caps_malloc(FRAME_SAMPLES * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!uplink_q || !assistant_q || !frame) return ESP_ERR_NO_MEM;
+    err = rigo_mic_reader_init(&uplink_rd);
+    if (err != ESP_OK) return err;
+
+    if (xTaskCreatePinnedToCore(uplink_task_fn, "uplink", 8 * 1024, frame, CONFIG_RIGO_TASK_UPLINK_PRIO, NULL,
+                                RIGO_TASK_CORE(CONFIG_RIGO_TASK_UPLINK_CORE)) != pdPASS ||
+        xTaskCreatePinnedToCore(assistant_task_fn, "assistant", 8 * 1024, NULL, CONFIG_RIGO_TASK_ASSISTANT_PRIO, NULL,
+                                RIGO_TASK_CORE(CONFIG_RIGO_TASK_ASSISTANT_CORE)) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Stages: uplink core %d prio %d, assistant core %d prio %d", CONFIG_RIGO_TASK_UPLINK_CORE,
+             CONFIG_RIGO_TASK_UPLINK_PRIO, CONFIG_RIGO_TASK_ASSISTANT_CORE, CONFIG_RIGO_TASK_ASSISTANT_PRIO);
+    return ESP_OK;
+}
+
+uint32_t rigo_pipeline_wake(uint32_t mic_pos)
+{
+    if (atomic_exchange(&uplink_busy, true)) return 0;
+    turn_msg_t msg = {.turn = rigo_metrics_turn_begin(), .mic_pos = mic_pos};
+    msg.arena = rigo_arena_begin(msg.turn);
+#if CONFIG_RIGO_BARGE_IN
+    supersede(msg.turn);
+#endif
+    // the uplink is idle, so this never waits
+    xQueueSend(uplink_q, &msg, portMAX_DELAY);
+    return msg.turn;
+}
+
+bool rigo_pipeline_local(uint32_t turn, const char *say, bool stop)
+{
+    // in place before the claim: the uplink takes it as soon as it loses
+    free(atomic_exchange(&local_say, say ? strdup(say) : NULL));
+    if (!decide(turn, true)) {
+        free(atomic_exchange(&local_say, NULL));
+        return false;
+    }
+    if (stop) supersede(turn);
+    return true;
+}
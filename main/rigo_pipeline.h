@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Turn stages as tasks. The wake detector hands a turn to the uplink task
+// (capture + STT), which hands the transcript to the assistant task
+// (assistant, TTS, playback). The next turn can be captured while the
+// previous reply is still being fetched or spoken; replies play in turn
+// order. With CONFIG_RIGO_BARGE_IN a wake instead cuts off the reply in
+// progress and drops any older transcript still waiting for the assistant.
+// Each turn allocates from its own rigo_arena, reset when the turn is done.
+
+typedef struct {
+    void (*on_captured)(void);              // capture window closed
+    void (*on_turn_done)(uint32_t turn);    // reply played, or nothing to answer
+} rigo_pipeline_cb_t;
+
+// Needs rigo_mic_init and rigo_tts_pipe_init first; allocates the arenas.
+esp_err_t rigo_pipeline_init(const rigo_pipeline_cb_t *cb);
+
+// A wake word ended at absolute mic sample `mic_pos`. Returns the new turn's
+// id, or 0 if the previous turn is still in the uplink stage (the wake is
+// dropped).
+uint32_t rigo_pipeline_wake(uint32_t mic_pos);
+
+// Turn `turn` was answered on the device (a voice command): the uplink stops
+// capturing and drops the STT request. `say` (copied, may be NULL) is spoken
+// in turn order instead of a cloud reply; `stop` also ends the reply in
+// progress and any older one still queued. false, and nothing done, when the
+// uplink already handed the turn's transcript on: the caller skips the command.
+bool rigo_pipeline_local(uint32_t turn, const char *say, bool stop);
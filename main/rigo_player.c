@@ -0,0 +1,450 @@
+#include "rigo_player.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "rigo_adpcm.h"
+#include "rigo_env.h"
+#include "rigo_metrics.h"
+#include "rigo_resample.h"
+#include "rigo_tasks.h"
+#include "rigo_wav.h"
+
+static const char *TAG = "rigo_player";
+
+#define FRAME_MS 20
+#define ADPCM_MAX_BLOCK 2048
+#define CONV_FRAMES 128         // input frames per conversion pass
+#define MAX_UPSAMPLE 6          // e.g. 8 kHz TTS into a 48 kHz output
+#define CONV_OUT_FRAMES (CONV_FRAMES * MAX_UPSAMPLE + 2)
+
+static esp_codec_dev_handle_t spk_dev;
+static rigo_player_event_cb_t event_cb;
+static StreamBufferHandle_t ring;
+static SemaphoreHandle_t done_sem;
+static TaskHandle_t play_task;
+
+static rigo_wav_parser_t parser;
+static volatile bool input_done;
+static bool started;
+static bool seg_started;
+static bool bad_segment;
+static int64_t begin_us;
+static uint32_t metrics_turn;
+static bool first_audio;
+static atomic_bool abort_req;
+static int64_t stop_us;
+
+// IMA-ADPCM decode stage, allocated on the first compressed segment
+static uint8_t *adpcm_blk;
+static int16_t *adpcm_pcm;
+static int adpcm_fill;
+static int reply_dec_in;
+static int reply_dec_pcm;
+static int64_t reply_dec_us;
+
+// conversion to the fixed speaker format, allocated on the first segment
+// that needs it; conv_in stages network bytes into whole, aligned frames
+static rigo_resample_t rs;
+static int16_t *conv_in;
+static int conv_in_bytes;
+static int16_t *conv_out;
+static uint32_t reply_conv_frames;
+static int64_t reply_conv_us;
+
+static rigo_player_stats_t stats;
+
+// level | peak << 8 | active << 16; one 32-bit word so the UI reads it without a lock
+static _Atomic uint32_t env_word;
+
+static void publish_env(const uint8_t *frame, int len)
+{
+    rigo_env_t env = {0};
+    if (frame) {
+        int64_t t0 = esp_timer_get_time();
+        rigo_env_measure((const int16_t *)frame, len / 2, &env);
+        uint32_t dt = esp_timer_get_time() - t0;
+        stats.env_us += dt;
+        stats.env_frames++;
+        if (dt > stats.env_max_us) stats.env_max_us = dt;
+    }
+    uint32_t w = rigo_env_level(env.rms) | (rigo_env_level(env.peak) << 8) | (1u << 16);
+    atomic_store_explicit(&env_word, w, memory_order_release);
+}
+
+static void play_task_fn(void *arg)
+{
+    (void)arg;
+    const int align = CONFIG_RIGO_PLAYER_CHANNELS * sizeof(int16_t);
+    const int bytes_per_ms = CONFIG_RIGO_PLAYER_RATE / 1000 * align;
+    const int frame_len = bytes_per_ms * FRAME_MS;
+    const size_t prebuffer = bytes_per_ms * CONFIG_RIGO_PLAYER_PREBUFFER_MS;
+    uint8_t *frame = heap_caps_malloc(frame_len, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t *silence = heap_caps_calloc(1, frame_len, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (!input_done && !atomic_load(&abort_req) && xStreamBufferBytesAvailable(ring) < prebuffer) {
+            vTaskDelay(1);
+        }
+
+        if (first_audio) {
+            first_audio = false;
+            rigo_metrics_mark(metrics_turn, RIGO_MARK_PLAY_START);
+            stats.last_first_audio_ms = (esp_timer_get_time() - begin_us) / 1000;
+            ESP_LOGI(TAG, "First audio %u ms after reply start", (unsigned)stats.last_first_audio_ms);
+        }
+        if (event_cb) event_cb(true);
+        int have = 0;
+        bool aborted = false;
+        while (1) {
+            if (atomic_load(&abort_req)) {
+                aborted = true;
+                break;
+            }
+            size_t rd = xStreamBufferReceive(ring, frame + have, frame_len - have, pdMS_TO_TICKS(FRAME_MS));
+            have += rd;
+            if (have == frame_len) {
+                esp_codec_dev_write(spk_dev, frame, have);
+                publish_env(frame, have);
+                stats.bytes_played += have;
+                have = 0;
+                continue;
+            }
+            if (rd > 0) continue;
+
+            if (input_done && xStreamBufferBytesAvailable(ring) == 0) break;
+
+            // download is behind: keep the I2S clock fed with silence instead of
+            // letting DMA replay stale buffers, and hold the partial frame for later
+            stats.underruns++;
+            esp_codec_dev_write(spk_dev, silence, frame_len);
+            publish_env(NULL, 0);
+        }
+        have -= have % align;
+        if (aborted) {
+            // whatever the ring still holds is dropped with it
+            have = 0;
+            uint32_t ms = (esp_timer_get_time() - stop_us) / 1000;
+            stats.stops++;
+            if (ms > stats.stop_max_ms) stats.stop_max_ms = ms;
+            ESP_LOGI(TAG, "Stopped %u ms after request", (unsigned)ms);
+        }
+        if (have > 0) {
+            esp_codec_dev_write(spk_dev, frame, have);
+            stats.bytes_played += have;
+        }
+        // end on a silent frame so the idle DMA has nothing stale to repeat
+        esp_codec_dev_write(spk_dev, silence, frame_len);
+        atomic_store_explicit(&env_word, 0, memory_order_release);
+        if (event_cb) event_cb(false);
+        if (stats.env_frames > 0) {
+            ESP_LOGI(TAG, "Envelope %u us/frame avg, %u max", (unsigned)(stats.env_us / stats.env_frames),
+                     (unsigned)stats.env_max_us);
+        }
+        xSemaphoreGive(done_sem);
+    }
+}
+
+esp_err_t rigo_player_init(esp_codec_dev_handle_t spk, rigo_player_event_cb_t cb)
+{
+    spk_dev = spk;
+    event_cb = cb;
+    rigo_resample_init(&rs, CONFIG_RIGO_PLAYER_RATE, CONFIG_RIGO_PLAYER_CHANNELS);
+
+    // opened once at the native format and never closed: replies start without
+    // a codec/I2S reconfiguration, and the output idles on silence in between
+    esp_codec_dev_sample_info_t fs = {
+        .sample_rate = CONFIG_RIGO_PLAYER_RATE,
+        .channel = CONFIG_RIGO_PLAYER_CHANNELS,
+        .bits_per_sample = 16,
+    };
+    if (esp_codec_dev_open(spk_dev, &fs) != ESP_CODEC_DEV_OK) {
+        ESP_LOGE(TAG, "Speaker open failed (%d Hz, %d ch)", CONFIG_RIGO_PLAYER_RATE, CONFIG_RIGO_PLAYER_CHANNELS);
+        return ESP_FAIL;
+    }
+    ring = xStreamBufferCreateWithCaps(CONFIG_RIGO_PLAYER_RING_KB * 1024, 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    done_sem = xSemaphoreCreateBinary();
+    if (!ring || !done_sem) return ESP_ERR_NO_MEM;
+
+    if (xTaskCreatePinnedToCore(play_task_fn, "player", 4 * 1024, NULL, CONFIG_RIGO_TASK_PLAYER_PRIO, &play_task,
+                                RIGO_TASK_CORE(CONFIG_RIGO_TASK_PLAYER_CORE)) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void rigo_player_begin(uint32_t turn)
+{
+    metrics_turn = turn;
+    begin_us = esp_timer_get_time();
+    first_audio = true;
+    adpcm_fill = 0;
+    reply_dec_in = 0;
+    reply_dec_pcm = 0;
+    reply_dec_us = 0;
+    reply_conv_frames = 0;
+    reply_conv_us = 0;
+    conv_in_bytes = 0;
+    rigo_wav_parser_init(&parser);
+    xStreamBufferReset(ring);
+    input_done = false;
+    started = false;
+    seg_started = false;
+    bad_segment = false;
+    atomic_store(&abort_req, false);
+}
+
+void rigo_player_stop(void)
+{
+    if (atomic_load(&abort_req)) return;
+    stop_us = esp_timer_get_time();
+    atomic_store(&abort_req, true);
+}
+
+static void adpcm_flush(void);
+static void conv_flush(void);
+
+void rigo_player_segment(void)
+{
+    adpcm_flush();
+    conv_flush();
+    rigo_wav_parser_init(&parser);
+    seg_started = false;
+    bad_segment = false;
+}
+
+static bool is_adpcm(void)
+{
+    return parser.format == RIGO_WAV_FMT_IMA_ADPCM;
+}
+
+static void start_playback(void)
+{
+    started = true;
+    stats.utterances++;
+    xTaskNotifyGive(play_task);
+}
+
+static void wait_drained(void)
+{
+    input_done = true;
+    if (started) {
+        xSemaphoreTake(done_sem, portMAX_DELAY);
+    }
+    started = false;
+}
+
+static void ring_send(const uint8_t *pcm, int pcm_len)
+{
+    // bounded waits so a stop reaches a feeder blocked on a full ring
+    while (pcm_len > 0 && !atomic_load(&abort_req)) {
+        size_t sent = xStreamBufferSend(ring, pcm, pcm_len, pdMS_TO_TICKS(FRAME_MS));
+        pcm += sent;
+        pcm_len -= sent;
+    }
+    size_t used = CONFIG_RIGO_PLAYER_RING_KB * 1024 - xStreamBufferSpacesAvailable(ring);
+    if (used > stats.ring_high_water) stats.ring_high_water = used;
+}
+
+// Points the converter at the new segment's format; every segment of a reply
+// plays through the same open codec whatever rate or channel count it declares.
+static bool conv_supported(void)
+{
+    if (parser.sample_rate * MAX_UPSAMPLE < CONFIG_RIGO_PLAYER_RATE ||
+        rigo_resample_config(&rs, parser.sample_rate, parser.channels) != ESP_OK) {
+        return false;
+    }
+    conv_in_bytes = 0;
+    if (rigo_resample_is_identity(&rs) || conv_in) return true;
+    conv_in = heap_caps_malloc(CONV_FRAMES * 2 * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    conv_out = heap_caps_malloc(CONV_OUT_FRAMES * CONFIG_RIGO_PLAYER_CHANNELS * sizeof(int16_t),
+                                MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return conv_in && conv_out;
+}
+
+static void conv_send(const int16_t *pcm, int frames)
+{
+    while (frames > 0 && !atomic_load(&abort_req)) {
+        const int n = MIN(frames, CONV_FRAMES);
+        int64_t t0 = esp_timer_get_time();
+        int out = rigo_resample_process(&rs, pcm, n, conv_out);
+        int64_t dt = esp_timer_get_time() - t0;
+        stats.resample_us += dt;
+        stats.resampled_frames += n;
+        reply_conv_us += dt;
+        reply_conv_frames += n;
+        ring_send((const uint8_t *)conv_out, out * CONFIG_RIGO_PLAYER_CHANNELS * sizeof(int16_t));
+        pcm += n * rs.in_ch;
+        frames -= n;
+    }
+}
+
+// PCM16 in whatever slices the network delivers; a frame split across reads
+// waits in conv_in for its other half
+static void pcm_send(const uint8_t *data, int len)
+{
+    if (rigo_resample_is_identity(&rs)) {
+        ring_send(data, len);
+        return;
+    }
+    const int align = rs.in_ch * sizeof(int16_t);
+    while (len > 0 && !atomic_load(&abort_req)) {
+        int n = MIN(len, CONV_FRAMES * align - conv_in_bytes);
+        memcpy((uint8_t *)conv_in + conv_in_bytes, data, n);
+        conv_in_bytes += n;
+        data += n;
+        len -= n;
+        const int frames = conv_in_bytes / align;
+        conv_send(conv_in, frames);
+        conv_in_bytes -= frames * align;
+        if (conv_in_bytes > 0) memmove(conv_in, (uint8_t *)conv_in + frames * align, conv_in_bytes);
+    }
+}
+
+// the filter holds a few ms of the segment's tail; a dangling half frame is dropped
+static void conv_flush(void)
+{
+    if (seg_started && !bad_segment && !atomic_load(&abort_req) && !rigo_resample_is_identity(&rs)) {
+        int out = rigo_resample_flush(&rs, conv_out);
+        ring_send((const uint8_t *)conv_out, out * CONFIG_RIGO_PLAYER_CHANNELS * sizeof(int16_t));
+    }
+    conv_in_bytes = 0;
+}
+
+static bool adpcm_supported(void)
+{
+    if (parser.bits != 4 || parser.channels != 1 || parser.block_align <= 4 || parser.block_align > ADPCM_MAX_BLOCK) {
+        return false;
+    }
+    if (!adpcm_blk) {
+        adpcm_blk = heap_caps_malloc(ADPCM_MAX_BLOCK, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        adpcm_pcm = heap_caps_malloc(((ADPCM_MAX_BLOCK - 4) * 2 + 1) * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    return adpcm_blk && adpcm_pcm;
+}
+
+static void adpcm_decode(int block_len)
+{
+    int64_t t0 = esp_timer_get_time();
+    int n = rigo_adpcm_decode_block(adpcm_blk, block_len, adpcm_pcm);
+    int64_t dt = esp_timer_get_time() - t0;
+    stats.decode_us += dt;
+    stats.decoded_bytes += block_len;
+    reply_dec_us += dt;
+    reply_dec_in += block_len;
+    reply_dec_pcm += n * sizeof(int16_t);
+    adpcm_fill = 0;
+    if (rigo_resample_is_identity(&rs)) {
+        ring_send((const uint8_t *)adpcm_pcm, n * sizeof(int16_t));
+    } else {
+        conv_send(adpcm_pcm, n);
+    }
+}
+
+// blocks arrive split across network reads; decode each once it is whole
+static void adpcm_feed(const uint8_t *data, int len)
+{
+    while (len > 0) {
+        int n = parser.block_align - adpcm_fill;
+        if (n > len) n = len;
+        memcpy(adpcm_blk + adpcm_fill, data, n);
+        adpcm_fill += n;
+        data += n;
+        len -= n;
+        if (adpcm_fill == parser.block_align) adpcm_decode(adpcm_fill);
+    }
+}
+
+// a stream may end on a short final block
+static void adpcm_flush(void)
+{
+    if (adpcm_fill > 4 && !bad_segment && !atomic_load(&abort_req)) adpcm_decode(adpcm_fill);
+    adpcm_fill = 0;
+}
+
+bool rigo_player_feed(const uint8_t *data, int len)
+{
+    while (len > 0 && !bad_segment && !atomic_load(&abort_req)) {
+        const uint8_t *pcm;
+        int pcm_len;
+        int n = rigo_wav_parse(&parser, data, len, &pcm, &pcm_len);
+        if (n < 0) {
+            ESP_LOGE(TAG, "Reply is not a RIFF/WAVE stream");
+            bad_segment = true;
+            break;
+        }
+        data += n;
+        len -= n;
+        if (pcm_len == 0) continue;
+
+        if (!seg_started) {
+            seg_started = true;
+            if (!(parser.format == RIGO_WAV_FMT_PCM && parser.bits == 16) && !(is_adpcm() && adpcm_supported())) {
+                ESP_LOGE(TAG, "Unsupported WAV format %u/%u-bit", parser.format, parser.bits);
+                bad_segment = true;
+                break;
+            }
+            if (!conv_supported()) {
+                ESP_LOGE(TAG, "Cannot convert %u Hz/%u ch to %d Hz/%d ch", (unsigned)parser.sample_rate,
+                         parser.channels, CONFIG_RIGO_PLAYER_RATE, CONFIG_RIGO_PLAYER_CHANNELS);
+                bad_segment = true;
+                break;
+            }
+            if (!started) start_playback();
+        }
+
+        if (is_adpcm()) {
+            adpcm_feed(pcm, pcm_len);
+        } else {
+            pcm_send(pcm, pcm_len);
+        }
+    }
+    return !bad_segment && !atomic_load(&abort_req);
+}
+
+void rigo_player_end(void)
+{
+    adpcm_flush();
+    conv_flush();
+    wait_drained();
+    if (!first_audio) rigo_metrics_mark(metrics_turn, RIGO_MARK_PLAY_END);
+    if (reply_conv_frames > 0) {
+        const int64_t audio_us = (int64_t)reply_conv_frames * 1000000 / rs.in_rate;
+        ESP_LOGI(TAG, "Converted %u Hz/%d ch -> %d Hz/%d ch: %u frames in %d us (%d.%02d%% of real time)",
+                 (unsigned)rs.in_rate, rs.in_ch, CONFIG_RIGO_PLAYER_RATE, CONFIG_RIGO_PLAYER_CHANNELS,
+                 (unsigned)reply_conv_frames, (int)reply_conv_us, (int)(reply_conv_us * 100 / audio_us),
+                 (int)(reply_conv_us * 10000 / audio_us % 100));
+    }
+    if (reply_dec_pcm > 0) {
+        // PCM16 mono: 2 bytes per sample
+        const int64_t audio_us = (int64_t)reply_dec_pcm * 500000 / (parser.sample_rate ? parser.sample_rate : 16000);
+        ESP_LOGI(TAG, "ADPCM %d -> %d bytes, decode %d us (%d.%02d%% of real time)",
+                 reply_dec_in, reply_dec_pcm, (int)reply_dec_us, (int)(reply_dec_us * 100 / audio_us),
+                 (int)(reply_dec_us * 10000 / audio_us % 100));
+    }
+}
+
+bool rigo_player_envelope(uint8_t *level, uint8_t *peak)
+{
+    uint32_t w = atomic_load_explicit(&env_word, memory_order_acquire);
+    *level = w & 0xff;
+    *peak = (w >> 8) & 0xff;
+    return w & (1u << 16);
+}
+
+void rigo_player_get_stats(rigo_player_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_codec_dev.h"
+
+// Called from the playback task when sound starts (true) and after the last frame (false).
+typedef void (*rigo_player_event_cb_t)(bool playing);
+
+esp_err_t rigo_player_init(esp_codec_dev_handle_t spk, rigo_player_event_cb_t cb);
+
+// Start a new utterance. WAV bytes (PCM16, or mono IMA-ADPCM which is decoded
+// here block by block) are then pushed with rigo_player_feed as
+// they arrive; the RIFF header is parsed incrementally and playback starts
+// once the prebuffer is filled. feed blocks while the ring is full. The
+// playback marks go to rigo_metrics `turn` (0: not a turn).
+void rigo_player_begin(uint32_t turn);
+bool rigo_player_feed(const uint8_t *data, int len);
+
+// Next WAV stream of the same reply: new RIFF header, no gap. Segments may
+// differ in rate and channel count; all are converted to the speaker's
+// fixed CONFIG_RIGO_PLAYER_RATE / CONFIG_RIGO_PLAYER_CHANNELS format.
+void rigo_player_segment(void);
+
+// Mark end of input and wait until everything queued has been played.
+void rigo_player_end(void);
+
+// Barge-in: drop what is queued and go quiet after the frame in flight.
+// feed returns false from then on; the caller still ends the utterance.
+// Any task may call this; rigo_player_begin clears it.
+void rigo_player_stop(void);
+
+typedef struct {
+    uint32_t utterances;
+    uint32_t underruns;
+    uint32_t bytes_played;
+    uint32_t ring_high_water;
+    uint32_t decoded_bytes;         // compressed (IMA-ADPCM) input
+    uint64_t decode_us;
+    uint32_t last_first_audio_ms;   // rigo_player_begin to first speaker write
+    uint64_t env_us;                // envelope kernel time, all frames
+    uint32_t env_frames;
+    uint32_t env_max_us;
+    uint32_t stops;                 // utterances cut short by rigo_player_stop
+    uint32_t stop_max_ms;           // rigo_player_stop to speaker quiet, worst case
+    uint64_t resample_us;           // rate/channel conversion to the speaker format
+    uint32_t resampled_frames;      // input frames converted
+} rigo_player_stats_t;
+
+void rigo_player_get_stats(rigo_player_stats_t *out);
+
+// Envelope of the frame last handed to the speaker (0..255, sqrt scale),
+// updated every 20 ms frame without locking. false when nothing is playing.
+bool rigo_player_envelope(uint8_t *level, uint8_t *peak);
@@ -0,0 +1,151 @@
+#include "rigo_power.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+
+static const char *TAG = "rigo_power";
+
+#if CONFIG_RIGO_IDLE_POWER
+static SemaphoreHandle_t lock;
+static esp_timer_handle_t idle_timer;
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t cpu_lock;
+#endif
+static bool wifi_ps;
+static int turns;
+static int64_t mode_since_us;
+#endif
+static volatile bool idle;
+static rigo_power_stats_t stats;
+
+#if CONFIG_RIGO_IDLE_POWER
+// Caller holds the lock.
+static void set_idle(bool on)
+{
+    const int64_t now = esp_timer_get_time();
+    if (idle) stats.idle_ms += (now - mode_since_us) / 1000;
+    else stats.active_ms += (now - mode_since_us) / 1000;
+    mode_since_us = now;
+#if CONFIG_PM_ENABLE
+    if (stats.dfs) {
+        if (on) esp_pm_lock_release(cpu_lock);
+        else esp_pm_lock_acquire(cpu_lock);
+    }
+#endif
+    // during a turn every cloud round trip would wait for the next beacon
+    if (wifi_ps && esp_wifi_set_ps(on ? WIFI_PS_MAX_MODEM : WIFI_PS_NONE) != ESP_OK) {
+        ESP_LOGW(TAG, "Wi-Fi power save not available, keeping the radio on");
+        wifi_ps = false;
+    }
+    idle = on;
+}
+
+static void idle_timer_cb(void *arg)
+{
+    (void)arg;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (turns == 0 && !idle) {
+        set_idle(true);
+        stats.idle_entries++;
+        ESP_LOGI(TAG, "Idle: CPU %d MHz%s", stats.dfs ? CONFIG_RIGO_IDLE_CPU_MHZ : CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+                 wifi_ps ? ", Wi-Fi modem sleep" : "");
+    }
+    xSemaphoreGive(lock);
+}
+#endif
+
+esp_err_t rigo_power_init(bool sta)
+{
+#if CONFIG_RIGO_IDLE_POWER
+    lock = xSemaphoreCreateMutex();
+    if (!lock) return ESP_ERR_NO_MEM;
+    const esp_timer_create_args_t targs = {.callback = idle_timer_cb, .name = "rigo_idle"};
+    esp_err_t err = esp_timer_create(&targs, &idle_timer);
+    if (err != ESP_OK) return err;
+
+#if CONFIG_PM_ENABLE
+    const esp_pm_config_t pm = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_RIGO_IDLE_CPU_MHZ,
+        .light_sleep_enable = false,
+    };
+    err = esp_pm_configure(&pm);
+    if (err == ESP_OK) err = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "rigo_turn", &cpu_lock);
+    if (err == ESP_OK) err = esp_pm_lock_acquire(cpu_lock);
+    // idle still brings modem sleep and the slower face without it
+    if (err == ESP_OK) stats.dfs = true;
+    else ESP_LOGE(TAG, "DFS setup failed, the CPU stays at full clock when idle: %s", esp_err_to_name(err));
+#else
+    ESP_LOGW(TAG, "CONFIG_PM_ENABLE is off: the CPU stays at full clock when idle");
+#endif
+    wifi_ps = sta && CONFIG_RIGO_IDLE_WIFI_PS;
+    if (wifi_ps) esp_wifi_set_ps(WIFI_PS_NONE);
+    stats.enabled = true;
+    mode_since_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Idle mode after %d ms: %d -> %d MHz%s", CONFIG_RIGO_IDLE_AFTER_MS,
+             CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, stats.dfs ? CONFIG_RIGO_IDLE_CPU_MHZ : CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+             wifi_ps ? ", Wi-Fi modem sleep" : "");
+    // no turn yet: the boot counts as the last one
+    return esp_timer_start_once(idle_timer, (uint64_t)CONFIG_RIGO_IDLE_AFTER_MS * 1000);
+#else
+    (void)sta;
+    return ESP_OK;
+#endif
+}
+
+void rigo_power_wake(void)
+{
+#if CONFIG_RIGO_IDLE_POWER
+    const int64_t t0 = esp_timer_get_time();
+    xSemaphoreTake(lock, portMAX_DELAY);
+    turns++;
+    esp_timer_stop(idle_timer);
+    if (idle) {
+        set_idle(false);
+        const uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+        stats.ramp_us_last = us;
+        if (us > stats.ramp_us_max) stats.ramp_us_max = us;
+    }
+    xSemaphoreGive(lock);
+#endif
+}
+
+void rigo_power_turn_done(void)
+{
+#if CONFIG_RIGO_IDLE_POWER
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (turns > 0 && --turns == 0) {
+        esp_timer_stop(idle_timer);
+        esp_timer_start_once(idle_timer, (uint64_t)CONFIG_RIGO_IDLE_AFTER_MS * 1000);
+    }
+    xSemaphoreGive(lock);
+#endif
+}
+
+bool rigo_power_idle(void)
+{
+    return idle;
+}
+
+void rigo_power_get_stats(rigo_power_stats_t *out)
+{
+#if CONFIG_RIGO_IDLE_POWER
+    xSemaphoreTake(lock, portMAX_DELAY);
+    *out = stats;
+    const uint64_t ms = (esp_timer_get_time() - mode_since_us) / 1000;
+    if (idle) out->idle_ms += ms;
+    else out->active_ms += ms;
+    xSemaphoreGive(lock);
+#else
+    *out = stats;
+    out->active_ms = esp_timer_get_time() / 1000;
+#endif
+    out->idle = idle;
+    out->cpu_mhz = esp_rom_get_cpu_ticks_per_us();
+}
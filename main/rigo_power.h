@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Idle power mode between turns (CONFIG_RIGO_IDLE_POWER). A PM lock holds
+// the CPU at full clock and Wi-Fi power save is off while any turn runs.
+// CONFIG_RIGO_IDLE_AFTER_MS after the last one is done the lock is released,
+// so DFS drops the clock to CONFIG_RIGO_IDLE_CPU_MHZ, and the station goes
+// to max modem sleep. No light sleep: the mic and WakeNet run throughout.
+
+// After esp_wifi_start; sta: a station is configured, so modem sleep applies.
+esp_err_t rigo_power_init(bool sta);
+
+// Wake word detected: back to full clock before the turn is handed on. Every
+// call is matched by one rigo_power_turn_done (also for a wake that is ignored).
+void rigo_power_wake(void);
+void rigo_power_turn_done(void);
+
+bool rigo_power_idle(void);
+
+typedef struct {
+    bool enabled;
+    bool dfs;                   // the clock scales down when idle (PM_ENABLE and esp_pm_configure ok)
+    bool idle;
+    uint32_t idle_entries;
+    uint64_t idle_ms;           // time in each mode since boot
+    uint64_t active_ms;
+    uint32_t ramp_us_last;      // rigo_power_wake from idle to full clock and no power save
+    uint32_t ramp_us_max;
+    uint32_t cpu_mhz;           // clock of the calling core right now
+} rigo_power_stats_t;
+
+void rigo_power_get_stats(rigo_power_stats_t *out);
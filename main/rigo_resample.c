@@ -0,0 +1,227 @@
+#include "rigo_resample.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "esp_heap_caps.h"
+
+#define MAX_L 1024
+// passband edge as a fraction of the lower Nyquist rate, and the Kaiser
+// window shape (about 70 dB stopband at RIGO_RS_TAPS taps per phase)
+#define ROLLOFF 0.9f
+#define BETA 7.0f
+
+static int gcd(int a, int b)
+{
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static float bessel_i0(float x)
+{
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 32 && term > 1e-8f * sum; k++) {
+        float h = x / (2.0f * k);
+        term *= h * h;
+        sum += term;
+    }
+    return sum;
+}
+
+// Prototype lowpass at L x the input rate, split into L phases of
+// RIGO_RS_TAPS taps. Each phase is normalized to unity DC gain, which keeps
+// its absolute sum well under 2.0 and so the Q15 dot product inside int32.
+static bool design(rigo_resample_t *rs)
+{
+    const int L = rs->L, N = RIGO_RS_TAPS * L;
+    const size_t bytes = (size_t)N * sizeof(int16_t);
+    int16_t *coef = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!coef) coef = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!coef) return false;
+
+    const float fc = 0.5f * ROLLOFF / MAX(L, rs->M);    // cycles per upsampled sample
+    const float i0_beta = bessel_i0(BETA);
+    float taps[RIGO_RS_TAPS];
+    for (int p = 0; p < L; p++) {
+        float sum = 0.0f;
+        for (int k = 0; k < RIGO_RS_TAPS; k++) {
+            const int j = p + L * k;
+            const float x = j - (N - 1) * 0.5f;
+            const float r = 2.0f * j / (N - 1) - 1.0f;
+            const float w = bessel_i0(BETA * sqrtf(fmaxf(0.0f, 1.0f - r * r))) / i0_beta;
+            const float a = (float)M_PI * 2.0f * fc * x;
+            taps[k] = (a == 0.0f ? 1.0f : sinf(a) / a) * w;
+            sum += taps[k];
+        }
+        // time-reversed, so the window is read oldest sample first
+        for (int k = 0; k < RIGO_RS_TAPS; k++) {
+            long q = lroundf(taps[k] / sum * 32768.0f);
+            coef[p * RIGO_RS_TAPS + RIGO_RS_TAPS - 1 - k] = q > 32767 ? 32767 : q < -32768 ? -32768 : q;
+        }
+    }
+    heap_caps_free(rs->coef);
+    rs->coef = coef;
+    rs->coef_L = L;
+    rs->coef_M = rs->M;
+    return true;
+}
+
+void rigo_resample_init(rigo_resample_t *rs, int out_rate, int out_ch)
+{
+    memset(rs, 0, sizeof(*rs));
+    rs->out_rate = out_rate;
+    rs->out_ch = out_ch;
+    rs->in_rate = out_rate;
+    rs->in_ch = out_ch;
+    rs->L = rs->M = 1;
+    rs->bypass = true;
+}
+
+esp_err_t rigo_resample_config(rigo_resample_t *rs, int in_rate, int in_ch)
+{
+    if (in_rate <= 0 || in_ch < 1 || in_ch > 2) return ESP_ERR_NOT_SUPPORTED;
+    const int g = gcd(in_rate, rs->out_rate);
+    const int L = rs->out_rate / g, M = in_rate / g;
+    if (L > MAX_L) return ESP_ERR_NOT_SUPPORTED;
+
+    rs->in_rate = in_rate;
+    rs->in_ch = in_ch;
+    rs->L = L;
+    rs->M = M;
+    rs->bypass = L == 1 && M == 1;
+    rs->work_ch = in_ch == 2 && rs->out_ch == 2 ? 2 : 1;
+    rs->phase = 0;
+    rs->pos = RIGO_RS_TAPS - 1;
+    rs->fill = RIGO_RS_TAPS - 1;
+    memset(rs->buf, 0, sizeof(rs->buf));
+    if (!rs->bypass && (rs->coef_L != L || rs->coef_M != M) && !design(rs)) return ESP_ERR_NO_MEM;
+    return ESP_OK;
+}
+
+bool rigo_resample_is_identity(const rigo_resample_t *rs)
+{
+    return rs->bypass && rs->in_ch == rs->out_ch;
+}
+
+int rigo_resample_max_out(const rigo_resample_t *rs, int in_frames)
+{
+    return (int)((int64_t)in_frames * rs->L / rs->M) + 2;
+}
+
+// Q15 dot product over one window. Four partial sums keep the Xtensa MAC16
+// pipeline busy and let host compilers vectorize; with unity-gain phases the
+// total stays within int32 for any input.
+static inline int16_t dot_q15(const int16_t *x, const int16_t *c)
+{
+    int32_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+    for (int k = 0; k < RIGO_RS_TAPS; k += 4) {
+        a0 += x[k] * c[k];
+        a1 += x[k + 1] * c[k + 1];
+        a2 += x[k + 2] * c[k + 2];
+        a3 += x[k + 3] * c[k + 3];
+    }
+    int32_t acc = (a0 + a1 + a2 + a3 + (1 << 14)) >> 15;
+    return acc > 32767 ? 32767 : acc < -32768 ? -32768 : acc;
+}
+
+static int convert_channels(const rigo_resample_t *rs, const int16_t *in, int n, int16_t *out)
+{
+    if (rs->in_ch == rs->out_ch) {
+        memmove(out, in, (size_t)n * rs->in_ch * sizeof(int16_t));
+    } else if (rs->in_ch == 2) {
+        for (int i = 0; i < n; i++) out[i] = (in[2 * i] + in[2 * i + 1]) >> 1;
+    } else {
+        for (int i = n - 1; i >= 0; i--) out[2 * i] = out[2 * i + 1] = in[i];
+    }
+    return n;
+}
+
+static void stage(rigo_resample_t *rs, const int16_t *in, int n)
+{
+    int16_t *d0 = rs->buf[0] + rs->fill, *d1 = rs->buf[1] + rs->fill;
+    if (rs->in_ch == 1) {
+        memcpy(d0, in, n * sizeof(int16_t));
+    } else if (rs->work_ch == 1) {
+        for (int i = 0; i < n; i++) d0[i] = (in[2 * i] + in[2 * i + 1]) >> 1;
+    } else {
+        for (int i = 0; i < n; i++) {
+            d0[i] = in[2 * i];
+            d1[i] = in[2 * i + 1];
+        }
+    }
+    rs->fill += n;
+}
+
+static int filter(rigo_resample_t *rs, int16_t *out)
+{
+    const int step = rs->M / rs->L, frac = rs->M % rs->L;
+    int n = 0;
+    while (rs->pos < rs->fill) {
+        const int16_t *c = rs->coef + rs->phase * RIGO_RS_TAPS;
+        const int first = rs->pos - (RIGO_RS_TAPS - 1);
+        const int16_t y = dot_q15(rs->buf[0] + first, c);
+        if (rs->work_ch == 2) {
+            *out++ = y;
+            *out++ = dot_q15(rs->buf[1] + first, c);
+        } else if (rs->out_ch == 2) {
+            *out++ = y;
+            *out++ = y;
+        } else {
+            *out++ = y;
+        }
+        n++;
+        rs->pos += step;
+        rs->phase += frac;
+        if (rs->phase >= rs->L) {
+            rs->phase -= rs->L;
+            rs->pos++;
+        }
+    }
+    // the newest RIGO_RS_TAPS - 1 samples stay as history
+    const int drop = rs->fill - (RIGO_RS_TAPS - 1);
+    for (int ch = 0; ch < rs->work_ch; ch++) {
+        memmove(rs->buf[ch], rs->buf[ch] + drop, (RIGO_RS_TAPS - 1) * sizeof(int16_t));
+    }
+    rs->pos -= drop;
+    rs->fill = RIGO_RS_TAPS - 1;
+    return n;
+}
+
+int rigo_resample_process(rigo_resample_t *rs, const int16_t *in, int in_frames, int16_t *out)
+{
+    if (rs->bypass) return convert_channels(rs, in, in_frames, out);
+
+    int produced = 0;
+    while (in_frames > 0) {
+        const int n = MIN(in_frames, RIGO_RS_BLOCK);
+        stage(rs, in, n);
+        in += n * rs->in_ch;
+        in_frames -= n;
+        produced += filter(rs, out + produced * rs->out_ch);
+    }
+    return produced;
+}
+
+int rigo_resample_flush(rigo_resample_t *rs, int16_t *out)
+{
+    if (rs->bypass) return 0;
+    // the prototype's group delay is RIGO_RS_TAPS / 2 input samples
+    for (int ch = 0; ch < rs->work_ch; ch++) {
+        memset(rs->buf[ch] + rs->fill, 0, RIGO_RS_TAPS / 2 * sizeof(int16_t));
+    }
+    rs->fill += RIGO_RS_TAPS / 2;
+    return filter(rs, out);
+}
+
+void rigo_resample_free(rigo_resample_t *rs)
+{
+    heap_caps_free(rs->coef);
+    rs->coef = NULL;
+    rs->coef_L = rs->coef_M = 0;
+}
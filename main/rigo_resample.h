@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Streaming PCM16 rate and channel conversion for the speaker path. A
+// rational L/M polyphase FIR (Kaiser-windowed sinc, RIGO_RS_TAPS taps per
+// phase, Q15) runs on each working channel; stereo is averaged down to mono
+// before filtering and mono is duplicated after it. Phases are exact, so
+// there is no drift or phase quantization noise for any rate pair. Equal
+// rates skip the filter and only convert channels.
+
+#define RIGO_RS_TAPS 32         // per phase; a multiple of 8 keeps the dot product in whole vectors
+#define RIGO_RS_BLOCK 256       // input frames staged per pass
+
+typedef struct {
+    int in_rate, in_ch;
+    int out_rate, out_ch;
+    int work_ch;                // channels filtered: 1, or 2 for stereo to stereo
+    int L, M;                   // out_rate / in_rate in lowest terms
+    int phase;                  // 0..L-1
+    int pos;                    // newest input sample of the next output's window
+    int fill;                   // samples in buf, history included
+    bool bypass;                // rates match: channel conversion only
+    int16_t *coef;              // L phases x RIGO_RS_TAPS, time-reversed
+    int coef_L, coef_M;         // rate pair the table was built for; kept across bypassed streams
+    int16_t buf[2][RIGO_RS_TAPS - 1 + RIGO_RS_BLOCK];
+} rigo_resample_t;
+
+void rigo_resample_init(rigo_resample_t *rs, int out_rate, int out_ch);
+
+// Input format of the stream that follows. The filter table is rebuilt only
+// when the rate pair changes; history is cleared either way. Supports 1 or 2
+// input channels and rates whose reduced L is at most 1024.
+esp_err_t rigo_resample_config(rigo_resample_t *rs, int in_rate, int in_ch);
+
+// Same rate and channel count: the stream can bypass the converter.
+bool rigo_resample_is_identity(const rigo_resample_t *rs);
+
+// Upper bound on output frames for `in_frames` input frames.
+int rigo_resample_max_out(const rigo_resample_t *rs, int in_frames);
+
+// Converts interleaved input frames; returns output frames written. `out`
+// must hold rigo_resample_max_out(in_frames) frames.
+int rigo_resample_process(rigo_resample_t *rs, const int16_t *in, int in_frames, int16_t *out);
+
+// End of stream: pushes silence through the filter so the samples still in
+// its delay line come out. `out` must hold rigo_resample_max_out(RIGO_RS_TAPS / 2).
+int rigo_resample_flush(rigo_resample_t *rs, int16_t *out);
+
+void rigo_resample_free(rigo_resample_t *rs);
@@ -0,0 +1,77 @@
+#include "rigo_respbuf.h"
+
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static const char *TAG = "rigo_respbuf";
+
+#define MIN_CAP 1024
+
+void rigo_respbuf_reset(rigo_respbuf_t *b)
+{
+    // a one-off huge reply should not pin PSRAM for the rest of uptime
+    if (b->cap > CONFIG_RIGO_RESPBUF_KEEP_KB * 1024) {
+        heap_caps_free(b->data);
+        b->data = NULL;
+        b->cap = 0;
+    }
+    b->len = 0;
+    if (b->data) b->data[0] = 0;
+}
+
+bool rigo_respbuf_reserve(rigo_respbuf_t *b, size_t total)
+{
+    if (total + 1 <= b->cap) return true;
+
+    size_t cap = b->cap ? b->cap : MIN_CAP;
+    while (cap < total + 1) cap *= 2;
+
+    uint8_t *n = heap_caps_realloc(b->data, cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!n) {
+        ESP_LOGE(TAG, "%s: cannot grow to %u bytes", b->name, (unsigned)cap);
+        return false;
+    }
+    b->data = n;
+    b->cap = cap;
+    b->grows++;
+    return true;
+}
+
+static void note_len(rigo_respbuf_t *b)
+{
+    b->data[b->len] = 0;
+    if (b->len > b->high_water) {
+        b->high_water = b->len;
+        ESP_LOGI(TAG, "%s: new high-water %u bytes (cap %u, %u grows)",
+                 b->name, (unsigned)b->high_water, (unsigned)b->cap, (unsigned)b->grows);
+    }
+}
+
+bool rigo_respbuf_append(rigo_respbuf_t *b, const void *data, size_t len)
+{
+    if (!rigo_respbuf_reserve(b, b->len + len)) return false;
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    note_len(b);
+    return true;
+}
+
+bool rigo_respbuf_read_http(rigo_respbuf_t *b, esp_http_client_handle_t c)
+{
+    rigo_respbuf_reset(b);
+    int64_t clen = esp_http_client_get_content_length(c);
+    if (!rigo_respbuf_reserve(b, clen > 0 ? (size_t)clen : MIN_CAP)) return false;
+
+    while (clen <= 0 || b->len < (size_t)clen) {
+        // read straight into the buffer; no bounce copy
+        if (b->len + 1 >= b->cap && !rigo_respbuf_reserve(b, b->cap)) return false;
+        int rd = esp_http_client_read(c, (char *)b->data + b->len, b->cap - b->len - 1);
+        if (rd < 0) return false;
+        if (rd == 0) break;
+        b->len += rd;
+    }
+    note_len(b);
+    return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_http_client.h"
+
+// Reusable HTTP response body buffer. Capacity is kept across turns, sized
+// from Content-Length when the server sends one and grown geometrically in
+// PSRAM otherwise. data is always NUL-terminated.
+typedef struct {
+    const char *name;
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    size_t high_water;
+    uint32_t grows;
+} rigo_respbuf_t;
+
+#define RIGO_RESPBUF_INIT(n) { .name = (n) }
+
+void rigo_respbuf_reset(rigo_respbuf_t *b);
+bool rigo_respbuf_reserve(rigo_respbuf_t *b, size_t total);
+bool rigo_respbuf_append(rigo_respbuf_t *b, const void *data, size_t len);
+
+// Read the whole body once the response headers have been fetched.
+bool rigo_respbuf_read_http(rigo_respbuf_t *b, esp_http_client_handle_t c);
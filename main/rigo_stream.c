@@ -0,0 +1,127 @@
+#include "rigo_stream.h"
+
+#include <string.h>
+
+#include "cJSON.h"
+
+void rigo_stream_init(rigo_stream_t *s, rigo_stream_mode_t mode, rigo_stream_text_cb_t cb, void *ctx)
+{
+    memset(s, 0, sizeof(*s));
+    s->mode = mode;
+    s->cb = cb;
+    s->ctx = ctx;
+}
+
+static const cJSON *string_item(const cJSON *obj, const char *key)
+{
+    const cJSON *it = cJSON_GetObjectItemCaseSensitive(obj, key);
+    return cJSON_IsString(it) && it->valuestring ? it : NULL;
+}
+
+// {"delta":"..."}, {"text":"..."}, {"reply":"..."}, {"content":"..."},
+// {"delta":{"text":"..."}} and {"choices":[{"delta":{"content":"..."}}]}
+static const char *json_delta(const cJSON *root)
+{
+    static const char *const keys[] = {"delta", "text", "reply", "content"};
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        const cJSON *it = string_item(root, keys[i]);
+        if (it) return it->valuestring;
+    }
+
+    const cJSON *delta = cJSON_GetObjectItemCaseSensitive(root, "delta");
+    if (cJSON_IsObject(delta)) {
+        const cJSON *it = string_item(delta, "text");
+        if (!it) it = string_item(delta, "content");
+        if (it) return it->valuestring;
+    }
+
+    const cJSON *choices = cJSON_GetObjectItemCaseSensitive(root, "choices");
+    if (cJSON_IsArray(choices)) {
+        const cJSON *c0 = cJSON_GetArrayItem(choices, 0);
+        const cJSON *d = cJSON_GetObjectItemCaseSensitive(c0, "delta");
+        const cJSON *it = cJSON_IsObject(d) ? string_item(d, "content") : NULL;
+        if (it) return it->valuestring;
+    }
+    return NULL;
+}
+
+void rigo_stream_dispatch(rigo_stream_t *s, const char *payload, int len)
+{
+    if (s->done || len <= 0) return;
+    s->events++;
+
+    if (len == 6 && memcmp(payload, "[DONE]", 6) == 0) {
+        s->done = true;
+        return;
+    }
+
+    if (payload[0] != '{') {
+        s->cb(payload, len, s->ctx);
+        return;
+    }
+
+    cJSON *root = cJSON_ParseWithLength(payload, len);
+    if (!root) return;
+    const char *text = json_delta(root);
+    if (text && text[0]) s->cb(text, strlen(text), s->ctx);
+    const cJSON *done = cJSON_GetObjectItemCaseSensitive(root, "done");
+    if (cJSON_IsTrue(done)) s->done = true;
+    cJSON_Delete(root);
+}
+
+static void event_append(rigo_stream_t *s, const char *data, int len)
+{
+    if (s->event_len > 0 && s->event_len < (int)sizeof(s->event)) s->event[s->event_len++] = '\n';
+    int n = len;
+    if (n > (int)sizeof(s->event) - s->event_len) n = sizeof(s->event) - s->event_len;
+    memcpy(s->event + s->event_len, data, n);
+    s->event_len += n;
+}
+
+static void on_line(rigo_stream_t *s, char *line, int len)
+{
+    if (len > 0 && line[len - 1] == '\r') len--;
+
+    if (s->mode == RIGO_STREAM_NDJSON) {
+        rigo_stream_dispatch(s, line, len);
+        return;
+    }
+
+    if (len == 0) {
+        rigo_stream_dispatch(s, s->event, s->event_len);
+        s->event_len = 0;
+        return;
+    }
+    // only data: fields matter; event:/id:/retry: and ":" comments are skipped
+    if (len >= 5 && memcmp(line, "data:", 5) == 0) {
+        int off = (len > 5 && line[5] == ' ') ? 6 : 5;
+        event_append(s, line + off, len - off);
+    }
+}
+
+void rigo_stream_feed(rigo_stream_t *s, const char *data, int len)
+{
+    for (int i = 0; i < len; i++) {
+        char c = data[i];
+        if (c == '\n') {
+            if (!s->line_overflow) on_line(s, s->line, s->line_len);
+            s->line_len = 0;
+            s->line_overflow = false;
+        } else if (s->line_len < (int)sizeof(s->line)) {
+            s->line[s->line_len++] = c;
+        } else {
+            // a single oversized line is dropped whole rather than emitted truncated
+            s->line_overflow = true;
+        }
+    }
+}
+
+void rigo_stream_finish(rigo_stream_t *s)
+{
+    if (s->line_len > 0 && !s->line_overflow) on_line(s, s->line, s->line_len);
+    s->line_len = 0;
+    if (s->mode == RIGO_STREAM_SSE && s->event_len > 0) {
+        rigo_stream_dispatch(s, s->event, s->event_len);
+        s->event_len = 0;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+
+typedef enum {
+    RIGO_STREAM_SSE = 0,    // text/event-stream: "data: ..." lines, blank line ends an event
+    RIGO_STREAM_NDJSON,     // one JSON object per line
+} rigo_stream_mode_t;
+
+// Called for every text delta extracted from the stream.
+typedef void (*rigo_stream_text_cb_t)(const char *text, int len, void *ctx);
+
+#define RIGO_STREAM_LINE_MAX 2048
+
+typedef struct {
+    rigo_stream_mode_t mode;
+    rigo_stream_text_cb_t cb;
+    void *ctx;
+    char line[RIGO_STREAM_LINE_MAX];
+    int line_len;
+    bool line_overflow;
+    char event[RIGO_STREAM_LINE_MAX];
+    int event_len;
+    bool done;
+    int events;
+} rigo_stream_t;
+
+void rigo_stream_init(rigo_stream_t *s, rigo_stream_mode_t mode, rigo_stream_text_cb_t cb, void *ctx);
+
+// Bytes as they come off the socket, split anywhere.
+void rigo_stream_feed(rigo_stream_t *s, const char *data, int len);
+
+// End of body: flushes an unterminated last line/event.
+void rigo_stream_finish(rigo_stream_t *s);
+
+// Text carried by one event payload: "[DONE]" ends the stream, JSON objects
+// are searched for the usual delta fields, anything else is plain text.
+void rigo_stream_dispatch(rigo_stream_t *s, const char *payload, int len);
@@ -0,0 +1,279 @@
+#include "rigo_stt_ws.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/param.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_transport.h"
+#include "esp_transport_ssl.h"
+#include "esp_transport_tcp.h"
+#include "esp_transport_ws.h"
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include "esp_crt_bundle.h"
+#endif
+#include "cJSON.h"
+
+#include "rigo_arena.h"
+#include "rigo_conn.h"
+#include "rigo_metrics.h"
+
+static const char *TAG = "rigo_stt_ws";
+
+#define TIMEOUT_MS 20000        // same budget as the HTTP STT endpoint
+#define RX_CAP 1024             // longest server frame kept; the rest is skipped
+
+static esp_transport_handle_t ws;
+static bool connected;
+static uint32_t session;
+static bool final_in;
+static char *final_text;      // turn arena; handed over by finish or freed by abort
+static char rx[RX_CAP];
+static rigo_stt_ws_stats_t stats;
+
+// ws://host[:port]/path or wss://...
+static bool parse_url(char *host, int host_cap, int *port, const char **path, bool *tls)
+{
+    const char *u = CONFIG_RIGO_STT_WS_URL;
+    if (!u[0]) return false;
+    if (strncasecmp(u, "wss://", 6) == 0) {
+        *tls = true;
+        *port = 443;
+        u += 6;
+    } else if (strncasecmp(u, "ws://", 5) == 0) {
+        *tls = false;
+        *port = 80;
+        u += 5;
+    } else {
+        return false;
+    }
+    const char *slash = strchr(u, '/');
+    const char *end = slash ? slash : u + strlen(u);
+    const char *colon = memchr(u, ':', end - u);
+    const char *hend = colon ? colon : end;
+    if (hend == u || hend - u >= host_cap) return false;
+    memcpy(host, u, hend - u);
+    host[hend - u] = 0;
+    if (colon) *port = atoi(colon + 1);
+    *path = slash ? slash : "/";
+    return true;
+}
+
+static bool ws_connect(void)
+{
+    char host[128];
+    int port;
+    const char *path;
+    bool tls;
+    if (!parse_url(host, sizeof(host), &port, &path, &tls)) {
+        ESP_LOGE(TAG, "Bad CONFIG_RIGO_STT_WS_URL: %s", CONFIG_RIGO_STT_WS_URL);
+        return false;
+    }
+    if (!ws) {
+        esp_transport_handle_t base = tls ? esp_transport_ssl_init() : esp_transport_tcp_init();
+        if (!base) return false;
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        if (tls) esp_transport_ssl_crt_bundle_attach(base, esp_crt_bundle_attach);
+#endif
+        ws = esp_transport_ws_init(base);
+        if (!ws) {
+            esp_transport_destroy(base);
+            return false;
+        }
+        esp_transport_ws_set_path(ws, path);
+        if (strlen(CONFIG_RIGO_API_BEARER) > 0) {
+            char auth[256];
+            snprintf(auth, sizeof(auth), "Authorization: Bearer %s\r\n", CONFIG_RIGO_API_BEARER);
+            esp_transport_ws_set_headers(ws, auth);
+        }
+    }
+    int64_t t0 = esp_timer_get_time();
+    if (esp_transport_connect(ws, host, port, TIMEOUT_MS) < 0) {
+        ESP_LOGE(TAG, "Connect to %s failed", CONFIG_RIGO_STT_WS_URL);
+        return false;
+    }
+    connected = true;
+    stats.connects++;
+    ESP_LOGI(TAG, "Connected in %d ms", (int)((esp_timer_get_time() - t0) / 1000));
+    return true;
+}
+
+static void ws_close(void)
+{
+    if (connected) esp_transport_close(ws);
+    connected = false;
+}
+
+static bool ws_fail(const char *what)
+{
+    ESP_LOGE(TAG, "%s failed, reconnecting next turn", what);
+    stats.failures++;
+    ws_close();
+    return false;
+}
+
+static bool send_frame(ws_transport_opcodes_t op, const void *data, int len)
+{
+    return esp_transport_ws_send_raw(ws, op | WS_TRANSPORT_OPCODES_FIN, data, len, TIMEOUT_MS) >= 0;
+}
+
+static bool send_ctl(const char *type, const char *extra)
+{
+    char msg[128];
+    int n = snprintf(msg, sizeof(msg), "{\"type\":\"%s\",\"id\":%u%s}", type, (unsigned)session, extra);
+    return send_frame(WS_TRANSPORT_OPCODES_TEXT, msg, n);
+}
+
+static void on_text(const char *json)
+{
+    cJSON *r = cJSON_Parse(json);
+    if (!r) return;
+    const cJSON *type = cJSON_GetObjectItemCaseSensitive(r, "type");
+    const cJSON *id = cJSON_GetObjectItemCaseSensitive(r, "id");
+    const cJSON *text = cJSON_GetObjectItemCaseSensitive(r, "text");
+    if (cJSON_IsString(type) && cJSON_IsNumber(id) && (uint32_t)id->valuedouble == session &&
+        cJSON_IsString(text) && text->valuestring) {
+        if (strcmp(type->valuestring, "partial") == 0) {
+            stats.partials++;
+            ESP_LOGI(TAG, "Partial: %s", text->valuestring);
+        } else if (strcmp(type->valuestring, "final") == 0 && !final_in) {
+            final_in = true;
+            stats.finals++;
+            if (text->valuestring[0]) final_text = rigo_arena_strdup(text->valuestring);
+        }
+    }
+    cJSON_Delete(r);
+}
+
+// One frame whose first bytes are already readable. false: connection gone.
+static bool read_frame(void)
+{
+    int got = esp_transport_read(ws, rx, RX_CAP - 1, TIMEOUT_MS);
+    if (got < 0) return false;
+    const ws_transport_opcodes_t op = esp_transport_ws_get_read_opcode(ws);
+    const int len = esp_transport_ws_get_read_payload_len(ws);
+    int kept = got;
+    while (got < len) {
+        char skip[64];
+        const bool keep = kept < RX_CAP - 1;
+        int n = esp_transport_read(ws, keep ? rx + kept : skip, keep ? RX_CAP - 1 - kept : (int)sizeof(skip),
+                                   TIMEOUT_MS);
+        if (n <= 0) return false;
+        got += n;
+        if (keep) kept += n;
+    }
+    if (op == WS_TRANSPORT_OPCODES_CLOSE) return false;
+    if (op == WS_TRANSPORT_OPCODES_TEXT) {
+        rx[kept] = 0;
+        on_text(rx);
+    }
+    return true;
+}
+
+// Takes in every frame already received; with a timeout, waits for one first.
+static bool poll_frames(int wait_ms)
+{
+    while (connected && !final_in) {
+        int p = esp_transport_poll_read(ws, wait_ms);
+        if (p == 0) return true;
+        if (p < 0 || !read_frame()) return false;
+        wait_ms = 0;
+    }
+    return connected;
+}
+
+bool rigo_stt_ws_begin(const char *encoding)
+{
+    session++;
+    final_in = false;
+    stats.sessions++;
+
+    // a server that closed the idle socket shows up as a readable EOF here
+    bool reused = connected && poll_frames(0);
+    if (!reused) {
+        ws_close();
+        if (!ws_connect()) return ws_fail("Connect");
+    }
+    char extra[64];
+    snprintf(extra, sizeof(extra), ",\"rate\":16000,\"encoding\":\"%s\"", encoding);
+    bool ok = send_ctl("start", extra);
+    if (!ok && reused) {
+        ws_close();
+        reused = false;
+        ok = ws_connect() && send_ctl("start", extra);
+    }
+    if (!ok) return ws_fail("Start");
+    if (reused) stats.reuses++;
+    return true;
+}
+
+bool rigo_stt_ws_send(const void *data, int len)
+{
+    if (!connected) return false;
+    if (!send_frame(WS_TRANSPORT_OPCODES_BINARY, data, len)) return ws_fail("Audio send");
+    // transcripts are taken in between mic frames, never waited for here
+    if (!poll_frames(0)) return ws_fail("Receive");
+    return true;
+}
+
+bool rigo_stt_ws_final(void)
+{
+    return final_in;
+}
+
+char *rigo_stt_ws_finish(uint32_t turn)
+{
+    if (!connected) return NULL;
+    const bool early = final_in;
+    if (!early && !send_ctl("end", "")) {
+        ws_fail("End");
+        return NULL;
+    }
+    rigo_metrics_mark(turn, RIGO_MARK_STT_SENT);
+
+    const int64_t t0 = esp_timer_get_time();
+    const int64_t caller = rigo_conn_deadline();
+    int64_t deadline = t0 + (int64_t)TIMEOUT_MS * 1000;
+    if (caller && caller < deadline) deadline = caller;
+    while (!final_in) {
+        const int64_t now = esp_timer_get_time();
+        if (now >= deadline) {
+            // the socket stays: a final that turns up later carries a stale id
+            if (deadline == caller) stats.late++;
+            else stats.failures++;
+            ESP_LOGW(TAG, "No final transcript %d ms after end of speech", (int)((now - t0) / 1000));
+            return NULL;
+        }
+        if (!poll_frames((int)((deadline - now + 999) / 1000))) {
+            ws_fail("Receive");
+            return NULL;
+        }
+    }
+
+    const uint32_t ms = (esp_timer_get_time() - t0) / 1000;
+    stats.final_ms_last = ms;
+    stats.final_ms_max = MAX(stats.final_ms_max, ms);
+    if (early) stats.early_finals++;
+    rigo_metrics_mark(turn, RIGO_MARK_STT_FIRST_BYTE);
+    rigo_metrics_mark(turn, RIGO_MARK_STT_DONE);
+    if (early) ESP_LOGI(TAG, "Final before end of speech");
+    else ESP_LOGI(TAG, "Final %u ms after end of speech", (unsigned)ms);
+    char *text = final_text;
+    final_text = NULL;
+    return text;
+}
+
+void rigo_stt_ws_abort(void)
+{
+    if (connected && !final_in && !send_ctl("cancel", "")) ws_fail("Cancel");
+    rigo_arena_free(final_text);
+    final_text = NULL;
+}
+
+void rigo_stt_ws_get_stats(rigo_stt_ws_stats_t *out)
+{
+    *out = stats;
+}
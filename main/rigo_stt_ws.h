@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Streaming STT over one persistent WebSocket (CONFIG_RIGO_STT_WS), kept
+// open across turns. Per utterance the device sends a text frame
+// {"type":"start","id":N,"rate":16000,"encoding":...}, the audio as binary
+// frames while capturing and {"type":"end","id":N} at end of speech. The
+// server answers with {"type":"partial","id":N,"text":...} as recognition
+// goes and one {"type":"final","id":N,"text":...}. Frames for other ids are
+// ignored, so a cancelled utterance cannot leak into the next one.
+
+typedef struct {
+    uint32_t sessions;
+    uint32_t connects;
+    uint32_t reuses;
+    uint32_t partials;
+    uint32_t finals;
+    uint32_t early_finals;      // final in before the device's own end of speech
+    uint32_t failures;
+    uint32_t late;              // no final by the caller's deadline
+    uint32_t final_ms_last;     // end sent -> final received
+    uint32_t final_ms_max;
+} rigo_stt_ws_stats_t;
+
+// Connects (or reuses the open socket) and starts an utterance; encoding is
+// "pcm_s16le" or "ima_adpcm" (256-byte blocks).
+bool rigo_stt_ws_begin(const char *encoding);
+// One binary frame, then whatever transcripts have arrived are taken in.
+bool rigo_stt_ws_send(const void *data, int len);
+// The final transcript is already in (the server ended the utterance).
+bool rigo_stt_ws_final(void);
+// Ends the utterance and waits for the final transcript until the calling
+// task's rigo_conn deadline; the STT marks go to rigo_metrics `turn`. Returns
+// it or NULL; free with rigo_arena_free.
+char *rigo_stt_ws_finish(uint32_t turn);
+void rigo_stt_ws_abort(void);
+
+void rigo_stt_ws_get_stats(rigo_stt_ws_stats_t *out);
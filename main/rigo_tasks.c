@@ -0,0 +1,103 @@
+#include "rigo_tasks.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/task.h"
+
+#define MAX_TASKS 48
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+typedef struct {
+    TaskHandle_t handle;
+    configRUN_TIME_COUNTER_TYPE runtime;
+} prev_t;
+
+// previous snapshot, for CPU share over the interval between two calls
+static prev_t prev[MAX_TASKS];
+static int prev_n;
+static configRUN_TIME_COUNTER_TYPE prev_total;
+
+static const char *state_str(eTaskState s)
+{
+    switch (s) {
+        case eRunning: return "running";
+        case eReady: return "ready";
+        case eBlocked: return "blocked";
+        case eSuspended: return "suspended";
+        default: return "deleted";
+    }
+}
+
+static configRUN_TIME_COUNTER_TYPE runtime_before(TaskHandle_t h)
+{
+    for (int i = 0; i < prev_n; i++) {
+        if (prev[i].handle == h) return prev[i].runtime;
+    }
+    return 0;   // started since the previous call
+}
+
+// Share of one core over the interval, in tenths of a percent.
+static unsigned share_permille(const TaskStatus_t *t, configRUN_TIME_COUNTER_TYPE span)
+{
+    if (span == 0) return 0;
+    return (unsigned)((uint64_t)(configRUN_TIME_COUNTER_TYPE)(t->ulRunTimeCounter - runtime_before(t->xHandle)) *
+                      1000 / span);
+}
+#endif
+
+void rigo_tasks_write_json(rigo_metrics_emit_t emit, void *ctx)
+{
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    UBaseType_t cap = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *st = malloc(cap * sizeof(*st));
+    if (!st) return;
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    UBaseType_t n = uxTaskGetSystemState(st, cap, &total);
+    configRUN_TIME_COUNTER_TYPE span = total - prev_total;
+
+    char buf[192];
+    int len = snprintf(buf, sizeof(buf), "{\"interval_ms\":%u,\"cores\":[", (unsigned)(span / 1000));
+    emit(buf, len, ctx);
+    // idle share per core; the host build has no idle tasks
+    bool first = true;
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++) {
+        TaskHandle_t idle = xTaskGetIdleTaskHandleForCore(core);
+        for (UBaseType_t i = 0; idle && i < n; i++) {
+            if (st[i].xHandle != idle) continue;
+            unsigned pm = share_permille(&st[i], span);
+            len = snprintf(buf, sizeof(buf), "%s{\"core\":%d,\"idle_pct\":%u.%u}", first ? "" : ",", (int)core,
+                           pm / 10, pm % 10);
+            emit(buf, len, ctx);
+            first = false;
+        }
+    }
+    emit("],\"tasks\":[", 11, ctx);
+    for (UBaseType_t i = 0; i < n; i++) {
+        const TaskStatus_t *t = &st[i];
+        BaseType_t core = xTaskGetCoreID(t->xHandle);
+        unsigned pm = share_permille(t, span);
+        len = snprintf(buf, sizeof(buf),
+                       "%s{\"name\":\"%s\",\"core\":%d,\"prio\":%u,\"state\":\"%s\",\"cpu_pct\":%u.%u,"
+                       "\"stack_free_min\":%u}",
+                       i ? "," : "", t->pcTaskName, core == tskNO_AFFINITY ? -1 : (int)core,
+                       (unsigned)t->uxCurrentPriority, state_str(t->eCurrentState), pm / 10, pm % 10,
+                       (unsigned)t->usStackHighWaterMark);
+        emit(buf, len, ctx);
+    }
+    emit("]}", 2, ctx);
+
+    prev_n = n < MAX_TASKS ? n : MAX_TASKS;
+    for (int i = 0; i < prev_n; i++) {
+        prev[i].handle = st[i].xHandle;
+        prev[i].runtime = st[i].ulRunTimeCounter;
+    }
+    prev_total = total;
+    free(st);
+#else
+    static const char msg[] = "{\"error\":\"CONFIG_FREERTOS_USE_TRACE_FACILITY is disabled\"}";
+    emit(msg, sizeof(msg) - 1, ctx);
+#endif
+}
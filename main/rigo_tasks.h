@@ -0,0 +1,13 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#include "rigo_metrics.h"
+
+// Kconfig core numbers (RIGO_TASK_*_CORE): -1 lets the scheduler pick.
+#define RIGO_TASK_CORE(n) ((n) < 0 ? tskNO_AFFINITY : (n))
+
+// Every task with its core, priority, CPU share (% of one core) since the
+// previous call and stack headroom, as JSON. CPU figures need
+// CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS.
+void rigo_tasks_write_json(rigo_metrics_emit_t emit, void *ctx);
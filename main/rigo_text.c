@@ -0,0 +1,56 @@
+#include "rigo_text.h"
+
+#include <ctype.h>
+
+static bool is_space(char c)
+{
+    return isspace((unsigned char)c) != 0;
+}
+
+static int utf8_floor(const char *text, int pos)
+{
+    while (pos > 0 && ((unsigned char)text[pos] & 0xC0) == 0x80) pos--;
+    return pos;
+}
+
+int rigo_text_segment(const char *text, int len, bool final, int min_chars, int max_chars)
+{
+    int clause = 0;
+    int space = 0;
+
+    for (int i = 0; i < len; i++) {
+        char c = text[i];
+        bool at_end = i + 1 == len;
+
+        if (c == '\n' && i + 1 >= min_chars) return i + 1;
+
+        if (c == '.' || c == '!' || c == '?') {
+            // "3.5" and "e.g." mid-word are not boundaries; only punctuation followed by space
+            if (at_end && !final) return 0;
+            if ((at_end || is_space(text[i + 1])) && i + 1 >= min_chars) return i + 1;
+        } else if ((c == ',' || c == ';' || c == ':') && !at_end && is_space(text[i + 1])) {
+            clause = i + 1;
+        } else if (is_space(c)) {
+            space = i;
+        }
+
+        if (i + 1 >= max_chars) {
+            if (clause > 0) return clause;
+            if (space > 0) return space;
+            return utf8_floor(text, i + 1);
+        }
+    }
+    return final ? len : 0;
+}
+
+const char *rigo_text_trim(const char *text, int *len)
+{
+    int n = *len;
+    while (n > 0 && is_space(*text)) {
+        text++;
+        n--;
+    }
+    while (n > 0 && is_space(text[n - 1])) n--;
+    *len = n;
+    return text;
+}
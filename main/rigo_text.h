@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdbool.h>
+
+// Length of the first complete speakable segment in text[0..len).
+// Segments end at sentence punctuation once at least min_chars long, and are
+// cut at a clause boundary or space when they would exceed max_chars.
+// With final == false, 0 means "need more text"; with final == true the tail
+// is returned as the last segment.
+int rigo_text_segment(const char *text, int len, bool final, int min_chars, int max_chars);
+
+// Trim leading/trailing whitespace in place; returns the new start and length.
+const char *rigo_text_trim(const char *text, int *len);
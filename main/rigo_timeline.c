@@ -0,0 +1,179 @@
+#include "rigo_timeline.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+typedef struct {
+    uint32_t t_ms;
+    rigo_pose_t pose;   // mask: channels set at this keyframe
+} keyframe_t;
+
+#define START_PENDING INT64_MAX
+
+static portMUX_TYPE tl_mux = portMUX_INITIALIZER_UNLOCKED;
+static keyframe_t *keys;    // playing, sorted by time
+static keyframe_t *staging; // parse target, copied in under tl_mux
+static int nkeys;
+static int64_t start_us = START_PENDING;
+static bool wait_audio;
+
+esp_err_t rigo_timeline_init(void)
+{
+    keys = heap_caps_calloc(CONFIG_RIGO_TIMELINE_MAX_KEYS, sizeof(keyframe_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    staging = heap_caps_calloc(CONFIG_RIGO_TIMELINE_MAX_KEYS, sizeof(keyframe_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return keys && staging ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static int by_time(const void *a, const void *b)
+{
+    const keyframe_t *x = a, *y = b;
+    return x->t_ms < y->t_ms ? -1 : x->t_ms > y->t_ms;
+}
+
+static uint8_t clamp_u8(double v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : (uint8_t)v;
+}
+
+static bool parse_key(const cJSON *k, int (*expr_index)(const char *), keyframe_t *out)
+{
+    const cJSON *t = cJSON_GetObjectItemCaseSensitive(k, "t");
+    if (!cJSON_IsNumber(t) || t->valuedouble < 0) return false;
+    memset(out, 0, sizeof(*out));
+    out->t_ms = (uint32_t)t->valuedouble;
+
+    const cJSON *emotion = cJSON_GetObjectItemCaseSensitive(k, "emotion");
+    const cJSON *mouth = cJSON_GetObjectItemCaseSensitive(k, "mouth");
+    const cJSON *eyes = cJSON_GetObjectItemCaseSensitive(k, "eyes");
+    const cJSON *brows = cJSON_GetObjectItemCaseSensitive(k, "brows");
+    if (cJSON_IsString(emotion)) {
+        out->pose.mask |= RIGO_POSE_EXPR;
+        out->pose.expr = expr_index(emotion->valuestring);
+    }
+    if (cJSON_IsNumber(mouth)) {
+        out->pose.mask |= RIGO_POSE_MOUTH;
+        out->pose.mouth = clamp_u8(mouth->valuedouble);
+    }
+    if (cJSON_IsNumber(eyes)) {
+        out->pose.mask |= RIGO_POSE_EYES;
+        out->pose.eyes = clamp_u8(eyes->valuedouble);
+    }
+    if (cJSON_IsArray(brows) && cJSON_GetArraySize(brows) == 4) {
+        out->pose.mask |= RIGO_POSE_BROWS;
+        for (int i = 0; i < 4; i++) out->pose.brows[i] = (int16_t)cJSON_GetArrayItem(brows, i)->valuedouble;
+    }
+    return out->pose.mask != 0;
+}
+
+int rigo_timeline_load(const cJSON *root, int (*expr_index)(const char *), const char **err)
+{
+    const cJSON *list = cJSON_GetObjectItemCaseSensitive(root, "keyframes");
+    const cJSON *start = cJSON_GetObjectItemCaseSensitive(root, "start");
+    if (!cJSON_IsArray(list)) {
+        *err = "keyframes must be an array";
+        return -1;
+    }
+    int n = cJSON_GetArraySize(list);
+    if (n > CONFIG_RIGO_TIMELINE_MAX_KEYS) {
+        *err = "too many keyframes";
+        return -1;
+    }
+    int i = 0;
+    const cJSON *k;
+    cJSON_ArrayForEach(k, list) {
+        if (!parse_key(k, expr_index, &staging[i])) {
+            *err = "keyframe needs t and at least one channel";
+            return -1;
+        }
+        i++;
+    }
+    qsort(staging, n, sizeof(keyframe_t), by_time);
+    bool audio = cJSON_IsString(start) && strcmp(start->valuestring, "audio") == 0;
+
+    portENTER_CRITICAL(&tl_mux);
+    memcpy(keys, staging, n * sizeof(keyframe_t));
+    nkeys = n;
+    wait_audio = audio;
+    start_us = audio ? START_PENDING : esp_timer_get_time();
+    portEXIT_CRITICAL(&tl_mux);
+    return n;
+}
+
+void rigo_timeline_audio_started(int64_t now_us)
+{
+    portENTER_CRITICAL(&tl_mux);
+    if (wait_audio) {
+        wait_audio = false;
+        start_us = now_us;
+    }
+    portEXIT_CRITICAL(&tl_mux);
+}
+
+static int lerp(int a, int b, uint32_t t0, uint32_t t1, uint32_t t)
+{
+    if (t1 <= t0) return b;
+    return a + (int)((int64_t)(b - a) * (t - t0) / (t1 - t0));
+}
+
+// One channel: step for the expression, linear between its own keyframes
+// for the rest. Keyframes without the channel are skipped.
+static void sample_channel(uint8_t ch, uint32_t t, rigo_pose_t *out)
+{
+    const keyframe_t *prev = NULL, *next = NULL;
+    for (int i = 0; i < nkeys; i++) {
+        if (!(keys[i].pose.mask & ch)) continue;
+        if (keys[i].t_ms <= t) {
+            prev = &keys[i];
+        } else {
+            next = &keys[i];
+            break;
+        }
+    }
+    if (!prev) return;      // channel not started yet
+    out->mask |= ch;
+    const rigo_pose_t *a = &prev->pose;
+    const rigo_pose_t *b = next && ch != RIGO_POSE_EXPR ? &next->pose : a;
+    const uint32_t t0 = prev->t_ms, t1 = next ? next->t_ms : t0;
+    switch (ch) {
+        case RIGO_POSE_EXPR: out->expr = a->expr; break;
+        case RIGO_POSE_MOUTH: out->mouth = lerp(a->mouth, b->mouth, t0, t1, t); break;
+        case RIGO_POSE_EYES: out->eyes = lerp(a->eyes, b->eyes, t0, t1, t); break;
+        default:
+            for (int i = 0; i < 4; i++) out->brows[i] = lerp(a->brows[i], b->brows[i], t0, t1, t);
+            break;
+    }
+}
+
+bool rigo_timeline_sample(int64_t now_us, rigo_pose_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    bool running = false;
+    portENTER_CRITICAL(&tl_mux);
+    if (nkeys > 0 && start_us != START_PENDING && now_us >= start_us) {
+        uint32_t t = (uint32_t)((now_us - start_us) / 1000);
+        if (t <= keys[nkeys - 1].t_ms) {
+            running = true;
+            sample_channel(RIGO_POSE_EXPR, t, out);
+            sample_channel(RIGO_POSE_MOUTH, t, out);
+            sample_channel(RIGO_POSE_BROWS, t, out);
+            sample_channel(RIGO_POSE_EYES, t, out);
+        } else {
+            nkeys = 0;      // finished
+        }
+    }
+    portEXIT_CRITICAL(&tl_mux);
+    return running;
+}
+
+uint32_t rigo_timeline_duration_ms(void)
+{
+    portENTER_CRITICAL(&tl_mux);
+    uint32_t d = nkeys > 0 ? keys[nkeys - 1].t_ms : 0;
+    portEXIT_CRITICAL(&tl_mux);
+    return d;
+}
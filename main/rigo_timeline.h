@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "cJSON.h"
+
+// Keyframed avatar animation. A POST /v1/timeline upload replaces the
+// current timeline; the UI samples it every frame at the frame's own
+// timestamp, interpolating mouth, brows and eyes between keyframes, so
+// the pose does not snap to the timer period.
+
+#define RIGO_POSE_EXPR 0x01
+#define RIGO_POSE_MOUTH 0x02
+#define RIGO_POSE_BROWS 0x04
+#define RIGO_POSE_EYES 0x08
+
+typedef struct {
+    uint8_t mask;       // RIGO_POSE_* channels the timeline drives
+    int8_t expr;        // avatar expression index
+    uint8_t mouth;      // opening 0..255
+    uint8_t eyes;       // openness 0 (closed)..255
+    int16_t brows[4];   // y of left inner, left outer, right inner, right outer
+} rigo_pose_t;
+
+// Allocates the keyframe store (CONFIG_RIGO_TIMELINE_MAX_KEYS).
+esp_err_t rigo_timeline_init(void);
+
+// {"start":"now"|"audio","keyframes":[{"t":ms,"emotion":..,"mouth":..,
+// "brows":[4],"eyes":..},...]}. `expr_index` maps emotion names. With
+// "start":"audio" the clock starts at the next rigo_timeline_audio_started.
+// An empty keyframes list drops the current timeline. Returns the keyframe
+// count or < 0 with `err` set.
+int rigo_timeline_load(const cJSON *root, int (*expr_index)(const char *name), const char **err);
+
+// Playback has started; anchors a timeline waiting for audio.
+void rigo_timeline_audio_started(int64_t now_us);
+
+// Pose at `now_us`. false when no timeline is running (none loaded, still
+// waiting for audio, or past its last keyframe).
+bool rigo_timeline_sample(int64_t now_us, rigo_pose_t *out);
+
+// Duration of the loaded timeline (last keyframe time).
+uint32_t rigo_timeline_duration_ms(void);
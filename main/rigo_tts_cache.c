@@ -0,0 +1,343 @@
+#include "rigo_tts_cache.h"
+
+#include <string.h>
+
+#include "freertos/semphr.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "rigo_tts_cache";
+
+#define RAM_SLOTS 32
+#define SECTOR 4096
+#define REC_MAGIC 0x31435452u   // "RTC1"
+#define RAM_LIMIT (CONFIG_RIGO_TTS_CACHE_RAM_KB * 1024)
+#define ENTRY_LIMIT (CONFIG_RIGO_TTS_CACHE_ENTRY_KB * 1024)
+
+// Flash record: this header at a sector boundary, the WAV bytes right after it,
+// padded to whole sectors. tools/tts_cache_seed.py writes the same layout.
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t key;
+    uint32_t len;
+    uint32_t crc;
+    uint32_t reserved[2];
+} rec_hdr_t;
+
+typedef struct {
+    uint64_t key;
+    uint8_t *data;
+    int len;
+    uint32_t last_use;
+    uint16_t hits;
+    uint8_t pins;       // being streamed out, not evictable
+    bool on_flash;
+} ram_entry_t;
+
+typedef struct {
+    uint64_t key;
+    uint32_t off;
+    uint32_t len;
+    uint32_t seq;
+} flash_entry_t;
+
+static SemaphoreHandle_t lock;
+static ram_entry_t ram[RAM_SLOTS];
+static uint32_t use_clock;
+
+static const esp_partition_t *part;
+static flash_entry_t *flash_idx;
+static int flash_count;
+static int flash_cap;
+static uint32_t flash_head;
+static uint32_t flash_seq;
+
+static rigo_tts_cache_stats_t stats;
+
+static uint64_t fnv1a(uint64_t h, const char *s)
+{
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+uint64_t rigo_tts_cache_key(const char *text)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = fnv1a(h, CONFIG_RIGO_TTS_URL);
+    h = fnv1a(h, "\n");
+    h = fnv1a(h, CONFIG_RIGO_TTS_VOICE);
+    h = fnv1a(h, "\n");
+    return fnv1a(h, text);
+}
+
+static uint32_t rec_span(uint32_t len)
+{
+    return (sizeof(rec_hdr_t) + len + SECTOR - 1) / SECTOR * SECTOR;
+}
+
+// ---- RAM tier (callers hold lock) ----
+
+static ram_entry_t *ram_find(uint64_t key)
+{
+    for (int i = 0; i < RAM_SLOTS; i++) {
+        if (ram[i].data && ram[i].key == key) return &ram[i];
+    }
+    return NULL;
+}
+
+static ram_entry_t *ram_lru(void)
+{
+    ram_entry_t *lru = NULL;
+    for (int i = 0; i < RAM_SLOTS; i++) {
+        ram_entry_t *e = &ram[i];
+        if (e->data && !e->pins && (!lru || e->last_use < lru->last_use)) lru = e;
+    }
+    return lru;
+}
+
+static void ram_drop(ram_entry_t *e)
+{
+    stats.ram_bytes -= e->len;
+    stats.evictions++;
+    heap_caps_free(e->data);
+    memset(e, 0, sizeof(*e));
+}
+
+// Takes ownership of data; frees it when no room can be made.
+static ram_entry_t *ram_insert(uint64_t key, uint8_t *data, int len, bool on_flash)
+{
+    ram_entry_t *slot = NULL;
+    while (1) {
+        if (!slot) {
+            for (int i = 0; i < RAM_SLOTS && !slot; i++) {
+                if (!ram[i].data) slot = &ram[i];
+            }
+        }
+        if (slot && stats.ram_bytes + len <= RAM_LIMIT) break;
+
+        ram_entry_t *victim = ram_lru();
+        if (!victim) {
+            heap_caps_free(data);
+            return NULL;
+        }
+        ram_drop(victim);
+    }
+    slot->key = key;
+    slot->data = data;
+    slot->len = len;
+    slot->last_use = ++use_clock;
+    slot->hits = 0;
+    slot->pins = 0;
+    slot->on_flash = on_flash;
+    stats.ram_bytes += len;
+    stats.inserts++;
+    return slot;
+}
+
+// ---- flash tier ----
+
+static int flash_find(uint64_t key)
+{
+    int best = -1;
+    for (int i = 0; i < flash_count; i++) {
+        if (flash_idx[i].key == key && (best < 0 || flash_idx[i].seq > flash_idx[best].seq)) best = i;
+    }
+    return best;
+}
+
+static void flash_forget(int i)
+{
+    flash_idx[i] = flash_idx[--flash_count];
+}
+
+static void flash_forget_range(uint32_t off, uint32_t span)
+{
+    for (int i = flash_count - 1; i >= 0; i--) {
+        const flash_entry_t *f = &flash_idx[i];
+        if (f->off < off + span && off < f->off + rec_span(f->len)) flash_forget(i);
+    }
+}
+
+static void flash_scan(void)
+{
+    rec_hdr_t h;
+    uint32_t off = 0;
+    while (off + SECTOR <= part->size && flash_count < flash_cap) {
+        if (esp_partition_read(part, off, &h, sizeof(h)) != ESP_OK) break;
+        if (h.magic != REC_MAGIC || h.len == 0 || h.len > part->size - off - sizeof(h)) {
+            off += SECTOR;
+            continue;
+        }
+        flash_idx[flash_count++] = (flash_entry_t){.key = h.key, .off = off, .len = h.len, .seq = h.seq};
+        off += rec_span(h.len);
+        if (h.seq >= flash_seq) {
+            flash_seq = h.seq;
+            flash_head = off;
+        }
+    }
+    if (flash_head >= part->size) flash_head = 0;
+}
+
+static ram_entry_t *flash_load(uint64_t key)
+{
+    int i = part ? flash_find(key) : -1;
+    if (i < 0) return NULL;
+
+    const flash_entry_t f = flash_idx[i];
+    rec_hdr_t h;
+    uint8_t *data = heap_caps_malloc(f.len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!data) return NULL;
+    if (esp_partition_read(part, f.off, &h, sizeof(h)) != ESP_OK ||
+        esp_partition_read(part, f.off + sizeof(h), data, f.len) != ESP_OK ||
+        esp_rom_crc32_le(0, data, f.len) != h.crc) {
+        ESP_LOGW(TAG, "Bad record at 0x%x, dropped", (unsigned)f.off);
+        flash_forget(i);
+        heap_caps_free(data);
+        return NULL;
+    }
+    return ram_insert(key, data, f.len, true);
+}
+
+static bool flash_write(uint64_t key, const uint8_t *data, int len)
+{
+    const uint32_t span = rec_span(len);
+    if (span > part->size) return false;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (flash_head + span > part->size) flash_head = 0;
+    const uint32_t off = flash_head;
+    flash_forget_range(off, span);
+    flash_head += span;
+    xSemaphoreGive(lock);
+
+    // data before header: an interrupted write leaves no valid magic behind
+    rec_hdr_t h = {
+        .magic = REC_MAGIC,
+        .seq = ++flash_seq,
+        .key = key,
+        .len = len,
+        .crc = esp_rom_crc32_le(0, data, len),
+    };
+    bool ok = esp_partition_erase_range(part, off, span) == ESP_OK &&
+              esp_partition_write(part, off + sizeof(h), data, len) == ESP_OK &&
+              esp_partition_write(part, off, &h, sizeof(h)) == ESP_OK;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (ok && flash_count < flash_cap) {
+        flash_idx[flash_count++] = (flash_entry_t){.key = key, .off = off, .len = len, .seq = h.seq};
+        stats.flash_writes++;
+    }
+    xSemaphoreGive(lock);
+    return ok;
+}
+
+// ---- API ----
+
+esp_err_t rigo_tts_cache_init(void)
+{
+    lock = xSemaphoreCreateMutex();
+    if (!lock) return ESP_ERR_NO_MEM;
+
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "ttscache");
+    if (!part) {
+        ESP_LOGW(TAG, "No ttscache partition, RAM tier only");
+        return ESP_OK;
+    }
+    flash_cap = part->size / SECTOR;
+    flash_idx = heap_caps_calloc(flash_cap, sizeof(flash_entry_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!flash_idx) {
+        part = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    flash_scan();
+    ESP_LOGI(TAG, "%d flash records, next write at 0x%x of 0x%x", flash_count, (unsigned)flash_head,
+             (unsigned)part->size);
+    return ESP_OK;
+}
+
+bool rigo_tts_cache_play(uint64_t key, StreamBufferHandle_t out)
+{
+    if (!lock) return false;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    ram_entry_t *e = ram_find(key);
+    const bool from_flash = !e;
+    if (!e) e = flash_load(key);
+    if (!e) {
+        stats.misses++;
+        xSemaphoreGive(lock);
+        return false;
+    }
+    if (from_flash) stats.flash_hits++;
+    else stats.ram_hits++;
+    e->pins++;
+    e->hits++;
+    e->last_use = ++use_clock;
+    xSemaphoreGive(lock);
+
+    ESP_LOGI(TAG, "Hit (%s), %d bytes", from_flash ? "flash" : "ram", e->len);
+    for (int off = 0; off < e->len; ) {
+        off += xStreamBufferSend(out, e->data + off, e->len - off, portMAX_DELAY);
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    e->pins--;
+    xSemaphoreGive(lock);
+    return true;
+}
+
+void rigo_tts_cache_put(uint64_t key, const uint8_t *data, int len)
+{
+    if (!lock || len <= 0 || len > ENTRY_LIMIT) return;
+    uint8_t *copy = heap_caps_malloc(len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!copy) return;
+    memcpy(copy, data, len);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (ram_find(key)) {
+        heap_caps_free(copy);
+    } else {
+        ram_insert(key, copy, len, part && flash_find(key) >= 0);
+    }
+    xSemaphoreGive(lock);
+}
+
+void rigo_tts_cache_persist(void)
+{
+    if (!lock || !part) return;
+
+    while (1) {
+        // one entry at a time so playback never waits on a flash erase
+        xSemaphoreTake(lock, portMAX_DELAY);
+        ram_entry_t *e = NULL;
+        for (int i = 0; i < RAM_SLOTS && !e; i++) {
+            if (ram[i].data && !ram[i].on_flash && ram[i].hits > 0) e = &ram[i];
+        }
+        if (e) e->pins++;
+        xSemaphoreGive(lock);
+        if (!e) return;
+
+        bool ok = flash_write(e->key, e->data, e->len);
+        ESP_LOGI(TAG, "Persisted %d bytes%s", e->len, ok ? "" : " FAILED");
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        e->on_flash = true;     // a failed write is not retried every turn
+        e->pins--;
+        xSemaphoreGive(lock);
+    }
+}
+
+void rigo_tts_cache_get_stats(rigo_tts_cache_stats_t *out)
+{
+    if (lock) xSemaphoreTake(lock, portMAX_DELAY);
+    *out = stats;
+    out->flash_records = flash_count;
+    if (lock) xSemaphoreGive(lock);
+}
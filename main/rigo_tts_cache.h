@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/stream_buffer.h"
+
+// TTS phrase cache. Audio for a segment is keyed by a 64-bit FNV-1a hash of
+// the TTS URL, voice and text. Hot entries live in a PSRAM LRU; entries that
+// are requested again are persisted to the "ttscache" flash partition (a
+// circular log, oldest records are overwritten first) between turns.
+
+typedef struct {
+    uint32_t ram_hits;
+    uint32_t flash_hits;
+    uint32_t misses;
+    uint32_t inserts;
+    uint32_t evictions;
+    uint32_t flash_writes;
+    uint32_t flash_records;
+    uint32_t ram_bytes;
+} rigo_tts_cache_stats_t;
+
+esp_err_t rigo_tts_cache_init(void);
+
+uint64_t rigo_tts_cache_key(const char *text);
+
+// On a hit the cached WAV bytes are sent to `out` (blocking while it is full)
+// and true is returned.
+bool rigo_tts_cache_play(uint64_t key, StreamBufferHandle_t out);
+
+// Store a complete WAV reply; ignored when larger than the entry limit.
+void rigo_tts_cache_put(uint64_t key, const uint8_t *data, int len);
+
+// Write repeated phrases to flash. Call outside playback: flash erase stalls
+// the caches of both cores.
+void rigo_tts_cache_persist(void);
+
+void rigo_tts_cache_get_stats(rigo_tts_cache_stats_t *out);
@@ -0,0 +1,341 @@
+#include "rigo_tts_pipe.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+
+#include "rigo_arena.h"
+#include "rigo_conn.h"
+#include "rigo_metrics.h"
+#include "rigo_player.h"
+#include "rigo_respbuf.h"
+#include "rigo_tasks.h"
+#include "rigo_text.h"
+#include "rigo_tts_cache.h"
+
+static const char *TAG = "rigo_tts";
+
+#define LANES 2
+#define SEG_QUEUE_LEN 16
+#define CHUNK 1024
+
+typedef struct {
+    const char *name;
+    rigo_ep_t ep;
+    TaskHandle_t task;
+    QueueHandle_t job;
+    StreamBufferHandle_t buf;
+    rigo_respbuf_t err;
+    uint8_t *rec;       // reply copy for the phrase cache
+    int rec_len;
+    bool first;         // first segment of the reply
+    uint32_t turn;      // rigo_metrics turn of the reply
+    int64_t deadline_us;    // response must start by then (0: endpoint timeout)
+    volatile bool done;
+    volatile bool ok;
+} tts_lane_t;
+
+static tts_lane_t lanes[LANES] = {
+    {.name = "tts-a", .ep = RIGO_EP_TTS, .err = RIGO_RESPBUF_INIT("tts-a")},
+    {.name = "tts-b", .ep = RIGO_EP_TTS_ALT, .err = RIGO_RESPBUF_INIT("tts-b")},
+};
+
+static QueueHandle_t seg_q;
+static SemaphoreHandle_t idle_sem;
+static TaskHandle_t pipe_task;
+static atomic_bool cancelled;
+static int64_t first_deadline;     // for the reply's first segment, from the turn budget
+static uint32_t reply_turn;
+
+// text not yet cut into a segment (streamed replies arrive token by token)
+#define ACC_CAP (2 * CONFIG_RIGO_TTS_SEGMENT_MAX_CHARS)
+#if CONFIG_RIGO_TTS_ACCEPT_ADPCM
+// PCM stays acceptable; the player decodes whichever WAV format comes back
+#define TTS_ACCEPT "audio/vnd.wave; codec=11, audio/wav;q=0.5"
+#else
+#define TTS_ACCEPT "audio/wav"
+#endif
+
+static char *acc;
+static int acc_len;
+
+static void lane_record(tts_lane_t *l, const uint8_t *data, int len)
+{
+    if (!l->rec || l->rec_len < 0) return;
+    if (l->rec_len + len > CONFIG_RIGO_TTS_CACHE_ENTRY_KB * 1024) {
+        l->rec_len = -1;    // too long to cache
+        return;
+    }
+    memcpy(l->rec + l->rec_len, data, len);
+    l->rec_len += len;
+}
+
+static bool lane_fetch(tts_lane_t *l, const char *text, uint8_t *chunk)
+{
+#if CONFIG_RIGO_TTS_CACHE_ENABLE
+    const uint64_t key = rigo_tts_cache_key(text);
+    if (rigo_tts_cache_play(key, l->buf)) {
+        if (l->first) rigo_metrics_mark(l->turn, RIGO_MARK_TTS_FIRST_BYTE);
+        return true;
+    }
+#endif
+
+    // the arena spills to the heap, which can be exhausted too: drop the segment, not the device
+    cJSON *req = cJSON_CreateObject();
+    bool built = req && cJSON_AddStringToObject(req, "text", text);
+    if (built && CONFIG_RIGO_TTS_VOICE[0]) built = cJSON_AddStringToObject(req, "voice", CONFIG_RIGO_TTS_VOICE);
+    char *body = built ? cJSON_PrintUnformatted(req) : NULL;
+    cJSON_Delete(req);
+    if (!body) {
+        ESP_LOGE(TAG, "%s: no memory for the request body", l->name);
+        return false;
+    }
+
+    esp_http_client_handle_t c = rigo_conn_request(l->ep, "application/json", TTS_ACCEPT, body, strlen(body));
+    cJSON_free(body);
+    if (!c) return false;
+    if (l->first) rigo_metrics_mark(l->turn, RIGO_MARK_TTS_FIRST_BYTE);
+
+    int status = esp_http_client_get_status_code(c);
+    if (status >= 300) {
+        bool drained = rigo_respbuf_read_http(&l->err, c);
+        ESP_LOGE(TAG, "%s: HTTP %d: %.*s", l->name, status, (int)MIN(l->err.len, 256),
+                 l->err.data ? (char *)l->err.data : "");
+        rigo_conn_release(l->ep, drained);
+        return false;
+    }
+
+    bool ok = true;
+    l->rec_len = 0;
+    while (1) {
+        if (atomic_load(&cancelled)) {
+            ok = false;     // the rest of the body is unread; the connection is not reusable
+            break;
+        }
+        int rd = esp_http_client_read(c, (char *)chunk, CHUNK);
+        if (rd < 0) ok = false;
+        if (rd <= 0) break;
+        lane_record(l, chunk, rd);
+        // blocks while the segment is ahead of playback; TCP holds the rest
+        for (int off = 0; off < rd; ) {
+            off += xStreamBufferSend(l->buf, chunk + off, rd - off, portMAX_DELAY);
+        }
+    }
+    rigo_conn_release(l->ep, ok);
+#if CONFIG_RIGO_TTS_CACHE_ENABLE
+    if (ok && l->rec_len > 0) rigo_tts_cache_put(key, l->rec, l->rec_len);
+#endif
+    return ok;
+}
+
+static void lane_task_fn(void *arg)
+{
+    tts_lane_t *l = (tts_lane_t *)arg;
+    uint8_t *chunk = heap_caps_malloc(CHUNK, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+
+    while (1) {
+        char *text = NULL;
+        xQueueReceive(l->job, &text, portMAX_DELAY);
+        int64_t t0 = esp_timer_get_time();
+        // the request body goes to the arena of the turn the text came from
+        rigo_arena_enter(rigo_arena_of(text));
+        rigo_conn_deadline_enter(l->deadline_us);
+        l->ok = lane_fetch(l, text, chunk);
+#if CONFIG_RIGO_TTS_CACHE_ENABLE
+        if (!l->ok && l->deadline_us && esp_timer_get_time() >= l->deadline_us && !atomic_load(&cancelled)) {
+            // too late for the first words: say the cached fallback instead of nothing
+            l->ok = rigo_tts_cache_play(rigo_tts_cache_key(CONFIG_RIGO_FALLBACK_TEXT), l->buf);
+        }
+#endif
+        rigo_conn_deadline_enter(0);
+        rigo_arena_enter(NULL);
+        ESP_LOGD(TAG, "%s: segment fetched in %d ms", l->name, (int)((esp_timer_get_time() - t0) / 1000));
+        rigo_arena_free(text);
+        l->done = true;
+    }
+}
+
+static void lane_submit(tts_lane_t *l, char *text, bool first)
+{
+    xStreamBufferReset(l->buf);
+    l->first = first;
+    l->turn = reply_turn;
+    l->deadline_us = first ? first_deadline : 0;
+    l->done = false;
+    l->ok = false;
+    xQueueSend(l->job, &text, portMAX_DELAY);
+}
+
+// Take the next pushed segment if a lane is free. NULL from the queue closes the input.
+static bool take_segment(int *submitted, int played, bool *more, TickType_t wait)
+{
+    if (!*more || *submitted - played >= LANES) return false;
+    char *text = NULL;
+    if (xQueueReceive(seg_q, &text, wait) != pdTRUE) return false;
+    if (!text) {
+        *more = false;
+        return false;
+    }
+    if (atomic_load(&cancelled)) {
+        rigo_arena_free(text);     // pushed before the cancel reached the producer
+        return true;
+    }
+    lane_submit(&lanes[*submitted % LANES], text, *submitted == 0);
+    (*submitted)++;
+    return true;
+}
+
+static void pipe_task_fn(void *arg)
+{
+    (void)arg;
+    uint8_t *chunk = heap_caps_malloc(CHUNK, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        rigo_player_begin(reply_turn);
+
+        int submitted = 0, played = 0;
+        bool more = true;
+        while (1) {
+            while (take_segment(&submitted, played, &more, submitted == played ? portMAX_DELAY : 0)) {
+            }
+            if (submitted == played) break;
+
+            tts_lane_t *l = &lanes[played % LANES];
+            rigo_player_segment();
+            while (1) {
+                size_t rd = xStreamBufferReceive(l->buf, chunk, CHUNK, pdMS_TO_TICKS(20));
+                if (rd > 0) {
+                    rigo_player_feed(chunk, rd);
+                } else if (l->done && xStreamBufferBytesAvailable(l->buf) == 0) {
+                    break;
+                }
+                // start the next segment's request as soon as its text exists
+                take_segment(&submitted, played, &more, 0);
+            }
+            // the player discards a cancelled lane's bytes, so this only waits for the lane to stop
+            if (!l->ok && !atomic_load(&cancelled)) ESP_LOGW(TAG, "Segment %d failed, skipped", played);
+            played++;
+        }
+
+        rigo_player_end();
+        xSemaphoreGive(idle_sem);
+#if CONFIG_RIGO_TTS_CACHE_ENABLE
+        rigo_tts_cache_persist();
+#endif
+    }
+}
+
+esp_err_t rigo_tts_pipe_init(void)
+{
+    seg_q = xQueueCreate(SEG_QUEUE_LEN, sizeof(char *));
+    idle_sem = xSemaphoreCreateBinary();
+    acc = heap_caps_malloc(ACC_CAP, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!seg_q || !idle_sem || !acc) return ESP_ERR_NO_MEM;
+
+    for (int i = 0; i < LANES; i++) {
+        tts_lane_t *l = &lanes[i];
+        l->job = xQueueCreate(1, sizeof(char *));
+        l->buf = xStreamBufferCreateWithCaps(CONFIG_RIGO_TTS_LANE_KB * 1024, 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!l->job || !l->buf) return ESP_ERR_NO_MEM;
+#if CONFIG_RIGO_TTS_CACHE_ENABLE
+        l->rec = heap_caps_malloc(CONFIG_RIGO_TTS_CACHE_ENTRY_KB * 1024, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+        if (xTaskCreatePinnedToCore(lane_task_fn, l->name, 8 * 1024, l, CONFIG_RIGO_TASK_TTS_PRIO, &l->task,
+                                    RIGO_TASK_CORE(CONFIG_RIGO_TASK_TTS_CORE)) != pdPASS) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (xTaskCreatePinnedToCore(pipe_task_fn, "tts_pipe", 4 * 1024, NULL, CONFIG_RIGO_TASK_PLAYER_PRIO - 1, &pipe_task,
+                                RIGO_TASK_CORE(CONFIG_RIGO_TASK_PLAYER_CORE)) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void rigo_tts_pipe_begin(uint32_t turn)
+{
+    acc_len = 0;
+    reply_turn = turn;
+    first_deadline = rigo_conn_deadline();
+    xTaskNotifyGive(pipe_task);
+}
+
+void rigo_tts_pipe_push(const char *text, int len)
+{
+    if (atomic_load(&cancelled)) return;
+    text = rigo_text_trim(text, &len);
+    if (len <= 0) return;
+    char *copy = rigo_arena_strndup(text, len);
+    if (!copy) return;
+    ESP_LOGI(TAG, "Segment: %s", copy);
+    xQueueSend(seg_q, &copy, portMAX_DELAY);
+}
+
+static void flush_segments(bool final)
+{
+    int off = 0;
+    while (off < acc_len) {
+        int n = rigo_text_segment(acc + off, acc_len - off, final,
+                                  CONFIG_RIGO_TTS_SEGMENT_MIN_CHARS, CONFIG_RIGO_TTS_SEGMENT_MAX_CHARS);
+        if (n <= 0) {
+            if (!final) break;
+            n = acc_len - off;
+        }
+        rigo_tts_pipe_push(acc + off, n);
+        off += n;
+    }
+    memmove(acc, acc + off, acc_len - off);
+    acc_len -= off;
+}
+
+void rigo_tts_pipe_push_text(const char *text, int len)
+{
+    while (len > 0) {
+        int n = MIN(len, ACC_CAP - acc_len);
+        memcpy(acc + acc_len, text, n);
+        acc_len += n;
+        text += n;
+        len -= n;
+        flush_segments(false);
+    }
+}
+
+void rigo_tts_pipe_finish(void)
+{
+    flush_segments(true);
+    char *end = NULL;
+    xQueueSend(seg_q, &end, portMAX_DELAY);
+    xSemaphoreTake(idle_sem, portMAX_DELAY);
+}
+
+void rigo_tts_pipe_speak(uint32_t turn, const char *text)
+{
+    if (!text || !rigo_conn_configured(RIGO_EP_TTS) || atomic_load(&cancelled)) return;
+
+    rigo_tts_pipe_begin(turn);
+    rigo_tts_pipe_push_text(text, strlen(text));
+    rigo_tts_pipe_finish();
+}
+
+void rigo_tts_pipe_cancel(void)
+{
+    atomic_store(&cancelled, true);
+    rigo_player_stop();
+}
+
+void rigo_tts_pipe_rearm(void)
+{
+    atomic_store(&cancelled, false);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// Sentence-pipelined TTS: segments are synthesized on two fetch lanes (two
+// keep-alive TTS connections) so segment N+1 downloads while N plays, and
+// all segments go gaplessly through the one player session.
+esp_err_t rigo_tts_pipe_init(void);
+
+// Streaming use: begin, push text as it becomes available, finish. `turn` is
+// the rigo_metrics turn the reply's TTS and playback marks go to.
+void rigo_tts_pipe_begin(uint32_t turn);
+// Queue one segment as is.
+void rigo_tts_pipe_push(const char *text, int len);
+// Append reply text of any granularity (e.g. LLM token deltas); every
+// completed sentence is queued for synthesis immediately.
+void rigo_tts_pipe_push_text(const char *text, int len);
+// Flush the unfinished tail, close the input and block until everything
+// pushed has been played.
+void rigo_tts_pipe_finish(void);
+
+// Whole reply known up front: split into sentences and play it.
+void rigo_tts_pipe_speak(uint32_t turn, const char *text);
+
+// Barge-in, from any task: stop the player, abandon running fetches and drop
+// every segment pushed until rearmed. The reply's owner still calls finish,
+// which then returns as soon as the lanes are idle.
+void rigo_tts_pipe_cancel(void);
+// Accept segments again; called before the next reply starts.
+void rigo_tts_pipe_rearm(void);
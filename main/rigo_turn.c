@@ -0,0 +1,203 @@
+#include "rigo_turn.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "rigo_arena.h"
+#include "rigo_cloud.h"
+#include "rigo_conn.h"
+#include "rigo_metrics.h"
+#include "rigo_tts_pipe.h"
+#include "rigo_vad.h"
+
+static const char *TAG = "rigo_turn";
+
+#if !CONFIG_RIGO_STT_STREAM_UPLOAD
+#define CAPT_BYTES ((CONFIG_RIGO_CAPTURE_MS + CONFIG_RIGO_MIC_PREROLL_MS) * 16 * 2)
+static int16_t *capt;
+#endif
+
+static void mic_read(const rigo_turn_io_t *io, int16_t *dst, int bytes)
+{
+    int n = bytes / sizeof(int16_t);
+    int got = rigo_mic_read(io->mic, dst, n, pdMS_TO_TICKS(500));
+    // a stalled mic still advances the VAD clock
+    if (got < n) memset(dst + got, 0, (n - got) * sizeof(int16_t));
+}
+
+#if !CONFIG_RIGO_ASSISTANT_JSON
+static void assistant_text(const char *text, int len, void *ctx)
+{
+    (void)ctx;
+    rigo_tts_pipe_push_text(text, len);
+}
+#endif
+
+static void budget_start(rigo_turn_budget_t *b)
+{
+    const int64_t now = esp_timer_get_time(), total = (int64_t)CONFIG_RIGO_TURN_BUDGET_MS * 1000;
+    // absolute points, so time a stage does not use carries over to the next
+    b->stt_us = now + total * CONFIG_RIGO_BUDGET_STT_PCT / 100;
+    b->end_us = now + total;
+    b->assistant_us = MAX(b->stt_us, b->end_us - total * CONFIG_RIGO_BUDGET_TTS_PCT / 100);
+    b->late = false;
+}
+
+// Nothing usable by the stage deadline: answer locally rather than let the
+// next stage start on an already spent budget.
+static char *fallback(rigo_turn_budget_t *b, const char *stage)
+{
+    ESP_LOGW(TAG, "%s missed its deadline (%d ms turn budget), replying locally", stage, CONFIG_RIGO_TURN_BUDGET_MS);
+    b->late = true;
+    return rigo_arena_strdup(CONFIG_RIGO_FALLBACK_TEXT);
+}
+
+char *rigo_turn_listen(const rigo_turn_io_t *io, uint32_t turn, rigo_turn_budget_t *budget)
+{
+#if !CONFIG_RIGO_STT_STREAM_UPLOAD
+    if (!capt) capt = heap_caps_malloc(CAPT_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!capt) return NULL;
+#endif
+    // connect the next hops while the user is still talking
+    rigo_conn_prewarm(RIGO_EP_BIT(RIGO_EP_ASSISTANT) | RIGO_EP_BIT(RIGO_EP_TTS) | RIGO_EP_BIT(RIGO_EP_TTS_ALT)
+#if !CONFIG_RIGO_STT_STREAM_UPLOAD
+                      | RIGO_EP_BIT(RIGO_EP_STT)
+#endif
+                     );
+
+#if CONFIG_RIGO_STT_STREAM_UPLOAD
+    rigo_stt_upload_t up;
+    if (!rigo_cloud_stt_begin(&up, turn, -1)) {
+        ESP_LOGW(TAG, "STT upload not started, capture will be dropped");
+    }
+#endif
+
+#if CONFIG_RIGO_VAD_ENABLE
+    rigo_vad_config_t vad_cfg = {
+        .sample_rate = 16000,
+        .silence_ms = CONFIG_RIGO_VAD_SILENCE_MS,
+        .no_speech_ms = CONFIG_RIGO_VAD_NO_SPEECH_MS,
+        .max_ms = CONFIG_RIGO_CAPTURE_MS,
+        .min_speech_ms = CONFIG_RIGO_VAD_MIN_SPEECH_MS,
+        .ratio_pct = CONFIG_RIGO_VAD_RATIO_PCT,
+        .min_rms = CONFIG_RIGO_VAD_MIN_RMS,
+        .max_zcr_pct = CONFIG_RIGO_VAD_MAX_ZCR_PCT,
+    };
+    rigo_vad_t vad;
+    rigo_vad_init(&vad, &vad_cfg);
+    rigo_vad_state_t vst = RIGO_VAD_WAITING;
+#endif
+
+    // Pre-roll (speech that started while WakeNet was still deciding) goes to
+    // STT but not to the VAD, whose noise floor is seeded by its first frame.
+    const int pre_bytes = rigo_mic_rewind(io->mic, CONFIG_RIGO_MIC_PREROLL_MS) * sizeof(int16_t);
+    const int max_bytes = pre_bytes + CONFIG_RIGO_CAPTURE_MS * 16 * 2;
+    int cap_bytes = 0;
+    while (cap_bytes < max_bytes) {
+        int rd = io->frame_samples * sizeof(int16_t);
+        if (cap_bytes < pre_bytes) rd = MIN(rd, pre_bytes - cap_bytes);
+        if (cap_bytes + rd > max_bytes) rd = max_bytes - cap_bytes;
+#if CONFIG_RIGO_STT_STREAM_UPLOAD
+        int16_t *frame = io->frame;
+        mic_read(io, frame, rd);
+        rigo_cloud_stt_write(&up, frame, rd);
+#else
+        int16_t *frame = (int16_t *)(((uint8_t *)capt) + cap_bytes);
+        mic_read(io, frame, rd);
+#endif
+        cap_bytes += rd;
+        if (cap_bytes <= pre_bytes) continue;
+        if (io->handled && io->handled()) break;
+#if CONFIG_RIGO_STT_STREAM_UPLOAD
+        // a streaming recognizer may call the end of the utterance before the VAD does
+        if (rigo_cloud_stt_final(&up)) break;
+#endif
+#if CONFIG_RIGO_VAD_ENABLE
+        vst = rigo_vad_feed(&vad, frame, rd / sizeof(int16_t));
+        if (vst >= RIGO_VAD_END) break;
+#else
+        (void)frame;
+#endif
+    }
+
+    rigo_metrics_mark(turn, RIGO_MARK_CAPTURE_END);
+    budget_start(budget);
+    if (io->handled && io->handled()) {
+        ESP_LOGI(TAG, "Capture %d ms, handled on the device", (cap_bytes - pre_bytes) / 32);
+#if CONFIG_RIGO_STT_STREAM_UPLOAD
+        rigo_cloud_stt_abort(&up);
+#endif
+        return NULL;
+    }
+    if (io->on_captured) io->on_captured();
+#if CONFIG_RIGO_VAD_ENABLE
+    ESP_LOGI(TAG, "Capture %d ms + %d ms pre-roll (speech %d ms, %s)", (cap_bytes - pre_bytes) / 32,
+             pre_bytes / 32, vad.speech_ms, rigo_vad_state_str(vst));
+    if (vst == RIGO_VAD_NO_SPEECH) {
+#if CONFIG_RIGO_STT_STREAM_UPLOAD
+        rigo_cloud_stt_abort(&up);
+#endif
+        return NULL;
+    }
+#else
+    ESP_LOGI(TAG, "Capture %d ms + %d ms pre-roll", (cap_bytes - pre_bytes) / 32, pre_bytes / 32);
+#endif
+    const int64_t prev = rigo_conn_deadline_enter(budget->stt_us);
+#if CONFIG_RIGO_STT_STREAM_UPLOAD
+    char *text = rigo_cloud_stt_finish(&up);
+#else
+    char *text = rigo_cloud_stt(turn, capt, cap_bytes);
+#endif
+    rigo_conn_deadline_enter(prev);
+    ESP_LOGI(TAG, "STT: %s", text ? text : "(null)");
+    if (!text && esp_timer_get_time() >= budget->stt_us) return fallback(budget, "STT");
+    if (!text || strlen(text) == 0) {
+        rigo_arena_free(text);
+        return NULL;
+    }
+    return text;
+}
+
+void rigo_turn_reply(uint32_t turn, char *text, rigo_turn_budget_t *budget)
+{
+    int64_t prev = rigo_conn_deadline_enter(budget->assistant_us);
+#if CONFIG_RIGO_ASSISTANT_JSON
+    char *reply = rigo_cloud_assistant(text);
+    rigo_arena_free(text);
+    rigo_metrics_mark(turn, RIGO_MARK_ASSISTANT_DONE);
+    ESP_LOGI(TAG, "Assistant: %s", reply ? reply : "(null)");
+    if (!reply && esp_timer_get_time() >= budget->assistant_us) reply = fallback(budget, "Assistant");
+    if (!reply || strlen(reply) == 0) {
+        rigo_arena_free(reply);
+        rigo_conn_deadline_enter(prev);
+        return;
+    }
+
+    // the pipe takes the first segment's deadline from here
+    rigo_conn_deadline_enter(budget->end_us);
+    rigo_tts_pipe_speak(turn, reply);
+    rigo_arena_free(reply);
+#else
+    // sentences go to TTS while the assistant is still generating
+    rigo_conn_deadline_enter(budget->end_us);
+    rigo_tts_pipe_begin(turn);
+    rigo_conn_deadline_enter(budget->assistant_us);
+    char *reply = rigo_cloud_assistant_stream(text, assistant_text, NULL);
+    rigo_arena_free(text);
+    rigo_metrics_mark(turn, RIGO_MARK_ASSISTANT_DONE);
+    ESP_LOGI(TAG, "Assistant: %s", reply ? reply : "(null)");
+    if (!reply && esp_timer_get_time() >= budget->assistant_us) {
+        char *say = fallback(budget, "Assistant");
+        if (say) rigo_tts_pipe_push(say, strlen(say));
+        rigo_arena_free(say);
+    }
+    rigo_tts_pipe_finish();
+    rigo_arena_free(reply);
+#endif
+    rigo_conn_deadline_enter(prev);
+}
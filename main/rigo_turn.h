@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "rigo_mic.h"
+
+typedef struct {
+    rigo_mic_reader_t *mic;         // cursor at the wake detection point
+    int16_t *frame;                 // scratch for one mic read
+    int frame_samples;
+    void (*on_captured)(void);      // capture window closed, cloud work starts
+    bool (*handled)(void);          // optional: true once the turn was answered on the device
+} rigo_turn_io_t;
+
+// Stage deadlines of one turn in esp_timer microseconds, cut from
+// CONFIG_RIGO_TURN_BUDGET_MS when capture ends.
+typedef struct {
+    int64_t stt_us;         // transcript response starts
+    int64_t assistant_us;   // reply response starts
+    int64_t end_us;         // first TTS segment starts
+    bool late;              // a stage missed its deadline; the text is CONFIG_RIGO_FALLBACK_TEXT
+} rigo_turn_budget_t;
+
+// The two halves of a conversational turn after the wake word, run by the
+// uplink and assistant stages of rigo_pipeline. `turn` is the rigo_metrics
+// turn the stage marks go to.
+
+// Capture (VAD endpointed) and STT. Capture starts CONFIG_RIGO_MIC_PREROLL_MS
+// before the cursor. Returns the transcript (caller frees with
+// rigo_arena_free), or NULL when there is nothing to answer or io->handled
+// turned true. When STT misses its deadline the fallback reply is returned
+// instead, with budget->late set.
+char *rigo_turn_listen(const rigo_turn_io_t *io, uint32_t turn, rigo_turn_budget_t *budget);
+
+// Assistant and the spoken reply; takes ownership of `text`. The fallback is
+// spoken if the assistant misses its deadline. Returns once playback has
+// finished.
+void rigo_turn_reply(uint32_t turn, char *text, rigo_turn_budget_t *budget);
@@ -0,0 +1,89 @@
+#include "rigo_vad.h"
+
+#include <string.h>
+
+static uint32_t isqrt32(uint32_t x)
+{
+    uint32_t r = 0, bit = 1u << 30;
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+void rigo_vad_init(rigo_vad_t *v, const rigo_vad_config_t *cfg)
+{
+    memset(v, 0, sizeof(*v));
+    v->cfg = *cfg;
+    v->state = RIGO_VAD_WAITING;
+}
+
+rigo_vad_state_t rigo_vad_feed(rigo_vad_t *v, const int16_t *pcm, int samples)
+{
+    if (samples <= 0 || v->state >= RIGO_VAD_END) return v->state;
+
+    uint64_t acc = 0;
+    int zc = 0;
+    for (int i = 0; i < samples; i++) {
+        int32_t s = pcm[i];
+        acc += (uint64_t)(s * s);
+        if (i > 0 && ((pcm[i - 1] ^ pcm[i]) < 0)) zc++;
+    }
+    uint32_t rms = isqrt32((uint32_t)(acc / samples));
+    int zcr_pct = zc * 100 / samples;
+    int frame_ms = samples * 1000 / v->cfg.sample_rate;
+    v->elapsed_ms += frame_ms;
+
+    // the first frame seeds the floor; the user rarely speaks within ~30 ms of the wake word
+    if (v->noise_rms == 0) v->noise_rms = rms > 0 ? rms : 1;
+
+    uint32_t thresh = v->noise_rms * (uint32_t)v->cfg.ratio_pct / 100;
+    if (thresh < (uint32_t)v->cfg.min_rms) thresh = v->cfg.min_rms;
+    bool speech = rms > thresh;
+    if (speech && zcr_pct > v->cfg.max_zcr_pct && rms < thresh * 2) speech = false;
+
+    if (speech) {
+        v->run_speech_ms += frame_ms;
+        v->silence_run_ms = 0;
+        if (v->state == RIGO_VAD_SPEECH) {
+            v->speech_ms += frame_ms;
+        } else if (v->run_speech_ms >= v->cfg.min_speech_ms) {
+            v->state = RIGO_VAD_SPEECH;
+            v->speech_ms = v->run_speech_ms;
+        }
+    } else {
+        v->run_speech_ms = 0;
+        v->silence_run_ms += frame_ms;
+        // only adapt on non-speech frames, slowly, so the floor follows fans/hum but not the talker
+        v->noise_rms = (v->noise_rms * 15 + rms) / 16;
+        if (v->noise_rms == 0) v->noise_rms = 1;
+    }
+
+    if (v->state == RIGO_VAD_SPEECH && v->silence_run_ms >= v->cfg.silence_ms) {
+        v->state = RIGO_VAD_END;
+    } else if (v->state == RIGO_VAD_WAITING && v->elapsed_ms >= v->cfg.no_speech_ms) {
+        v->state = RIGO_VAD_NO_SPEECH;
+    } else if (v->elapsed_ms >= v->cfg.max_ms) {
+        v->state = RIGO_VAD_MAX;
+    }
+    return v->state;
+}
+
+const char *rigo_vad_state_str(rigo_vad_state_t s)
+{
+    switch (s) {
+        case RIGO_VAD_WAITING: return "waiting";
+        case RIGO_VAD_SPEECH: return "speech";
+        case RIGO_VAD_END: return "end-of-speech";
+        case RIGO_VAD_NO_SPEECH: return "no-speech";
+        case RIGO_VAD_MAX: return "max";
+        default: return "?";
+    }
+}
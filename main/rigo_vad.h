@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    RIGO_VAD_WAITING = 0,   // no speech yet
+    RIGO_VAD_SPEECH,        // speech in progress (or within trailing silence)
+    RIGO_VAD_END,           // trailing silence reached after speech
+    RIGO_VAD_NO_SPEECH,     // nothing said before the start timeout
+    RIGO_VAD_MAX,           // hard capture cap reached
+} rigo_vad_state_t;
+
+typedef struct {
+    int sample_rate;
+    int silence_ms;         // trailing silence that ends an utterance
+    int no_speech_ms;       // give up if speech never starts
+    int max_ms;             // hard cap on the capture length
+    int min_speech_ms;      // speech shorter than this is treated as a click
+    int ratio_pct;          // frame RMS must exceed noise floor by this percentage
+    int min_rms;            // absolute RMS floor for speech
+    int max_zcr_pct;        // zero-crossing rate above which quiet frames count as noise
+} rigo_vad_config_t;
+
+typedef struct {
+    rigo_vad_config_t cfg;
+    rigo_vad_state_t state;
+    uint32_t noise_rms;
+    int elapsed_ms;
+    int speech_ms;
+    int run_speech_ms;
+    int silence_run_ms;
+} rigo_vad_t;
+
+void rigo_vad_init(rigo_vad_t *v, const rigo_vad_config_t *cfg);
+
+// Feed one frame of mono PCM16; returns the state after the frame.
+rigo_vad_state_t rigo_vad_feed(rigo_vad_t *v, const int16_t *pcm, int samples);
+
+const char *rigo_vad_state_str(rigo_vad_state_t s);
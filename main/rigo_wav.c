@@ -0,0 +1,173 @@
+#include "rigo_wav.h"
+
+#include <string.h>
+
+#include "rigo_adpcm.h"
+
+static int imin(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+static uint16_t rd16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void rigo_wav_build_header(uint8_t *hdr, int bytes, int sample_rate, int channels)
+{
+    const uint32_t data_len = bytes < 0 ? 0xFFFFFFFFu : (uint32_t)bytes;
+    const uint32_t riff_len = bytes < 0 ? 0xFFFFFFFFu : data_len + 36;
+
+    memcpy(hdr, "RIFF", 4);
+    *(uint32_t *)(hdr + 4) = riff_len;
+    memcpy(hdr + 8, "WAVEfmt ", 8);
+    *(uint32_t *)(hdr + 16) = 16;
+    *(uint16_t *)(hdr + 20) = RIGO_WAV_FMT_PCM;
+    *(uint16_t *)(hdr + 22) = channels;
+    *(uint32_t *)(hdr + 24) = sample_rate;
+    *(uint32_t *)(hdr + 28) = sample_rate * channels * 2;
+    *(uint16_t *)(hdr + 32) = channels * 2;
+    *(uint16_t *)(hdr + 34) = 16;
+    memcpy(hdr + 36, "data", 4);
+    *(uint32_t *)(hdr + 40) = data_len;
+}
+
+void rigo_wav_build_adpcm_header(uint8_t *hdr, int samples, int sample_rate)
+{
+    const int blocks = samples < 0 ? 0 : rigo_adpcm_encoded_bytes(samples) / RIGO_ADPCM_BLOCK_ALIGN;
+    const uint32_t data_len = samples < 0 ? 0xFFFFFFFFu : (uint32_t)blocks * RIGO_ADPCM_BLOCK_ALIGN;
+    const uint32_t riff_len = samples < 0 ? 0xFFFFFFFFu : data_len + RIGO_WAV_ADPCM_HDR_LEN - 8;
+
+    memcpy(hdr, "RIFF", 4);
+    *(uint32_t *)(hdr + 4) = riff_len;
+    memcpy(hdr + 8, "WAVEfmt ", 8);
+    *(uint32_t *)(hdr + 16) = 20;
+    *(uint16_t *)(hdr + 20) = RIGO_WAV_FMT_IMA_ADPCM;
+    *(uint16_t *)(hdr + 22) = 1;
+    *(uint32_t *)(hdr + 24) = sample_rate;
+    *(uint32_t *)(hdr + 28) = sample_rate * RIGO_ADPCM_BLOCK_ALIGN / RIGO_ADPCM_BLOCK_SAMPLES;
+    *(uint16_t *)(hdr + 32) = RIGO_ADPCM_BLOCK_ALIGN;
+    *(uint16_t *)(hdr + 34) = 4;
+    *(uint16_t *)(hdr + 36) = 2;
+    *(uint16_t *)(hdr + 38) = RIGO_ADPCM_BLOCK_SAMPLES;
+    memcpy(hdr + 40, "fact", 4);
+    *(uint32_t *)(hdr + 44) = 4;
+    *(uint32_t *)(hdr + 48) = samples < 0 ? 0xFFFFFFFFu : (uint32_t)samples;
+    memcpy(hdr + 52, "data", 4);
+    *(uint32_t *)(hdr + 56) = data_len;
+}
+
+void rigo_wav_parser_init(rigo_wav_parser_t *p)
+{
+    memset(p, 0, sizeof(*p));
+    p->state = RIGO_WAV_RIFF;
+    p->need = 12;
+}
+
+static void expect(rigo_wav_parser_t *p, rigo_wav_state_t st, int need)
+{
+    p->state = st;
+    p->need = need;
+    p->hdr_len = 0;
+}
+
+static void on_chunk_header(rigo_wav_parser_t *p)
+{
+    uint32_t size = rd32(p->hdr + 4);
+
+    if (memcmp(p->hdr, "data", 4) == 0) {
+        if (!p->have_fmt) {
+            p->state = RIGO_WAV_ERROR;
+            return;
+        }
+        // streaming TTS servers send 0 or 0xFFFFFFFF when the length is not known yet
+        p->data_unbounded = size == 0 || size == 0xFFFFFFFFu;
+        p->chunk_left = size;
+        p->state = RIGO_WAV_DATA;
+    } else if (memcmp(p->hdr, "fmt ", 4) == 0 && size >= 16) {
+        p->chunk_left = size + (size & 1);
+        expect(p, RIGO_WAV_FMT, 16);
+    } else {
+        p->chunk_left = size + (size & 1);
+        p->state = p->chunk_left ? RIGO_WAV_SKIP : RIGO_WAV_CHUNK;
+        p->need = 8;
+        p->hdr_len = 0;
+    }
+}
+
+static void on_fmt(rigo_wav_parser_t *p)
+{
+    p->format = rd16(p->hdr);
+    p->channels = rd16(p->hdr + 2);
+    p->sample_rate = rd32(p->hdr + 4);
+    p->block_align = rd16(p->hdr + 12);
+    p->bits = rd16(p->hdr + 14);
+    p->have_fmt = p->channels > 0 && p->sample_rate > 0 && p->block_align > 0;
+    if (!p->have_fmt) {
+        p->state = RIGO_WAV_ERROR;
+        return;
+    }
+
+    p->chunk_left -= 16;
+    p->state = p->chunk_left ? RIGO_WAV_SKIP : RIGO_WAV_CHUNK;
+    p->need = 8;
+    p->hdr_len = 0;
+}
+
+int rigo_wav_parse(rigo_wav_parser_t *p, const uint8_t *in, int len, const uint8_t **pcm, int *pcm_len)
+{
+    *pcm = NULL;
+    *pcm_len = 0;
+    if (p->state == RIGO_WAV_ERROR) return -1;
+    if (len <= 0) return 0;
+
+    int n;
+    switch (p->state) {
+    case RIGO_WAV_RIFF:
+    case RIGO_WAV_CHUNK:
+    case RIGO_WAV_FMT:
+        n = imin(p->need - p->hdr_len, len);
+        memcpy(p->hdr + p->hdr_len, in, n);
+        p->hdr_len += n;
+        if (p->hdr_len < p->need) return n;
+
+        if (p->state == RIGO_WAV_RIFF) {
+            if (memcmp(p->hdr, "RIFF", 4) != 0 || memcmp(p->hdr + 8, "WAVE", 4) != 0) {
+                p->state = RIGO_WAV_ERROR;
+                return -1;
+            }
+            expect(p, RIGO_WAV_CHUNK, 8);
+        } else if (p->state == RIGO_WAV_CHUNK) {
+            on_chunk_header(p);
+        } else {
+            on_fmt(p);
+        }
+        return p->state == RIGO_WAV_ERROR ? -1 : n;
+
+    case RIGO_WAV_SKIP:
+        n = (uint32_t)len < p->chunk_left ? len : (int)p->chunk_left;
+        p->chunk_left -= n;
+        if (p->chunk_left == 0) expect(p, RIGO_WAV_CHUNK, 8);
+        return n;
+
+    case RIGO_WAV_DATA:
+        n = (p->data_unbounded || (uint32_t)len < p->chunk_left) ? len : (int)p->chunk_left;
+        if (!p->data_unbounded) {
+            p->chunk_left -= n;
+            if (p->chunk_left == 0) p->state = RIGO_WAV_DONE;
+        }
+        *pcm = in;
+        *pcm_len = n;
+        return n;
+
+    case RIGO_WAV_DONE:
+    default:
+        return len;
+    }
+}
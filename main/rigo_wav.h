@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RIGO_WAV_HDR_LEN 44
+#define RIGO_WAV_FMT_PCM 1
+#define RIGO_WAV_FMT_IMA_ADPCM 0x11
+#define RIGO_WAV_ADPCM_HDR_LEN 60
+
+// bytes < 0: length unknown up front (streamed upload), sizes are set to 0xFFFFFFFF
+void rigo_wav_build_header(uint8_t *hdr, int bytes, int sample_rate, int channels);
+
+// Mono IMA-ADPCM header (fmt + fact + data). samples < 0: length unknown.
+void rigo_wav_build_adpcm_header(uint8_t *hdr, int samples, int sample_rate);
+
+typedef enum {
+    RIGO_WAV_RIFF = 0,
+    RIGO_WAV_CHUNK,
+    RIGO_WAV_FMT,
+    RIGO_WAV_SKIP,
+    RIGO_WAV_DATA,
+    RIGO_WAV_DONE,
+    RIGO_WAV_ERROR,
+} rigo_wav_state_t;
+
+typedef struct {
+    rigo_wav_state_t state;
+    uint8_t hdr[16];
+    int hdr_len;
+    int need;
+    uint32_t chunk_left;
+    bool data_unbounded;
+
+    bool have_fmt;
+    uint16_t format;
+    uint16_t channels;
+    uint32_t sample_rate;
+    uint16_t bits;
+    uint16_t block_align;
+} rigo_wav_parser_t;
+
+void rigo_wav_parser_init(rigo_wav_parser_t *p);
+
+// Incremental RIFF/WAVE parser for bytes arriving in arbitrary pieces.
+// Consumes a prefix of `in` and returns its length (-1 on malformed input).
+// When that prefix is sample data, *pcm/*pcm_len point at it inside `in`.
+int rigo_wav_parse(rigo_wav_parser_t *p, const uint8_t *in, int len, const uint8_t **pcm, int *pcm_len);
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""Build the host pipeline, run it against stub_cloud.py and report latency.
+
+    run_bench.py [--turns 5] [--speed 1.0] [--overlap | --barge-ms MS] [--wav speech.wav]
+        [--config extra.sdkconfig] [--limit play_start=2500 ...] [--json out.json]
+        [-- stub_cloud.py options, e.g. --tts-ms 600 --down-kbps 2000]
+
+Without --wav a synthetic utterance is used (silence, 1.6 s of voiced tone,
+silence) that the firmware VAD endpoints like speech. --limit fails the run
+when a stage's p95 time from the wake word exceeds the given milliseconds, so
+the script can gate CI. --overlap wakes the next turn as soon as the uplink
+stage is free instead of after the reply. --barge-ms builds with
+CONFIG_RIGO_BARGE_IN and wakes the next turn MS after the reply starts
+playing, reporting how fast playback stopped. Exit status: 0 ok, 1 limit exceeded or turns failed.
+"""
+
+import argparse
+import json
+import math
+import os
+import random
+import socket
+import struct
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+REPO = os.path.dirname(os.path.dirname(HERE))
+HOST_DIR = os.path.join(REPO, 'host')
+RATE = 16000
+STUB_PORT = 8701    # matches host/sdkconfig.host
+
+
+def synth_utterance(path):
+    rnd = random.Random(1)
+    samples = []
+    for ms, voiced in ((300, False), (1600, True), (1500, False)):
+        for i in range(RATE * ms // 1000):
+            v = rnd.uniform(-40, 40)
+            if voiced:
+                t = i / RATE
+                env = 0.6 + 0.4 * math.sin(2 * math.pi * 3 * t)
+                v += env * 7000 * (math.sin(2 * math.pi * 140 * t) + 0.5 * math.sin(2 * math.pi * 420 * t))
+            samples.append(int(max(-32768, min(32767, v))))
+    data = struct.pack('<%dh' % len(samples), *samples)
+    with open(path, 'wb') as f:
+        f.write(struct.pack('<4sI4s4sIHHIIHH4sI', b'RIFF', 36 + len(data), b'WAVE', b'fmt ', 16, 1, 1,
+                            RATE, RATE * 2, 2, 16, b'data', len(data)))
+        f.write(data)
+
+
+def build(build_dir, configs):
+    overrides = ';'.join([os.path.join(HOST_DIR, 'sdkconfig.host')] + [os.path.abspath(c) for c in configs])
+    subprocess.check_call(['cmake', '-S', HOST_DIR, '-B', build_dir, '-DRIGO_SDKCONFIG_OVERRIDES=' + overrides],
+                          stdout=subprocess.DEVNULL)
+    subprocess.check_call(['cmake', '--build', build_dir, '-j', str(os.cpu_count() or 2)],
+                          stdout=subprocess.DEVNULL)
+
+
+def wait_port(port, proc, timeout=10):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        if proc.poll() is not None:
+            sys.exit('stub_cloud.py exited early')
+        try:
+            socket.create_connection(('127.0.0.1', port), 0.2).close()
+            return
+        except OSError:
+            time.sleep(0.1)
+    sys.exit('stub_cloud.py did not come up on port %d' % port)
+
+
+def report(doc):
+    b = doc['bench']
+    stages = doc['metrics']['stages_ms']
+    print('%d turns%s in %d ms, clip %d ms, speed %.2f, wall ms: %s' % (
+        b['turns'], ' overlapped' if b['overlap'] else '', b['total_ms'], b['clip_ms'], b['speed'],
+        ' '.join(str(w) for w in b['wall_ms'])))
+    print('%-16s %6s %7s %7s %7s %9s %9s' % ('stage', 'count', 'p50', 'p95', 'max', 'prev p50', 'prev p95'))
+    for name, s in stages.items():
+        w, d = s['since_wake'], s['from_prev']
+        print('%-16s %6d %7d %7d %7d %9d %9d' % (name, w['count'], w['p50'], w['p95'], w['max'], d['p50'], d['p95']))
+    p = b['player']
+    print('player: %d utterances, %d underruns, %d bytes, ring high water %d' % (
+        p['utterances'], p['underruns'], p['bytes_played'], p['ring_high_water']))
+    if p['resampled_frames']:
+        print('resampler: %d input frames in %d us, speaker opened %d time(s)' % (
+            p['resampled_frames'], p['resample_us'], p['speaker_opens']))
+    if b['barge_ms'] >= 0:
+        print('barge-in %d ms into the reply: %d stops, worst %d ms to silence' % (
+            b['barge_ms'], p['stops'], p['stop_max_ms']))
+    m = doc['metrics']['mic']
+    print('mic: %d frames, %d overruns, %d ms lost' % (m['frames'], m['overruns'], m['lost_ms']))
+    a = doc['metrics']['memory']
+    if a['arenas']:
+        print('arena: %d x %d KB, %d turns, peak %d bytes (last %d), %d overflows, %d turns on the heap' % (
+            a['arenas'], a['arena_kb'], a['arena_turns'], a['arena_peak_max'], a['arena_peak_last'],
+            a['arena_overflows'], a['arena_busy']))
+    for name, e in doc['metrics']['endpoints'].items():
+        if e['requests']:
+            hedge = ''
+            if e['hedge_ms']:
+                hedge = ', hedged %d after %d ms, %d won by the secondary' % (
+                    e['hedges'], e['hedge_ms'], e['hedge_wins'])
+            print('%-10s requests %d, connects %d, reuses %d, retries %d, failures %d, late %d%s' % (
+                name, e['requests'], e['connects'], e['reuses'], e['retries'], e['failures'], e['late'], hedge))
+    w = doc['metrics'].get('stt_ws')
+    if w:
+        print('stt_ws: %d sessions, %d connects, %d reuses, %d partials, %d finals (%d early), %d failures, '
+              '%d late, final %d ms after end of speech (max %d)' % (
+                  w['sessions'], w['connects'], w['reuses'], w['partials'], w['finals'], w['early_finals'],
+                  w['failures'], w['late'], w['final_ms_last'], w['final_ms_max']))
+    busy = [t for t in doc['tasks']['tasks'] if t['cpu_pct'] >= 0.1]
+    print('cpu over %d ms: %s' % (doc['tasks']['interval_ms'], ', '.join(
+        '%s %.1f%%' % (t['name'], t['cpu_pct']) for t in sorted(busy, key=lambda t: -t['cpu_pct']))))
+
+
+def main():
+    argv = sys.argv[1:]
+    stub_args = []
+    if '--' in argv:
+        i = argv.index('--')
+        argv, stub_args = argv[:i], argv[i + 1:]
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('--build-dir', default=os.path.join(HOST_DIR, 'build'))
+    ap.add_argument('--no-build', action='store_true')
+    ap.add_argument('--config', action='append', default=[], help='extra sdkconfig override file')
+    ap.add_argument('--wav', help='16 kHz mono PCM16 utterance used as the mic')
+    ap.add_argument('--turns', type=int, default=5)
+    ap.add_argument('--speed', type=float, default=1.0, help='audio clock speed-up for mic and speaker')
+    ap.add_argument('--overlap', action='store_true', help='capture the next turn while the reply plays')
+    ap.add_argument('--barge-ms', type=int, metavar='MS', help='interrupt each reply MS after it starts')
+    ap.add_argument('--limit', action='append', default=[], metavar='STAGE=MS')
+    ap.add_argument('--json', help='also write the raw result here')
+    args = ap.parse_args(argv)
+    if args.overlap and args.barge_ms is not None:
+        ap.error('--overlap and --barge-ms exclude each other')
+    if args.barge_ms is not None:
+        args.config.append(os.path.join(HOST_DIR, 'sdkconfig.barge_in'))
+
+    if not args.no_build:
+        build(args.build_dir, args.config)
+    wav = args.wav
+    if not wav:
+        wav = os.path.join(args.build_dir, 'utterance.wav')
+        synth_utterance(wav)
+
+    stub = subprocess.Popen([sys.executable, os.path.join(HERE, 'stub_cloud.py'), '--port', str(STUB_PORT)] +
+                            stub_args)
+    try:
+        wait_port(STUB_PORT, stub)
+        cmd = [os.path.join(args.build_dir, 'rigo_bench'), '--wav', wav, '--turns', str(args.turns),
+               '--speed', str(args.speed)]
+        if args.overlap:
+            cmd.append('--overlap')
+        if args.barge_ms is not None:
+            cmd += ['--barge-ms', str(args.barge_ms)]
+        out = subprocess.run(cmd, stdout=subprocess.PIPE, check=True)
+    finally:
+        stub.terminate()
+        stub.wait()
+
+    doc = json.loads(out.stdout)
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(doc, f, indent=1)
+    report(doc)
+
+    failed = False
+    stages = doc['metrics']['stages_ms']
+    done = stages['play_end']['since_wake']['count']
+    if done < args.turns:
+        print('FAIL: only %d of %d turns played a reply' % (done, args.turns))
+        failed = True
+    if args.barge_ms is not None and doc['bench']['player']['stops'] < args.turns - 1:
+        print('FAIL: %d of %d replies were cut off' % (doc['bench']['player']['stops'], args.turns - 1))
+        failed = True
+    for lim in args.limit:
+        name, ms = lim.split('=')
+        p95 = stages[name]['since_wake']['p95']
+        if p95 > int(ms):
+            print('FAIL: %s p95 %d ms > %s ms' % (name, p95, ms))
+            failed = True
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
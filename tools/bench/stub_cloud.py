@@ -0,0 +1,304 @@
+#!/usr/bin/env python3
+"""Local stand-in for the STT, assistant and TTS endpoints.
+
+Speaks the same contracts as the real services (see README) over plain
+HTTP/1.1 with keep-alive, with configurable processing latency and link
+bandwidth, so the host benchmark measures the firmware pipeline rather than a
+cloud provider.
+
+    stub_cloud.py [--port 8701] [--stt-ms 300] [--assistant-ms 400]
+        [--token-ms 30] [--tts-ms 200] [--tts-rate 16000] [--down-kbps 0] [--up-kbps 0]
+        [--slow-pct 0 --slow-ms 3000] [--stt-final-ms 150]
+
+POST /stt        WAV body (Content-Length or chunked) -> {"text": ...}
+POST /assistant  {"text": ...} -> {"reply": ...}, SSE or NDJSON per Accept
+POST /tts        {"text": ...} -> mono PCM16 WAV at --tts-rate, chunked
+GET /stt-stream  WebSocket: {"type":"start","id":N,...}, binary audio frames and
+                 {"type":"end","id":N} -> {"type":"partial",...} about every
+                 400 ms of audio, then {"type":"final","id":N,"text":...}
+HEAD any path    200, used by connection prewarm
+"""
+
+import argparse
+import base64
+import hashlib
+import json
+import math
+import random
+import struct
+import sys
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+TRANSCRIPT = 'What is the weather like today?'
+WS_GUID = '258EAFA5-E914-47DA-95CA-C5AB0DC85B11'
+PARTIAL_MS = 400
+REPLY = ('It is sunny and mild, about twenty degrees this afternoon. '
+         'A light breeze comes in from the west later on. '
+         'Tomorrow looks much the same, so no umbrella needed.')
+
+
+def wav_header(data_len, rate):
+    return struct.pack('<4sI4s4sIHHIIHH4sI', b'RIFF', 36 + data_len, b'WAVE', b'fmt ', 16, 1, 1,
+                       rate, rate * 2, 2, 16, b'data', data_len)
+
+
+def speech_like(ms, rate):
+    """Vowel-ish tone with a syllable envelope, so lip sync has something to follow."""
+    n = rate * ms // 1000
+    out = bytearray(n * 2)
+    for i in range(n):
+        t = i / rate
+        env = 0.5 - 0.5 * math.cos(2 * math.pi * 4 * t)
+        v = env * (math.sin(2 * math.pi * 180 * t) + 0.4 * math.sin(2 * math.pi * 720 * t))
+        struct.pack_into('<h', out, i * 2, int(9000 * v))
+    return bytes(out)
+
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+    disable_nagle_algorithm = True
+    cfg = None
+    voice = b''   # built once in main; synthesis time is modelled by --tts-ms
+
+    def log_message(self, fmt, *args):
+        if self.cfg.verbose:
+            sys.stderr.write('stub: ' + fmt % args + '\n')
+
+    # ---- link model ----
+
+    def throttle(self, nbytes, kbps, t0):
+        if kbps > 0:
+            due = t0 + nbytes * 8 / (kbps * 1000)
+            delay = due - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+
+    def read_body(self):
+        t0 = time.monotonic()
+        got = 0
+        parts = []
+        if 'chunked' in self.headers.get('Transfer-Encoding', '').lower():
+            while True:
+                size = int(self.rfile.readline().split(b';')[0].strip() or b'0', 16)
+                if size == 0:
+                    while self.rfile.readline() not in (b'\r\n', b'\n', b''):
+                        pass
+                    break
+                parts.append(self.rfile.read(size))
+                self.rfile.readline()
+                got += size
+                self.throttle(got, self.cfg.up_kbps, t0)
+        else:
+            left = int(self.headers.get('Content-Length', 0))
+            while left > 0:
+                part = self.rfile.read(min(left, 4096))
+                if not part:
+                    break
+                parts.append(part)
+                left -= len(part)
+                got += len(part)
+                self.throttle(got, self.cfg.up_kbps, t0)
+        return b''.join(parts)
+
+    def start(self, ctype, length=None):
+        self.send_response(200)
+        self.send_header('Content-Type', ctype)
+        if length is None:
+            self.send_header('Transfer-Encoding', 'chunked')
+        else:
+            self.send_header('Content-Length', str(length))
+        self.end_headers()
+
+    def chunk(self, data):
+        self.wfile.write(b'%x\r\n%s\r\n' % (len(data), data))
+        self.wfile.flush()
+
+    def send_paced(self, data, chunked, piece=1024):
+        t0 = time.monotonic()
+        for off in range(0, len(data), piece):
+            part = data[off:off + piece]
+            if chunked:
+                self.chunk(part)
+            else:
+                self.wfile.write(part)
+            self.throttle(off + len(part), self.cfg.down_kbps, t0)
+        if chunked:
+            self.wfile.write(b'0\r\n\r\n')
+        self.wfile.flush()
+
+    def think(self, ms):
+        """Processing time, with a --slow-pct chance of a --slow-ms stall (a cold or overloaded backend)."""
+        if random.random() * 100 < self.cfg.slow_pct:
+            ms += self.cfg.slow_ms
+        time.sleep(ms / 1000)
+
+    # ---- endpoints ----
+
+    def do_HEAD(self):
+        self.send_response(200)
+        self.send_header('Content-Length', '0')
+        self.end_headers()
+
+    def do_GET(self):
+        if self.path != '/stt-stream' or 'websocket' not in self.headers.get('Upgrade', '').lower():
+            self.send_error(404)
+            return
+        accept = hashlib.sha1((self.headers['Sec-WebSocket-Key'] + WS_GUID).encode()).digest()
+        self.send_response(101)
+        self.send_header('Upgrade', 'websocket')
+        self.send_header('Connection', 'Upgrade')
+        self.send_header('Sec-WebSocket-Accept', base64.b64encode(accept).decode())
+        self.end_headers()
+        self.close_connection = True
+        self.stt_stream()
+
+    def do_POST(self):
+        body = self.read_body()
+        route = {'/stt': self.stt, '/assistant': self.assistant, '/tts': self.tts}.get(self.path)
+        if not route:
+            self.send_error(404)
+            return
+        route(body)
+
+    def stt(self, body):
+        if body[:4] != b'RIFF':
+            self.send_error(400, 'expected a WAV body')
+            return
+        self.think(self.cfg.stt_ms)
+        out = json.dumps({'text': self.cfg.transcript}).encode('utf-8')
+        self.start('application/json', len(out))
+        self.send_paced(out, False)
+
+    # ---- WebSocket STT ----
+
+    def ws_recv(self):
+        """One client frame as (opcode, payload), or None once the peer is gone."""
+        head = self.rfile.read(2)
+        if len(head) < 2:
+            return None
+        n = head[1] & 0x7f
+        if n == 126:
+            n = struct.unpack('>H', self.rfile.read(2))[0]
+        elif n == 127:
+            n = struct.unpack('>Q', self.rfile.read(8))[0]
+        mask = self.rfile.read(4) if head[1] & 0x80 else b'\0\0\0\0'
+        data = self.rfile.read(n)
+        if len(data) < n:
+            return None
+        return head[0] & 0x0f, bytes(b ^ mask[i & 3] for i, b in enumerate(data))
+
+    def ws_send(self, opcode, data):
+        n = len(data)
+        head = bytes([0x80 | opcode]) + (bytes([n]) if n < 126 else struct.pack('>BH', 126, n))
+        self.wfile.write(head + data)
+        self.wfile.flush()
+
+    def ws_json(self, obj):
+        self.ws_send(1, json.dumps(obj).encode('utf-8'))
+
+    def stt_stream(self):
+        words = self.cfg.transcript.split(' ')
+        sid, adpcm, audio, shown = None, False, 0, 0
+        while True:
+            frame = self.ws_recv()
+            if frame is None:
+                return
+            op, data = frame
+            if op == 8:
+                self.ws_send(8, data[:2])
+                return
+            if op == 9:
+                self.ws_send(10, data)
+            elif op == 2 and sid is not None:
+                self.throttle(len(data), self.cfg.up_kbps, time.monotonic())
+                audio += len(data)
+                # ima_adpcm: 256-byte blocks of 505 samples
+                ms = audio * 505 // 256 // 16 if adpcm else audio // 32
+                if ms // PARTIAL_MS > shown and shown < len(words) - 1:
+                    shown += 1
+                    self.ws_json({'type': 'partial', 'id': sid, 'text': ' '.join(words[:shown])})
+            elif op == 1:
+                msg = json.loads(data)
+                if msg.get('type') == 'start':
+                    sid, adpcm, audio, shown = msg.get('id'), msg.get('encoding') == 'ima_adpcm', 0, 0
+                elif msg.get('type') == 'end' and msg.get('id') == sid:
+                    self.think(self.cfg.stt_final_ms)
+                    self.ws_json({'type': 'final', 'id': sid, 'text': self.cfg.transcript})
+                    sid = None
+                elif msg.get('type') == 'cancel':
+                    sid = None
+
+    def assistant(self, body):
+        json.loads(body or b'{}')
+        self.think(self.cfg.assistant_ms)
+        accept = self.headers.get('Accept', '')
+        reply = self.cfg.reply
+        if 'event-stream' not in accept and 'ndjson' not in accept:
+            out = json.dumps({'reply': reply}).encode('utf-8')
+            self.start('application/json', len(out))
+            self.send_paced(out, False)
+            return
+
+        sse = 'event-stream' in accept
+        self.start('text/event-stream' if sse else 'application/x-ndjson')
+        words = reply.split(' ')
+        for i, w in enumerate(words):
+            delta = json.dumps({'delta': w + (' ' if i + 1 < len(words) else '')})
+            self.chunk(('data: %s\n\n' % delta if sse else delta + '\n').encode('utf-8'))
+            time.sleep(self.cfg.token_ms / 1000)
+        self.chunk(b'data: [DONE]\n\n' if sse else b'{"done":true}\n')
+        self.wfile.write(b'0\r\n\r\n')
+        self.wfile.flush()
+
+    def tts(self, body):
+        text = json.loads(body or b'{}').get('text', '')
+        self.think(self.cfg.tts_ms)
+        rate = self.cfg.tts_rate
+        pcm = self.voice[:rate * min(30000, max(200, len(text) * self.cfg.ms_per_char)) // 1000 * 2]
+        self.start('audio/wav')
+        self.send_paced(wav_header(len(pcm), rate) + pcm, True, 4096)
+
+
+class Server(ThreadingHTTPServer):
+    daemon_threads = True
+
+    def handle_error(self, request, client_address):
+        # a barged-in reply drops its TTS connection mid-body
+        if not isinstance(sys.exc_info()[1], ConnectionError):
+            super().handle_error(request, client_address)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('--host', default='127.0.0.1')
+    ap.add_argument('--port', type=int, default=8701)
+    ap.add_argument('--stt-ms', type=int, default=300, help='STT processing after the upload ends')
+    ap.add_argument('--assistant-ms', type=int, default=400, help='assistant time to first token')
+    ap.add_argument('--token-ms', type=int, default=30, help='gap between streamed words')
+    ap.add_argument('--stt-final-ms', type=int, default=150,
+                    help='streamed STT: end of speech to the final transcript')
+    ap.add_argument('--tts-ms', type=int, default=200, help='TTS time to first byte')
+    ap.add_argument('--tts-rate', type=int, default=16000, help='TTS sample rate, resampled on the device')
+    ap.add_argument('--ms-per-char', type=int, default=65, help='spoken length of TTS audio')
+    ap.add_argument('--down-kbps', type=float, default=0, help='response bandwidth, 0 = unlimited')
+    ap.add_argument('--up-kbps', type=float, default=0, help='request bandwidth, 0 = unlimited')
+    ap.add_argument('--slow-pct', type=float, default=0, help='share of requests that stall, in percent')
+    ap.add_argument('--slow-ms', type=int, default=3000, help='extra processing time of a stalled request')
+    ap.add_argument('--transcript', default=TRANSCRIPT)
+    ap.add_argument('--reply', default=REPLY)
+    ap.add_argument('-v', '--verbose', action='store_true')
+    Handler.cfg = ap.parse_args()
+    Handler.voice = speech_like(30000, Handler.cfg.tts_rate)
+
+    srv = Server((Handler.cfg.host, Handler.cfg.port), Handler)
+    print('stub cloud on http://%s:%d' % srv.server_address[:2], file=sys.stderr, flush=True)
+    try:
+        srv.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Build a ttscache partition image from a list of phrases.
+
+Each phrase (one per line, '#' comments allowed) is fetched from the TTS
+endpoint with the same JSON body the firmware sends and stored under the
+same key (FNV-1a 64 of "<url>\\n<voice>\\n<text>"). Phrases must match the
+text of a firmware TTS segment exactly, e.g. a short one-sentence reply.
+
+    tts_cache_seed.py --url URL [--voice V] [--bearer TOKEN] --size 0xF0000 \\
+        --out ttscache.bin phrases.txt
+
+A line of the form "text<TAB>file.wav" uses a local WAV instead of fetching.
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+import urllib.request
+import zlib
+
+SECTOR = 4096
+REC_MAGIC = 0x31435452  # "RTC1"
+HDR = struct.Struct('<IIQII8x')  # matches rec_hdr_t in main/rigo_tts_cache.c
+ENTRY_MAX = 512 * 1024
+
+
+def fnv1a(text):
+    h = 0xcbf29ce484222325
+    for b in text.encode('utf-8'):
+        h = ((h ^ b) * 0x100000001b3) & 0xFFFFFFFFFFFFFFFF
+    return h
+
+
+def fetch(url, voice, bearer, text):
+    body = {'text': text}
+    if voice:
+        body['voice'] = voice
+    req = urllib.request.Request(url, data=json.dumps(body).encode('utf-8'), method='POST')
+    req.add_header('Content-Type', 'application/json')
+    req.add_header('Accept', 'audio/wav')
+    if bearer:
+        req.add_header('Authorization', 'Bearer ' + bearer)
+    with urllib.request.urlopen(req, timeout=60) as resp:
+        return resp.read()
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--url', required=True)
+    ap.add_argument('--voice', default='')
+    ap.add_argument('--bearer', default='')
+    ap.add_argument('--size', required=True, type=lambda v: int(v, 0))
+    ap.add_argument('--out', required=True)
+    ap.add_argument('phrases')
+    args = ap.parse_args()
+
+    image = bytearray(b'\xff' * args.size)
+    off = 0
+    seq = 0
+    base = os.path.dirname(os.path.abspath(args.phrases))
+    with open(args.phrases, encoding='utf-8') as f:
+        for line in f:
+            line = line.rstrip('\r\n')
+            if not line.strip() or line.lstrip().startswith('#'):
+                continue
+            text, _, wav = line.partition('\t')
+            text = text.strip()
+            if wav:
+                with open(os.path.join(base, wav.strip()), 'rb') as w:
+                    audio = w.read()
+            else:
+                audio = fetch(args.url, args.voice, args.bearer, text)
+            if not audio.startswith(b'RIFF') or len(audio) > ENTRY_MAX:
+                sys.exit('{!r}: not a WAV reply or too large ({} bytes)'.format(text, len(audio)))
+
+            span = (HDR.size + len(audio) + SECTOR - 1) // SECTOR * SECTOR
+            if off + span > args.size:
+                sys.exit('ttscache partition full at {!r}'.format(text))
+            seq += 1
+            key = fnv1a('{}\n{}\n{}'.format(args.url, args.voice, text))
+            image[off:off + HDR.size] = HDR.pack(REC_MAGIC, seq, key, len(audio), zlib.crc32(audio))
+            image[off + HDR.size:off + HDR.size + len(audio)] = audio
+            off += span
+            print('{:016x} {:6d} bytes  {}'.format(key, len(audio), text))
+
+    with open(args.out, 'wb') as f:
+        f.write(image)
+    print('{} phrases, {} of {} bytes used'.format(seq, off, args.size))
+
+
+if __name__ == '__main__':
+    main()
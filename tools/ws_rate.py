@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Measure the avatar update rate the device sustains on /v1/ws.
+
+    ws_rate.py [--host 192.168.4.1] [--port 8080] [--frames 2000] [--batch 1]
+        [--rounds 5] [--pings 50]
+
+Each round sends --frames binary frames (--batch 4-byte records each, a mouth
+sweep) back to back, then a {"sync":n} text frame; the device answers it
+after applying every earlier frame, so frames / (send start .. sync reply) is
+the end-to-end rate. --pings then times single sync round trips on an idle
+channel. State pushes ({"emotion":..,"talk":..}) arriving meanwhile are
+counted and skipped. Standard library only.
+"""
+
+import argparse
+import base64
+import json
+import os
+import socket
+import struct
+import sys
+import time
+
+WS_F_MOUTH = 0x08
+
+
+class Ws:
+    def __init__(self, host, port, path):
+        self.sock = socket.create_connection((host, port), timeout=10)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(('GET %s HTTP/1.1\r\nHost: %s:%d\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n'
+                           'Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n' %
+                           (path, host, port, key)).encode())
+        self.buf = b''
+        while b'\r\n\r\n' not in self.buf:
+            data = self.sock.recv(4096)
+            if not data:
+                raise ConnectionError('closed during handshake')
+            self.buf += data
+        head, self.buf = self.buf.split(b'\r\n\r\n', 1)
+        if b' 101 ' not in head.split(b'\r\n')[0]:
+            raise ConnectionError(head.split(b'\r\n')[0].decode())
+        self.pushes = 0
+
+    def frame(self, opcode, payload):
+        # client frames are masked; a zero mask keeps the payload as is
+        n = len(payload)
+        if n < 126:
+            hdr = struct.pack('!BB', 0x80 | opcode, 0x80 | n)
+        else:
+            hdr = struct.pack('!BBH', 0x80 | opcode, 0x80 | 126, n)
+        return hdr + b'\0\0\0\0' + payload
+
+    def send(self, data):
+        self.sock.sendall(data)
+
+    def _need(self, n):
+        while len(self.buf) < n:
+            data = self.sock.recv(65536)
+            if not data:
+                raise ConnectionError('closed')
+            self.buf += data
+
+    def recv(self):
+        self._need(2)
+        b0, b1 = self.buf[0], self.buf[1]
+        n, off = b1 & 0x7f, 2
+        if n == 126:
+            self._need(4)
+            n, off = struct.unpack('!H', self.buf[2:4])[0], 4
+        elif n == 127:
+            self._need(10)
+            n, off = struct.unpack('!Q', self.buf[2:10])[0], 10
+        self._need(off + n)
+        payload, self.buf = self.buf[off:off + n], self.buf[off + n:]
+        return b0 & 0x0f, payload
+
+    def sync(self, seq):
+        self.send(self.frame(1, json.dumps({'sync': seq}).encode()))
+        while True:
+            op, payload = self.recv()
+            if op != 1:
+                continue
+            msg = json.loads(payload)
+            if msg.get('sync') == seq:
+                return msg
+            self.pushes += 1
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('--host', default='192.168.4.1')
+    ap.add_argument('--port', type=int, default=8080)
+    ap.add_argument('--frames', type=int, default=2000)
+    ap.add_argument('--batch', type=int, default=1, help='4-byte records per binary frame')
+    ap.add_argument('--rounds', type=int, default=5)
+    ap.add_argument('--pings', type=int, default=50)
+    args = ap.parse_args()
+
+    ws = Ws(args.host, args.port, '/v1/ws')
+    seq = 0
+    rates = []
+    for r in range(args.rounds):
+        frames = []
+        for i in range(args.frames):
+            recs = b''.join(struct.pack('BBBB', WS_F_MOUTH, 0, (i * 8 + j) & 0xff, 0) for j in range(args.batch))
+            frames.append(ws.frame(2, recs))
+        blob = b''.join(frames)
+        seq += 1
+        t0 = time.monotonic()
+        ws.send(blob)
+        reply = ws.sync(seq)
+        dt = time.monotonic() - t0
+        rates.append(args.frames / dt)
+        print('round %d: %d frames in %.0f ms, %.0f frames/s, %.0f updates/s (device total %d)' % (
+            r + 1, args.frames, dt * 1000, args.frames / dt, args.frames * args.batch / dt, reply['updates']))
+
+    rtts = []
+    for _ in range(args.pings):
+        seq += 1
+        t0 = time.monotonic()
+        ws.sync(seq)
+        rtts.append((time.monotonic() - t0) * 1000)
+        time.sleep(0.02)
+    rtts.sort()
+    if rates:
+        print('sustained: %.0f frames/s median, %.0f min' % (sorted(rates)[len(rates) // 2], min(rates)))
+    if rtts:
+        print('sync round trip: p50 %.1f ms, p95 %.1f ms, max %.1f ms' % (
+            rtts[len(rtts) // 2], rtts[min(len(rtts) - 1, len(rtts) * 95 // 100)], rtts[-1]))
+    print('state pushes received: %d' % ws.pushes)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())